@@ -23,19 +23,62 @@ win32 {
 }
 
 SOURCES += \
+    bufferpool.cpp \
+    connectionpool.cpp \
+    connectionworker.cpp \
+    credentialfeeder.cpp \
+    framedecoder.cpp \
+    inboundbatch.cpp \
+    latencyhistogram.cpp \
+    latencyrecorder.cpp \
+    loadgenerator.cpp \
+    loadscenario.cpp \
     main.cpp \
     mainwindow.cpp \
     networkmanager.cpp \
+    pendingrequesttable.cpp \
+    preparedrequest.cpp \
     protoc/data_proto.pb.cc \
     protoclient.cpp \
-    sessionmanager.cpp
+    randomdistribution.cpp \
+    requestbatcher.cpp \
+    requestidgenerator.cpp \
+    sessioncontext.cpp \
+    sessionmanager.cpp \
+    settingswriter.cpp \
+    timingwheel.cpp \
+    trafficcapture.cpp \
+    trafficreplayer.cpp
 
 HEADERS += \
+    bufferpool.h \
+    connectionpool.h \
+    connectionworker.h \
+    credentialfeeder.h \
+    framedecoder.h \
+    inboundbatch.h \
+    latencyhistogram.h \
+    latencyrecorder.h \
+    loadgenerator.h \
+    loadscenario.h \
     mainwindow.h \
+    mpscqueue.h \
     networkmanager.h \
+    pendingrequesttable.h \
+    preparedrequest.h \
     protoc/data_proto.pb.h \
     protoclient.h \
-    sessionmanager.h
+    protoutil.h \
+    randomdistribution.h \
+    requestbatcher.h \
+    requestidgenerator.h \
+    sessioncontext.h \
+    sessionmanager.h \
+    settingswriter.h \
+    spscqueue.h \
+    timingwheel.h \
+    trafficcapture.h \
+    trafficreplayer.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,63 @@
+#include "benchutil.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 替换全局 operator new/delete，统计基准过程中的堆分配次数和字节数。
+// protobuf 消息、std::string 和 Arena 块都经过这里；QByteArray 等 Qt 容器直接调用 malloc，不计入统计。
+namespace {
+std::atomic<quint64> g_allocationCount{0};
+std::atomic<quint64> g_allocationBytes{0};
+
+void *countedAllocate(std::size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+}
+
+void *operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace bench {
+
+AllocationStats allocationStats()
+{
+    AllocationStats stats;
+    stats.count = g_allocationCount.load(std::memory_order_relaxed);
+    stats.bytes = g_allocationBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace bench
@@ -0,0 +1,143 @@
+#include "benchutil.h"
+#include "protoutil.h"
+#include "protoc/data_proto.pb.h"
+#include <QString>
+#include <string>
+#include <vector>
+
+// 保存源码请求的构造开销。B/op 即每个请求新分配（也就是被拷贝写入）的字节数；
+// QString::toStdString() 内部的 QByteArray 走 malloc 不计入，所以旧写法的数字只是下限。
+namespace {
+
+QString makeSource(qsizetype bytes)
+{
+    static const std::string line = "    for (int i = 0; i < n; ++i) { total += values[i] * weight; } // 累加\n";
+    std::string text;
+    text.reserve(size_t(bytes) + line.size());
+    while (qsizetype(text.size()) < bytes) {
+        text += line;
+    }
+    return QString::fromUtf8(text);
+}
+
+void fillHeader(data::MessageFrame &message, int index)
+{
+    auto *header = message.mutable_header();
+    header->set_request_id("8c5f2f0e-7c1b-4d8e-9a3f-" + std::to_string(100000000000 + index));
+    header->set_client_id("ProtoClientTester");
+    header->set_timestamp(1700000000000 + index);
+    header->set_type(data::SAVE_SOURCE_CODE_REQUEST);
+}
+
+// 旧写法：独立的子请求，字段经 toStdString() 转换，再 CopyFrom 进帧
+void buildWithCopyFrom(data::MessageFrame &message, const QString &source, int index)
+{
+    fillHeader(message, index);
+    data::SaveSourceCodeRequest request;
+    request.set_code_id(QString("code-42").toStdString());
+    request.set_language(QString("cpp").toStdString());
+    request.set_source_code(source.toStdString());
+    request.set_code_name(QString("kernel.cpp").toStdString());
+    message.mutable_save_source_request()->CopyFrom(request);
+}
+
+// 新写法：请求体在帧内原地构造，源码一次编码进目标字段
+void buildInPlace(data::MessageFrame &message, const QString &source, int index)
+{
+    fillHeader(message, index);
+    auto *request = message.mutable_save_source_request();
+    assignUtf8(request->mutable_code_id(), QString("code-42"));
+    assignUtf8(request->mutable_language(), QString("cpp"));
+    assignUtf8(request->mutable_source_code(), source);
+    assignUtf8(request->mutable_code_name(), QString("kernel.cpp"));
+}
+
+// 源码已是 UTF-8 字节：直接移动进帧
+void buildMoved(data::MessageFrame &message, std::string &&source, int index)
+{
+    fillHeader(message, index);
+    auto *request = message.mutable_save_source_request();
+    assignUtf8(request->mutable_code_id(), QString("code-42"));
+    assignUtf8(request->mutable_language(), QString("cpp"));
+    request->set_source_code(std::move(source));
+    assignUtf8(request->mutable_code_name(), QString("kernel.cpp"));
+}
+
+void runSize(bench::Reporter &reporter, const char *label, qsizetype bytes, int requests)
+{
+    const QString source = makeSource(bytes);
+    const qint64 totalBytes = qint64(bytes) * requests;
+
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < requests; ++i) {
+            data::MessageFrame message;
+            buildWithCopyFrom(message, source, i);
+            bench::doNotOptimize(message);
+        }
+    });
+    reporter.report(QString("builders/save_copyfrom/") + label, requests, totalBytes, m);
+
+    m = bench::measure([&]() {
+        for (int i = 0; i < requests; ++i) {
+            data::MessageFrame message;
+            buildInPlace(message, source, i);
+            bench::doNotOptimize(message);
+        }
+    });
+    reporter.report(QString("builders/save_in_place/") + label, requests, totalBytes, m);
+
+    // 调用方手里的 UTF-8 字节在计时之外准备好，计时内只有移动
+    std::vector<std::string> utf8Sources(size_t(requests), source.toStdString());
+    m = bench::measure([&]() {
+        for (int i = 0; i < requests; ++i) {
+            data::MessageFrame message;
+            buildMoved(message, std::move(utf8Sources[size_t(i)]), i);
+            bench::doNotOptimize(message);
+        }
+    });
+    reporter.report(QString("builders/save_moved_utf8/") + label, requests, totalBytes, m);
+}
+
+// 构造请求时逐字段的 QString -> std::string，以及处理响应时的 std::string -> QString
+void runConversions(bench::Reporter &reporter, const char *label, const QString &text, int iterations)
+{
+    const qint64 totalBytes = qint64(text.size()) * iterations;
+
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            const std::string converted = text.toStdString();
+            bench::doNotOptimize(converted);
+        }
+    });
+    reporter.report(QString("builders/to_std_string/") + label, iterations, totalBytes, m);
+
+    std::string target;
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            assignUtf8(&target, text);
+            bench::doNotOptimize(target);
+        }
+    });
+    reporter.report(QString("builders/assign_utf8/") + label, iterations, totalBytes, m);
+
+    const std::string utf8 = text.toStdString();
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            const QString converted = QString::fromStdString(utf8);
+            bench::doNotOptimize(converted);
+        }
+    });
+    reporter.report(QString("builders/from_std_string/") + label, iterations, qint64(utf8.size()) * iterations, m);
+}
+
+} // namespace
+
+void runBuilderBenchmarks(bench::Reporter &reporter)
+{
+    runConversions(reporter, "code_id", QString("code-8c5f2f0e"), 1000000);
+    runConversions(reporter, "session_id", QString("3f1c2d4e-5a6b-4c7d-8e9f-a0b1c2d3e4f5"), 1000000);
+    runConversions(reporter, "result_1KB", makeSource(1024), 200000);
+    runSize(reporter, "1KB", 1024, 20000);
+    runSize(reporter, "1MB", 1024 * 1024, 50);
+    runSize(reporter, "16MB", 16 * 1024 * 1024, 5);
+}
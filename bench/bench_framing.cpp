@@ -0,0 +1,142 @@
+#include "benchutil.h"
+#include "framedecoder.h"
+#include "protoc/data_proto.pb.h"
+#include <QByteArray>
+#include <QtEndian>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// 旧版 NetworkManager::onReadyRead 的等价实现：readAll + append + mid + remove。
+// 原来的 static 缓冲区改成成员，这样同一进程内可以反复运行。
+class LegacyDecoder
+{
+public:
+    template<typename Fn>
+    void feed(const QByteArray &data, Fn &&onMessage)
+    {
+        m_buffer.append(data);
+        while (m_buffer.size() >= 4) {
+            quint32 frameSize;
+            memcpy(&frameSize, m_buffer.constData(), sizeof(frameSize));
+            frameSize = qFromBigEndian<quint32>(frameSize);
+
+            if (m_buffer.size() < qsizetype(4 + frameSize)) {
+                return;
+            }
+            QByteArray messageData = m_buffer.mid(4, frameSize);
+            m_buffer.remove(0, 4 + frameSize);
+            data::MessageFrame message;
+            if (message.ParseFromArray(messageData.constData(), messageData.size())) {
+                onMessage(message);
+            }
+        }
+    }
+
+private:
+    QByteArray m_buffer;
+};
+
+QByteArray encodeFrame(const data::MessageFrame &message)
+{
+    const std::string serialized = message.SerializeAsString();
+    const quint32 networkSize = qToBigEndian<quint32>(quint32(serialized.size()));
+
+    QByteArray frame;
+    frame.append(reinterpret_cast<const char *>(&networkSize), sizeof(networkSize));
+    frame.append(serialized.data(), qsizetype(serialized.size()));
+    return frame;
+}
+
+data::MessageFrame makeSmallFrame()
+{
+    data::MessageFrame message;
+    auto *header = message.mutable_header();
+    header->set_request_id("8c5f2f0e-7c1b-4d8e-9a3f-2b6d1e0c9a71");
+    header->set_timestamp(1700000000000);
+    header->set_type(data::HEARTBEAT);
+    message.mutable_heartbeat()->set_server_time(1700000000000);
+    return message;
+}
+
+data::MessageFrame makeLargeFrame(qsizetype resultSize)
+{
+    data::MessageFrame message;
+    auto *header = message.mutable_header();
+    header->set_request_id("8c5f2f0e-7c1b-4d8e-9a3f-2b6d1e0c9a71");
+    header->set_timestamp(1700000000000);
+    header->set_type(data::EXECUTE_IR_RESPONSE);
+    auto *response = message.mutable_execute_ir_response();
+    response->set_success(true);
+    response->set_execution_result(std::string(size_t(resultSize), 'x'));
+    return message;
+}
+
+// 把 block 重复 repeats 次，按 chunkSize 切片喂给解码器，模拟一次次 readyRead
+template<typename Feed>
+void feedStream(const QByteArray &block, qint64 repeats, qsizetype chunkSize, Feed &&feed)
+{
+    for (qint64 r = 0; r < repeats; ++r) {
+        for (qsizetype offset = 0; offset < block.size(); offset += chunkSize) {
+            feed(block.constData() + offset, qMin(chunkSize, block.size() - offset));
+        }
+    }
+}
+
+void runCase(bench::Reporter &reporter, const QString &label,
+             const QByteArray &block, qint64 framesPerBlock, qint64 repeats)
+{
+    const qsizetype chunkSize = 64 * 1024;
+    const qint64 frames = framesPerBlock * repeats;
+    const qint64 bytes = qint64(block.size()) * repeats;
+
+    qint64 parsed = 0;
+    LegacyDecoder legacy;
+    bench::Measurement m = bench::measure([&]() {
+        feedStream(block, repeats, chunkSize, [&](const char *data, qsizetype size) {
+            legacy.feed(QByteArray(data, size), [&](const data::MessageFrame &message) {
+                bench::doNotOptimize(message);
+                ++parsed;
+            });
+        });
+    });
+    Q_ASSERT(parsed == frames);
+    reporter.report("framing/legacy/" + label, frames, bytes, m);
+
+    parsed = 0;
+    FrameDecoder decoder;
+    m = bench::measure([&]() {
+        feedStream(block, repeats, chunkSize, [&](const char *data, qsizetype size) {
+            decoder.append(data, size);
+            const char *frameData = nullptr;
+            quint32 frameSize = 0;
+            while (decoder.nextFrame(frameData, frameSize)) {
+                data::MessageFrame message;
+                if (message.ParseFromArray(frameData, int(frameSize))) {
+                    bench::doNotOptimize(message);
+                    ++parsed;
+                }
+            }
+        });
+    });
+    Q_ASSERT(parsed == frames);
+    reporter.report("framing/decoder/" + label, frames, bytes, m);
+}
+
+} // namespace
+
+void runFramingBenchmarks(bench::Reporter &reporter)
+{
+    // 100 万个小帧：每个块拼 1000 个心跳帧
+    const QByteArray smallFrame = encodeFrame(makeSmallFrame());
+    QByteArray smallBlock;
+    for (int i = 0; i < 1000; ++i) {
+        smallBlock.append(smallFrame);
+    }
+    runCase(reporter, "small_1M", smallBlock, 1000, 1000);
+
+    // 1000 个 2 MB 的执行结果帧
+    const QByteArray largeFrame = encodeFrame(makeLargeFrame(2 * 1024 * 1024));
+    runCase(reporter, "large_1k_2MB", largeFrame, 1, 1000);
+}
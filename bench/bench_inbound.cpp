@@ -0,0 +1,118 @@
+#include "benchutil.h"
+#include "framedecoder.h"
+#include "inboundbatch.h"
+#include "protoc/data_proto.pb.h"
+#include <QByteArray>
+#include <QtEndian>
+#include <string>
+
+namespace {
+
+void appendFrame(QByteArray &stream, const data::MessageFrame &message)
+{
+    const std::string serialized = message.SerializeAsString();
+    const quint32 networkSize = qToBigEndian<quint32>(quint32(serialized.size()));
+    stream.append(reinterpret_cast<const char *>(&networkSize), sizeof(networkSize));
+    stream.append(serialized.data(), qsizetype(serialized.size()));
+}
+
+void fillHeader(data::MessageFrame &message, data::RequestType type, int index)
+{
+    auto *header = message.mutable_header();
+    header->set_request_id("8c5f2f0e-7c1b-4d8e-9a3f-" + std::to_string(100000000000 + index));
+    header->set_timestamp(1700000000000 + index);
+    header->set_type(type);
+}
+
+// 通知为主的入站流量：通知、执行结果、编译结果和心跳交替出现
+QByteArray buildNotificationHeavyBlock(int frames)
+{
+    QByteArray block;
+    for (int i = 0; i < frames; ++i) {
+        data::MessageFrame message;
+        switch (i % 8) {
+        case 0: {
+            fillHeader(message, data::EXECUTE_IR_RESPONSE, i);
+            auto *response = message.mutable_execute_ir_response();
+            response->set_success(true);
+            response->set_execution_result(std::string(1024, 'r'));
+            response->set_error_message(std::string(64, 'e'));
+            response->set_execution_mode_used("JIT");
+            break;
+        }
+        case 1: {
+            fillHeader(message, data::COMPILE_SOURCE_RESPONSE, i);
+            auto *response = message.mutable_compile_response();
+            response->set_success(true);
+            response->set_ir_code_id("ir-" + std::to_string(i));
+            for (int w = 0; w < 5; ++w) {
+                response->add_warnings(std::string(80, 'w'));
+            }
+            break;
+        }
+        case 2:
+            fillHeader(message, data::HEARTBEAT, i);
+            message.mutable_heartbeat()->set_server_time(1700000000000);
+            break;
+        default: {
+            fillHeader(message, data::NOTIFICATION, i);
+            auto *notification = message.mutable_notification();
+            notification->set_type(data::Notification::ORDER_STATUS_CHANGE);
+            notification->set_content(std::string(200, 'n'));
+            notification->set_create_time(1700000000000);
+            break;
+        }
+        }
+        appendFrame(block, message);
+    }
+    return block;
+}
+
+} // namespace
+
+void runInboundBenchmarks(bench::Reporter &reporter)
+{
+    const int framesPerBlock = 256;
+    const int repeats = 4000;
+    const QByteArray block = buildNotificationHeavyBlock(framesPerBlock);
+    const qint64 frames = qint64(framesPerBlock) * repeats;
+    const qint64 bytes = qint64(block.size()) * repeats;
+
+    // 每帧一个堆上的 MessageFrame，分发时再拷贝一份（旧版信号传递的等价开销）
+    FrameDecoder heapDecoder;
+    bench::Measurement m = bench::measure([&]() {
+        for (int r = 0; r < repeats; ++r) {
+            heapDecoder.append(block.constData(), block.size());
+            const char *frameData = nullptr;
+            quint32 frameSize = 0;
+            while (heapDecoder.nextFrame(frameData, frameSize)) {
+                data::MessageFrame message;
+                message.ParseFromArray(frameData, int(frameSize));
+                data::MessageFrame dispatched(message);
+                bench::doNotOptimize(dispatched);
+            }
+        }
+    });
+    reporter.report("inbound/heap_parse_copy", frames, bytes, m);
+
+    // 每批帧共享一个 Arena，按引用分发，分发完整体 reset
+    FrameDecoder arenaDecoder;
+    InboundBatch batch;
+    m = bench::measure([&]() {
+        for (int r = 0; r < repeats; ++r) {
+            arenaDecoder.append(block.constData(), block.size());
+            const char *frameData = nullptr;
+            quint32 frameSize = 0;
+            while (arenaDecoder.nextFrame(frameData, frameSize)) {
+                data::MessageFrame *message = batch.createFrame();
+                message->ParseFromArray(frameData, int(frameSize));
+                batch.append(message);
+            }
+            for (const data::MessageFrame *message : batch.frames()) {
+                bench::doNotOptimize(*message);
+            }
+            batch.reset();
+        }
+    });
+    reporter.report("inbound/arena_batch", frames, bytes, m);
+}
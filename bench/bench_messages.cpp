@@ -0,0 +1,222 @@
+#include "benchutil.h"
+#include "protoc/data_proto.pb.h"
+#include <QString>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 每种消息体的序列化/解析开销，字段取接近真实流量的大小。
+// 解析分两种：每次新建消息，以及复用同一个消息对象（protobuf 会保留已分配的字符串容量）。
+namespace {
+
+void fillHeader(data::MessageFrame &message, data::RequestType type)
+{
+    auto *header = message.mutable_header();
+    header->set_request_id("8c5f2f0e-7c1b-4d8e-9a3f-2b6d1e0c9a71");
+    header->set_client_id("ProtoClientTester");
+    header->set_timestamp(1700000000000);
+    header->set_type(type);
+    header->set_auth_token("3f1c2d4e-5a6b-4c7d-8e9f-a0b1c2d3e4f5");
+}
+
+std::string makeText(size_t bytes, char fill)
+{
+    return std::string(bytes, fill);
+}
+
+void makeLoginRequest(data::MessageFrame &message)
+{
+    fillHeader(message, data::LOGIN_REQUEST);
+    auto *request = message.mutable_login_request();
+    request->set_username("loadtest-user-0042");
+    request->set_password_hash(makeText(64, 'a'));
+    request->set_device_info("Linux x86_64 / Qt 6.5");
+    request->set_app_version("1.0.0");
+}
+
+void makeLoginResponse(data::MessageFrame &message)
+{
+    fillHeader(message, data::LOGIN_RESPONSE);
+    auto *response = message.mutable_login_response();
+    response->set_success(true);
+    response->set_session_id("3f1c2d4e-5a6b-4c7d-8e9f-a0b1c2d3e4f5");
+    response->set_expire_time(1700003600);
+    response->set_user_nickname("压测用户 42");
+    response->set_user_role(2);
+}
+
+void makeHeartbeat(data::MessageFrame &message)
+{
+    fillHeader(message, data::HEARTBEAT);
+    auto *heartbeat = message.mutable_heartbeat();
+    heartbeat->set_last_active_time(1700000000000);
+    heartbeat->set_server_time(1700000000001);
+    heartbeat->set_connection_status("OK");
+}
+
+void makeErrorResponse(data::MessageFrame &message)
+{
+    fillHeader(message, data::ERROR_RESPONSE);
+    auto *error = message.mutable_error_response();
+    error->set_message("INTERNAL_ERROR");
+    error->set_detail(makeText(128, 'd'));
+    error->set_solution(makeText(64, 's'));
+    error->set_request_type("COMPILE_SOURCE_REQUEST");
+}
+
+void makeNotification(data::MessageFrame &message)
+{
+    fillHeader(message, data::NOTIFICATION);
+    auto *notification = message.mutable_notification();
+    notification->set_type(data::Notification_NotifyType_ORDER_STATUS_CHANGE);
+    notification->set_content(makeText(256, 'n'));
+    notification->set_create_time(1700000000000);
+    notification->set_need_ack(true);
+}
+
+void makeCompileRequest(data::MessageFrame &message)
+{
+    fillHeader(message, data::COMPILE_SOURCE_REQUEST);
+    auto *request = message.mutable_compile_request();
+    request->set_code_id("code-8c5f2f0e");
+    request->set_compiler_options("-O2 -fno-exceptions");
+    request->set_optimize(true);
+    request->set_target_ir_version("llvm-17");
+}
+
+void makeBatch(data::MessageFrame &message)
+{
+    fillHeader(message, data::BATCH_REQUEST);
+    auto *batch = message.mutable_batch();
+    for (int i = 0; i < 16; ++i) {
+        makeCompileRequest(*batch->add_sub_requests());
+    }
+}
+
+void makeSaveRequest(data::MessageFrame &message, size_t sourceBytes)
+{
+    fillHeader(message, data::SAVE_SOURCE_CODE_REQUEST);
+    auto *request = message.mutable_save_source_request();
+    request->set_code_id("code-8c5f2f0e");
+    request->set_language("cpp");
+    request->set_source_code(makeText(sourceBytes, 'c'));
+    request->set_code_name("kernel.cpp");
+    request->set_description("load test source");
+    (*request->mutable_metadata())["author"] = "bench";
+    (*request->mutable_metadata())["project"] = "ProtoClientTester";
+}
+
+void makeSaveResponse(data::MessageFrame &message)
+{
+    fillHeader(message, data::SAVE_SOURCE_CODE_RESPONSE);
+    auto *response = message.mutable_save_source_response();
+    response->set_success(true);
+    response->set_code_id("code-8c5f2f0e");
+    response->set_message("saved");
+    response->set_save_time(1700000000000);
+}
+
+void makeCompileResponse(data::MessageFrame &message)
+{
+    fillHeader(message, data::COMPILE_SOURCE_RESPONSE);
+    auto *response = message.mutable_compile_response();
+    response->set_success(true);
+    response->set_ir_code_id("ir-8c5f2f0e");
+    response->set_message("compiled");
+    response->set_compile_time(1700000000000);
+    response->set_compile_duration(42);
+    for (int i = 0; i < 4; ++i) {
+        response->add_warnings(makeText(80, 'w'));
+    }
+}
+
+void makeExecuteRequest(data::MessageFrame &message)
+{
+    fillHeader(message, data::EXECUTE_IR_REQUEST);
+    auto *request = message.mutable_execute_ir_request();
+    request->set_ir_code_id("ir-8c5f2f0e");
+    request->set_mode(data::ExecuteIRCodeRequest_ExecutionMode_JIT);
+    for (int i = 0; i < 4; ++i) {
+        (*request->mutable_parameters())["arg" + std::to_string(i)] = std::to_string(1000 + i);
+    }
+    request->set_timeout(30);
+}
+
+void makeExecuteResponse(data::MessageFrame &message)
+{
+    fillHeader(message, data::EXECUTE_IR_RESPONSE);
+    auto *response = message.mutable_execute_ir_response();
+    response->set_success(true);
+    response->set_execution_result(makeText(1024, 'r'));
+    response->set_start_time(1700000000000);
+    response->set_end_time(1700000000042);
+    response->set_execution_duration(42);
+    response->set_execution_mode_used("JIT");
+}
+
+void runCase(bench::Reporter &reporter, const QString &label, const data::MessageFrame &message, int iterations)
+{
+    const std::string wire = message.SerializeAsString();
+    const qint64 bytes = qint64(wire.size()) * iterations;
+
+    // 序列化到复用的缓冲区，只量编码本身
+    std::string buffer;
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            message.SerializeToString(&buffer);
+            bench::doNotOptimize(buffer);
+        }
+    });
+    reporter.report("messages/serialize/" + label, iterations, bytes, m);
+
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            data::MessageFrame parsed;
+            parsed.ParseFromArray(wire.data(), int(wire.size()));
+            bench::doNotOptimize(parsed);
+        }
+    });
+    reporter.report("messages/parse_fresh/" + label, iterations, bytes, m);
+
+    data::MessageFrame reused;
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            reused.ParseFromArray(wire.data(), int(wire.size()));
+            bench::doNotOptimize(reused);
+        }
+    });
+    reporter.report("messages/parse_reused/" + label, iterations, bytes, m);
+}
+
+} // namespace
+
+void runMessageBenchmarks(bench::Reporter &reporter)
+{
+    struct Case
+    {
+        const char *label;
+        std::function<void(data::MessageFrame &)> build;
+        int iterations;
+    };
+    const std::vector<Case> cases = {
+        {"login_request", makeLoginRequest, 200000},
+        {"login_response", makeLoginResponse, 200000},
+        {"heartbeat", makeHeartbeat, 500000},
+        {"error_response", makeErrorResponse, 200000},
+        {"notification", makeNotification, 200000},
+        {"batch_16", makeBatch, 20000},
+        {"save_source_request_4KB", [](data::MessageFrame &m) { makeSaveRequest(m, 4 * 1024); }, 50000},
+        {"save_source_request_256KB", [](data::MessageFrame &m) { makeSaveRequest(m, 256 * 1024); }, 1000},
+        {"save_source_response", makeSaveResponse, 200000},
+        {"compile_request", makeCompileRequest, 200000},
+        {"compile_response", makeCompileResponse, 200000},
+        {"execute_ir_request", makeExecuteRequest, 200000},
+        {"execute_ir_response", makeExecuteResponse, 200000},
+    };
+
+    for (const Case &c : cases) {
+        data::MessageFrame message;
+        c.build(message);
+        runCase(reporter, QString::fromLatin1(c.label), message, c.iterations);
+    }
+}
@@ -0,0 +1,268 @@
+#include "benchutil.h"
+#include "bufferpool.h"
+#include "pendingrequesttable.h"
+#include "preparedrequest.h"
+#include "protoclient.h"
+#include "protoutil.h"
+#include "requestbatcher.h"
+#include "requestidgenerator.h"
+#include "sessioncontext.h"
+#include "sessionmanager.h"
+#include "protoc/data_proto.pb.h"
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 每个请求都要走的请求头路径：生成 request_id、在途表登记和查找，以及 ProtoClient::createBaseMessage 整体。
+// 已登录时 createBaseMessage 从会话快照里拷贝预编码的 auth_token，不再做字符串转换。
+namespace {
+
+void runRequestId(bench::Reporter &reporter, int iterations)
+{
+    SessionManager &session = SessionManager::instance();
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            const QString id = session.generateRequestId();
+            bench::doNotOptimize(id);
+        }
+    });
+    reporter.report("session/generate_request_id", iterations, 0, m);
+
+    // 请求头里最终要的是 std::string
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            const std::string id = session.generateRequestId().toStdString();
+            bench::doNotOptimize(id);
+        }
+    });
+    reporter.report("session/generate_request_id_std_string", iterations, 0, m);
+
+    // 紧凑格式：前缀 + 计数，直接得到 std::string
+    RequestIdGenerator generator;
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            const std::string id = generator.next();
+            bench::doNotOptimize(id);
+        }
+    });
+    reporter.report("session/request_id_compact", iterations, 0, m);
+}
+
+// 在途表保持 inFlight 个请求：每次登记一个新请求并完成最早的一个，对比 UUID（字符串哈希）和紧凑 ID（整数开放寻址）
+void runPendingTable(bench::Reporter &reporter, RequestIdFormat format, const char *label, int iterations)
+{
+    constexpr int kInFlight = 1024;
+    RequestIdGenerator generator(format);
+    std::vector<std::string> ids(size_t(iterations) + kInFlight);
+    for (std::string &id : ids) {
+        id = generator.next();
+    }
+    std::vector<data::MessageFrame> responses(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        responses[i].mutable_header()->set_request_id(ids[i]);
+        responses[i].mutable_header()->set_type(data::EXECUTE_IR_RESPONSE);
+    }
+
+    PendingRequestTable table(10, kInFlight);
+    for (int i = 0; i < kInFlight; ++i) {
+        table.add(ids[size_t(i)], 0);
+    }
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            table.add(ids[size_t(i + kInFlight)], 0);
+            table.complete(responses[size_t(i)]);
+        }
+    });
+    reporter.report(QString("session/pending_add_complete/") + label, iterations, 0, m);
+}
+
+void runBaseMessage(bench::Reporter &reporter, const char *label, int iterations)
+{
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            data::MessageFrame message = ProtoClient::createBaseMessage(data::COMPILE_SOURCE_REQUEST);
+            bench::doNotOptimize(message);
+        }
+    });
+    reporter.report(QString("session/create_base_message/") + label, iterations, 0, m);
+}
+
+// 同一个执行请求反复发送：每次完整构造并编码，对比从预编码模板拷贝后写入 request_id/时间戳/auth_token。
+// 两边都计入生成 request_id，帧都写进池化缓冲区
+void runPrepared(bench::Reporter &reporter, int iterations)
+{
+    const QString irCodeId = "ir-8c5f2f0e";
+    QMap<QString, QString> parameters;
+    for (int i = 0; i < 4; ++i) {
+        parameters.insert(QString("arg%1").arg(i), QString::number(1000 + i));
+    }
+    BufferPool pool;
+    SessionManager &session = SessionManager::instance();
+
+    auto buildMessage = [&]() {
+        data::MessageFrame message = ProtoClient::createBaseMessage(data::EXECUTE_IR_REQUEST);
+        auto *request = message.mutable_execute_ir_request();
+        assignUtf8(request->mutable_ir_code_id(), irCodeId);
+        request->set_mode(data::ExecuteIRCodeRequest_ExecutionMode_JIT);
+        request->set_timeout(30);
+        auto &fields = *request->mutable_parameters();
+        for (auto it = parameters.constBegin(); it != parameters.constEnd(); ++it) {
+            assignUtf8(&fields[it.key().toStdString()], it.value());
+        }
+        return message;
+    };
+
+    qint64 frameBytes = 0;
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            data::MessageFrame message = buildMessage();
+            QByteArray frame;
+            encodeFrame(message, pool, frame);
+            frameBytes = frame.size();
+            pool.release(std::move(frame));
+        }
+    });
+    reporter.report("session/execute_build_and_encode", iterations, frameBytes * iterations, m);
+
+    // 与 ProtoClient::prepareRequest 相同：按 request_id 长度和当前 auth_token 预留
+    const std::string authToken = session.isLoggedIn() ? session.sessionId().toStdString() : std::string();
+    const PreparedRequest prepared(buildMessage(), session.defaultContext().requestIdSize(), authToken, 35000);
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            const std::string requestId = session.defaultContext().nextRequestId();
+            QByteArray frame = pool.acquire(prepared.frameSize(qsizetype(requestId.size()),
+                                                               qsizetype(authToken.size())));
+            prepared.writeFrame(frame.data(), requestId, QDateTime::currentMSecsSinceEpoch(), authToken);
+            pool.release(std::move(frame));
+        }
+    });
+    reporter.report("session/execute_prepared", iterations, frameBytes * iterations, m);
+}
+
+// 登录风暴：反复登录和续期默认会话，每次都会触发持久化（后写，只更新内存里的待写表）
+void runLoginStorm(bench::Reporter &reporter, int iterations)
+{
+    SessionManager &session = SessionManager::instance();
+    data::LoginResponse login;
+    login.set_success(true);
+    login.set_user_nickname("loadtest");
+    login.set_expire_time(quint64(QDateTime::currentSecsSinceEpoch() + 3600));
+
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            login.set_session_id(std::to_string(i));
+            session.login(login);
+            session.updateSession(QString::number(i), login.expire_time() + 60);
+        }
+    });
+    reporter.report("session/login_and_renew", iterations, 0, m);
+
+    m = bench::measure([&]() {
+        session.flush();
+    });
+    reporter.report("session/flush_settings", 1, 0, m);
+}
+
+// 发送线程读会话状态：单独读，以及另一个线程不停续期（发布新版本）时读。读取方不加锁，续期不会让读取方等待
+void runSnapshotRead(bench::Reporter &reporter, int iterations)
+{
+    SessionContext context;
+    data::LoginResponse login;
+    login.set_success(true);
+    login.set_session_id("3f1c2d4e-5a6b-4c7d-8e9f-a0b1c2d3e4f5");
+    login.set_expire_time(quint64(QDateTime::currentSecsSinceEpoch() + 3600));
+    context.login(login);
+
+    auto readLoop = [&]() {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (int i = 0; i < iterations; ++i) {
+            const SessionContext::Snapshot state = context.snapshot();
+            bench::doNotOptimize(state->authTokenAt(now).size());
+        }
+    };
+
+    bench::Measurement m = bench::measure(readLoop);
+    reporter.report("session/snapshot_read", iterations, 0, m);
+
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        quint64 expire = login.expire_time();
+        while (!stop.load(std::memory_order_relaxed)) {
+            context.updateSession(QString::fromStdString(login.session_id()), ++expire);
+        }
+    });
+    m = bench::measure(readLoop);
+    stop.store(true);
+    writer.join();
+    reporter.report("session/snapshot_read_during_renew", iterations, 0, m);
+}
+
+// 批量发送的编码开销：64 个编译请求逐个编码成帧，对比合成一个 BatchRequest 编码成一帧（见 RequestBatcher）。
+// 按请求计 ns/op；逐帧发送时每帧还要各自入队和唤醒写线程，这里没有计入
+void runBatchEncode(bench::Reporter &reporter, int iterations)
+{
+    constexpr int kBatchSize = RequestBatcher::kDefaultMaxRequests;
+    std::vector<data::MessageFrame> requests(kBatchSize);
+    data::MessageFrame batch = ProtoClient::createBaseMessage(data::BATCH_REQUEST);
+    for (int i = 0; i < kBatchSize; ++i) {
+        requests[size_t(i)] = ProtoClient::createBaseMessage(data::COMPILE_SOURCE_REQUEST);
+        auto *request = requests[size_t(i)].mutable_compile_request();
+        request->set_code_id("loadtest-code-" + std::to_string(i));
+        request->set_optimize(true);
+        *batch.mutable_batch()->add_sub_requests() = requests[size_t(i)];
+    }
+    BufferPool pool;
+
+    qint64 bytes = 0;
+    bench::Measurement m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            for (const data::MessageFrame &request : requests) {
+                QByteArray frame;
+                encodeFrame(request, pool, frame);
+                bytes += frame.size();
+                pool.release(std::move(frame));
+            }
+        }
+    });
+    reporter.report("session/encode_frames/single", qint64(iterations) * kBatchSize, bytes, m);
+
+    bytes = 0;
+    m = bench::measure([&]() {
+        for (int i = 0; i < iterations; ++i) {
+            QByteArray frame;
+            encodeFrame(batch, pool, frame);
+            bytes += frame.size();
+            pool.release(std::move(frame));
+        }
+    });
+    reporter.report("session/encode_frames/batch64", qint64(iterations) * kBatchSize, bytes, m);
+}
+
+} // namespace
+
+void runSessionBenchmarks(bench::Reporter &reporter)
+{
+    runRequestId(reporter, 200000);
+    runPendingTable(reporter, RequestIdFormat::Uuid, "uuid", 200000);
+    runPendingTable(reporter, RequestIdFormat::Compact, "compact", 200000);
+
+    SessionManager &session = SessionManager::instance();
+    session.logout();
+    runBaseMessage(reporter, "logged_out", 200000);
+
+    data::LoginResponse login;
+    login.set_success(true);
+    login.set_session_id("3f1c2d4e-5a6b-4c7d-8e9f-a0b1c2d3e4f5");
+    login.set_expire_time(quint64(QDateTime::currentSecsSinceEpoch() + 3600));
+    session.login(login);
+    runBaseMessage(reporter, "logged_in", 200000);
+    runPrepared(reporter, 200000);
+    runLoginStorm(reporter, 20000);
+    runSnapshotRead(reporter, 1000000);
+    runBatchEncode(reporter, 5000);
+    session.logout();
+}
@@ -0,0 +1,79 @@
+#include "benchutil.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <google/protobuf/stubs/common.h>
+
+void runFramingBenchmarks(bench::Reporter &reporter);
+void runInboundBenchmarks(bench::Reporter &reporter);
+void runBuilderBenchmarks(bench::Reporter &reporter);
+void runMessageBenchmarks(bench::Reporter &reporter);
+void runSessionBenchmarks(bench::Reporter &reporter);
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("protoclient_bench");
+
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ProtoClientTester protocol hot-path microbenchmarks");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"json", "Also write all results as JSON to this file.", "file"},
+        {"suite", "Run only these suites (comma separated): framing, inbound, builders, messages, session.",
+         "names"},
+    });
+    parser.process(app);
+
+    // 会话基准会登录/登出 SessionManager，让它的 QSettings 写到测试目录而不是用户配置
+    QStandardPaths::setTestModeEnabled(true);
+
+    const QStringList suites = parser.value("suite").split(',', Qt::SkipEmptyParts);
+    auto enabled = [&suites](const char *name) {
+        return suites.isEmpty() || suites.contains(QLatin1String(name));
+    };
+
+    bench::Reporter reporter;
+    if (enabled("framing")) {
+        runFramingBenchmarks(reporter);
+    }
+    if (enabled("inbound")) {
+        runInboundBenchmarks(reporter);
+    }
+    if (enabled("builders")) {
+        runBuilderBenchmarks(reporter);
+    }
+    if (enabled("messages")) {
+        runMessageBenchmarks(reporter);
+    }
+    if (enabled("session")) {
+        runSessionBenchmarks(reporter);
+    }
+
+    int result = 0;
+    if (parser.isSet("json")) {
+        QFile file(parser.value("json"));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QJsonObject document{
+                {"timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+                {"qt_version", QString::fromLatin1(qVersion())},
+                {"protobuf_version", QString::fromStdString(google::protobuf::internal::VersionString(
+                                         GOOGLE_PROTOBUF_VERSION))},
+                {"results", reporter.toJson()},
+            };
+            file.write(QJsonDocument(document).toJson());
+        } else {
+            QTextStream(stderr) << "无法写入 " << file.fileName() << Qt::endl;
+            result = 1;
+        }
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return result;
+}
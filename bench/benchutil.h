@@ -0,0 +1,115 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+#include <cstdio>
+#include <utility>
+
+namespace bench {
+
+// 由 allocationcounter.cpp 中替换的全局 operator new 统计
+struct AllocationStats
+{
+    quint64 count = 0;
+    quint64 bytes = 0;
+};
+
+AllocationStats allocationStats();
+
+struct Measurement
+{
+    qint64 elapsedNs = 0;
+    AllocationStats allocations;
+};
+
+struct Result
+{
+    QString name;
+    qint64 ops = 0;
+    qint64 bytes = 0;
+    double nsPerOp = 0;
+    double opsPerSec = 0;
+    double mbPerSec = 0;
+    double allocsPerOp = 0;
+    double allocBytesPerOp = 0;
+};
+
+// 统一输出格式：每个用例一行，ns/op、吞吐以及每次操作的分配次数/字节数。
+// 结果同时保留下来，结束时可以整体导出成 JSON 供回归对比
+class Reporter
+{
+public:
+    void report(const QString &name, qint64 ops, qint64 bytes, const Measurement &m)
+    {
+        Result result;
+        result.name = name;
+        result.ops = ops;
+        result.bytes = bytes;
+        const double seconds = double(m.elapsedNs) / 1e9;
+        result.nsPerOp = ops > 0 ? double(m.elapsedNs) / double(ops) : 0.0;
+        result.opsPerSec = seconds > 0 ? double(ops) / seconds : 0.0;
+        result.mbPerSec = seconds > 0 ? double(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+        result.allocsPerOp = ops > 0 ? double(m.allocations.count) / double(ops) : 0.0;
+        result.allocBytesPerOp = ops > 0 ? double(m.allocations.bytes) / double(ops) : 0.0;
+        std::printf("%-48s %12.1f ns/op %14.0f op/s %10.1f MB/s %8.2f allocs/op %12.0f B/op\n",
+                    qPrintable(name), result.nsPerOp, result.opsPerSec, result.mbPerSec,
+                    result.allocsPerOp, result.allocBytesPerOp);
+        std::fflush(stdout);
+        m_results.append(result);
+    }
+
+    const QVector<Result> &results() const { return m_results; }
+
+    QJsonArray toJson() const
+    {
+        QJsonArray array;
+        for (const Result &result : m_results) {
+            array.append(QJsonObject{
+                {"name", result.name},
+                {"ops", result.ops},
+                {"bytes", result.bytes},
+                {"ns_per_op", result.nsPerOp},
+                {"ops_per_sec", result.opsPerSec},
+                {"mb_per_sec", result.mbPerSec},
+                {"allocs_per_op", result.allocsPerOp},
+                {"alloc_bytes_per_op", result.allocBytesPerOp},
+            });
+        }
+        return array;
+    }
+
+private:
+    QVector<Result> m_results;
+};
+
+template<typename Fn>
+Measurement measure(Fn &&fn)
+{
+    Measurement result;
+    const AllocationStats before = allocationStats();
+    QElapsedTimer timer;
+    timer.start();
+    std::forward<Fn>(fn)();
+    result.elapsedNs = timer.nsecsElapsed();
+    const AllocationStats after = allocationStats();
+    result.allocations.count = after.count - before.count;
+    result.allocations.bytes = after.bytes - before.bytes;
+    return result;
+}
+
+// 防止编译器把基准循环里的结果优化掉
+template<typename T>
+inline void doNotOptimize(const T &value)
+{
+    static const void *volatile sink;
+    sink = &value;
+}
+
+} // namespace bench
+
+#endif // BENCHUTIL_H
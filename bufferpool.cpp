@@ -0,0 +1,89 @@
+#include "bufferpool.h"
+#include <google/protobuf/message_lite.h>
+#include <QtEndian>
+#include <limits>
+
+BufferPool::BufferPool(size_t maxBuffersPerClass)
+    : m_maxBuffersPerClass(maxBuffersPerClass) {
+}
+
+QByteArray BufferPool::acquire(qsizetype size) {
+    const int index = classFor(size);
+    if (index < 0) {
+        return QByteArray(size, Qt::Uninitialized);
+    }
+
+    QByteArray buffer;
+    {
+        SizeClass &sizeClass = m_classes[index];
+        QMutexLocker locker(&sizeClass.mutex);
+        if (!sizeClass.buffers.empty()) {
+            buffer = std::move(sizeClass.buffers.back());
+            sizeClass.buffers.pop_back();
+        }
+    }
+
+    if (buffer.capacity() < kClassSizes[index]) {
+        buffer.reserve(kClassSizes[index]);
+    }
+    // 容量足够时 resize 只改长度，不重新分配
+    buffer.resize(size);
+    return buffer;
+}
+
+void BufferPool::release(QByteArray &&buffer) {
+    if (!buffer.isDetached()) {
+        return;
+    }
+
+    // 按容量归类：能装下某一级的上限才放回那一级
+    int index = -1;
+    for (int i = int(kClassSizes.size()) - 1; i >= 0; --i) {
+        if (buffer.capacity() >= kClassSizes[i]) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 || buffer.capacity() > 2 * kClassSizes.back()) {
+        return;
+    }
+
+    buffer.resize(0);
+    SizeClass &sizeClass = m_classes[index];
+    QMutexLocker locker(&sizeClass.mutex);
+    if (sizeClass.buffers.size() < m_maxBuffersPerClass) {
+        sizeClass.buffers.push_back(std::move(buffer));
+    }
+}
+
+size_t BufferPool::pooledCount() const {
+    size_t count = 0;
+    for (const SizeClass &sizeClass : m_classes) {
+        QMutexLocker locker(&sizeClass.mutex);
+        count += sizeClass.buffers.size();
+    }
+    return count;
+}
+
+int BufferPool::classFor(qsizetype size) {
+    for (size_t i = 0; i < kClassSizes.size(); ++i) {
+        if (size <= kClassSizes[i]) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+bool encodeFrame(const google::protobuf::MessageLite &message, BufferPool &pool, QByteArray &frame) {
+    const size_t size = message.ByteSizeLong();
+    if (size > size_t(std::numeric_limits<int>::max())) {
+        return false;
+    }
+
+    frame = pool.acquire(qsizetype(sizeof(quint32) + size));
+    uchar *out = reinterpret_cast<uchar *>(frame.data());
+    qToBigEndian<quint32>(quint32(size), out);
+    // ByteSizeLong() 已缓存各子消息大小，直接按缓存序列化，避免 SerializeToArray 再算一遍
+    uchar *end = message.SerializeWithCachedSizesToArray(out + sizeof(quint32));
+    return end == out + frame.size();
+}
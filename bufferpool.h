@@ -0,0 +1,49 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <array>
+#include <vector>
+
+namespace google::protobuf {
+class MessageLite;
+}
+
+// 按大小分级的出站缓冲池。缓冲区以 QByteArray 的形式交给 QTcpSocket::write()，
+// 套接字共享而不拷贝数据；写出后套接字释放引用，缓冲区回到池中复用。
+// acquire()/release() 线程安全，可以在发送线程和 I/O 线程同时调用。
+class BufferPool
+{
+public:
+    // 各级容量：4K、16K、64K、256K、1M；更大的帧单独分配、用完即释放
+    static constexpr std::array<qsizetype, 5> kClassSizes = {4 * 1024, 16 * 1024, 64 * 1024,
+                                                             256 * 1024, 1024 * 1024};
+
+    explicit BufferPool(size_t maxBuffersPerClass = 64);
+
+    // 返回 size() == size 的缓冲区，内容未初始化
+    QByteArray acquire(qsizetype size);
+    // 只有不再被其他 QByteArray 共享（isDetached）的缓冲区会被收回
+    void release(QByteArray &&buffer);
+
+    size_t pooledCount() const;
+
+private:
+    struct SizeClass
+    {
+        mutable QMutex mutex;
+        std::vector<QByteArray> buffers;
+    };
+
+    static int classFor(qsizetype size);
+
+    const size_t m_maxBuffersPerClass;
+    std::array<SizeClass, kClassSizes.size()> m_classes;
+};
+
+// 把消息编码为 4 字节大端长度前缀 + 负载的完整帧：
+// 前缀和负载直接写进池中取出的同一块缓冲区，只序列化一次，没有中间 std::string
+bool encodeFrame(const google::protobuf::MessageLite &message, BufferPool &pool, QByteArray &frame);
+
+#endif // BUFFERPOOL_H
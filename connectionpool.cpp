@@ -0,0 +1,222 @@
+#include "connectionpool.h"
+#include <QPromise>
+#include <QtAlgorithms>
+
+namespace {
+// 一个连接都没有时同步以 SERVICE_UNAVAILABLE 完成；回调和正常响应一样在 context 所属线程执行
+QFuture<data::MessageFrame> unavailable(QObject *context, const std::string &requestId,
+                                        const NetworkManager::ResponseCallback &callback) {
+    const data::MessageFrame response = NetworkManager::makeErrorResponse(
+        requestId, data::SERVICE_UNAVAILABLE, "未连接到服务器");
+    if (callback) {
+        if (QThread::currentThread() == context->thread()) {
+            callback(response);
+        } else {
+            QMetaObject::invokeMethod(context, [callback, response]() {
+                callback(response);
+            }, Qt::QueuedConnection);
+        }
+    }
+    QPromise<data::MessageFrame> promise;
+    promise.start();
+    promise.addResult(response);
+    promise.finish();
+    return promise.future();
+}
+}
+
+ConnectionPool::ConnectionPool(int connections, int ioThreads, QObject *parent)
+    : QObject(parent)
+      , m_connectedCount(0)
+      , m_nextConnection(0) {
+    connections = qMax(1, connections);
+    ioThreads = qBound(1, ioThreads, connections);
+
+    for (int i = 0; i < ioThreads; ++i) {
+        auto *thread = new QThread(this);
+        thread->setObjectName(QString("NetworkIO-%1").arg(i));
+        thread->start();
+        m_ioThreads.append(thread);
+    }
+
+    for (int i = 0; i < connections; ++i) {
+        auto *connection = new NetworkManager(m_ioThreads[i % ioThreads], this);
+        connect(connection, &NetworkManager::connected, this, &ConnectionPool::onConnectionUp);
+        connect(connection, &NetworkManager::disconnected, this, &ConnectionPool::onConnectionDown);
+        connect(connection, &NetworkManager::connectionError, this, &ConnectionPool::connectionError);
+        connect(connection, &NetworkManager::messageReceived, this, &ConnectionPool::messageReceived);
+        connect(connection, &NetworkManager::heartbeatReceived, this, &ConnectionPool::heartbeatReceived);
+        m_connections.append(connection);
+    }
+}
+
+ConnectionPool::~ConnectionPool() {
+    // 连接对象要在线程停止前销毁
+    qDeleteAll(m_connections);
+    m_connections.clear();
+    for (QThread *thread : std::as_const(m_ioThreads)) {
+        thread->quit();
+    }
+    for (QThread *thread : std::as_const(m_ioThreads)) {
+        thread->wait();
+    }
+}
+
+int ConnectionPool::connectToServer(const QString &host, quint16 port) {
+    QVector<QFuture<bool>> attempts;
+    attempts.reserve(m_connections.size());
+    for (NetworkManager *connection : std::as_const(m_connections)) {
+        attempts.append(connection->connectToServerAsync(host, port));
+    }
+
+    int connectedCount = 0;
+    for (QFuture<bool> &attempt : attempts) {
+        attempt.waitForFinished();
+        if (attempt.resultCount() > 0 && attempt.result()) {
+            ++connectedCount;
+        }
+    }
+    return connectedCount;
+}
+
+void ConnectionPool::disconnectFromServer() {
+    for (NetworkManager *connection : std::as_const(m_connections)) {
+        connection->disconnectFromServer();
+    }
+}
+
+bool ConnectionPool::isConnected() const {
+    for (const NetworkManager *connection : m_connections) {
+        if (connection->isConnected()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ConnectionPool::connectedCount() const {
+    int count = 0;
+    for (const NetworkManager *connection : m_connections) {
+        if (connection->isConnected()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void ConnectionPool::setAutoReconnect(bool enable, int interval) {
+    for (NetworkManager *connection : std::as_const(m_connections)) {
+        connection->setAutoReconnect(enable, interval);
+    }
+}
+
+void ConnectionPool::startCapture(const std::shared_ptr<TrafficCapture> &capture, quint16 firstStream) {
+    for (int i = 0; i < m_connections.size(); ++i) {
+        m_connections[i]->startCapture(capture, quint16(firstStream + i));
+    }
+}
+
+void ConnectionPool::stopCapture() {
+    for (NetworkManager *connection : std::as_const(m_connections)) {
+        connection->stopCapture();
+    }
+}
+
+NetworkManager *ConnectionPool::leastLoaded() const {
+    // 从轮转位置开始扫描，在途数相同时各连接轮流分到请求
+    const int count = m_connections.size();
+    const int start = int(m_nextConnection.fetch_add(1, std::memory_order_relaxed) % quint32(count));
+    NetworkManager *best = nullptr;
+    int bestPending = 0;
+    for (int i = 0; i < count; ++i) {
+        NetworkManager *connection = m_connections[(start + i) % count];
+        if (!connection->isConnected()) {
+            continue;
+        }
+        const int pending = connection->pendingCount();
+        if (!best || pending < bestPending) {
+            best = connection;
+            bestPending = pending;
+            if (pending == 0) {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+QFuture<data::MessageFrame> ConnectionPool::sendRequest(const data::MessageFrame &request,
+                                                        NetworkManager::ResponseCallback callback,
+                                                        int timeoutMs) {
+    if (NetworkManager *connection = leastLoaded()) {
+        return connection->sendRequest(request, std::move(callback), timeoutMs);
+    }
+    return unavailable(this, request.header().request_id(), callback);
+}
+
+QFuture<data::MessageFrame> ConnectionPool::sendPreparedRequest(const PreparedRequest &request,
+                                                                const std::string &requestId,
+                                                                const std::string &authToken,
+                                                                NetworkManager::ResponseCallback callback) {
+    if (NetworkManager *connection = leastLoaded()) {
+        return connection->sendPreparedRequest(request, requestId, authToken, std::move(callback));
+    }
+    return unavailable(this, requestId, callback);
+}
+
+QVector<QFuture<data::MessageFrame>> ConnectionPool::sendBatchRequest(const data::MessageFrame &batch,
+                                                                     QVector<NetworkManager::BatchEntry> entries) {
+    if (NetworkManager *connection = leastLoaded()) {
+        return connection->sendBatchRequest(batch, std::move(entries));
+    }
+    const auto &subRequests = batch.batch().sub_requests();
+    QVector<QFuture<data::MessageFrame>> futures;
+    futures.reserve(subRequests.size());
+    for (int i = 0; i < subRequests.size(); ++i) {
+        futures.append(unavailable(this, subRequests.Get(i).header().request_id(),
+                                   i < entries.size() ? entries[i].callback : NetworkManager::ResponseCallback()));
+    }
+    return futures;
+}
+
+int ConnectionPool::pendingCount() const {
+    int pending = 0;
+    for (const NetworkManager *connection : m_connections) {
+        pending += connection->pendingCount();
+    }
+    return pending;
+}
+
+void ConnectionPool::mergeLatencyInto(LatencyRecorder::Snapshot &snapshot) const {
+    for (const NetworkManager *connection : m_connections) {
+        connection->latencyRecorder().mergeInto(snapshot);
+    }
+}
+
+WriteStats ConnectionPool::writeStats() const {
+    WriteStats total;
+    for (const NetworkManager *connection : m_connections) {
+        const WriteStats stats = connection->writeStats();
+        total.frames += stats.frames;
+        total.writes += stats.writes;
+        total.bytes += stats.bytes;
+    }
+    return total;
+}
+
+void ConnectionPool::onConnectionUp() {
+    emit connectedCountChanged(++m_connectedCount);
+    if (m_connectedCount == 1) {
+        emit connected();
+    }
+}
+
+void ConnectionPool::onConnectionDown() {
+    if (m_connectedCount == 0) {
+        return;
+    }
+    emit connectedCountChanged(--m_connectedCount);
+    if (m_connectedCount == 0) {
+        emit disconnected();
+    }
+}
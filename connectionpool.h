@@ -0,0 +1,78 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QObject>
+#include <QFuture>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+#include "latencyrecorder.h"
+#include "networkmanager.h"
+#include "protoc/data_proto.pb.h"
+
+// 多连接池：K 个 NetworkManager 分摊到 T 个 I/O 线程上（第 i 个连接在第 i % T 个线程），
+// 每个线程有自己的事件循环。前端对象都属于连接池所在线程，响应和回调在这里完成。
+// 请求发往当前在途请求最少的已连接连接；某个连接连不上或断开时，其他连接照常收发。
+class ConnectionPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    ConnectionPool(int connections, int ioThreads, QObject *parent = nullptr);
+    ~ConnectionPool();
+
+    // 所有连接并行建立，全部有结果（连上、失败或超时）后返回连上的数量
+    int connectToServer(const QString &host, quint16 port);
+    void disconnectFromServer();
+    // 至少有一个连接可用
+    bool isConnected() const;
+    int connectedCount() const;
+    int size() const { return m_connections.size(); }
+    NetworkManager *connection(int index) const { return m_connections.at(index); }
+
+    void setAutoReconnect(bool enable, int interval = 5000);
+
+    // 所有连接写同一个抓包文件，第 i 个连接的连接号是 firstStream + i
+    void startCapture(const std::shared_ptr<TrafficCapture> &capture, quint16 firstStream = 0);
+    void stopCapture();
+
+    // 线程安全；在途请求最少的已连接连接，并列时轮流选取；一个都没连上时返回 nullptr
+    NetworkManager *leastLoaded() const;
+    // 线程安全；没有可用连接时 future 同步以 SERVICE_UNAVAILABLE 完成，回调仍在连接池所属线程执行
+    QFuture<data::MessageFrame> sendRequest(const data::MessageFrame &request,
+                                            NetworkManager::ResponseCallback callback = {},
+                                            int timeoutMs = NetworkManager::kDefaultRequestTimeoutMs);
+    // 线程安全；见 NetworkManager::sendPreparedRequest
+    QFuture<data::MessageFrame> sendPreparedRequest(const PreparedRequest &request, const std::string &requestId,
+                                                    const std::string &authToken,
+                                                    NetworkManager::ResponseCallback callback = {});
+    // 线程安全；见 NetworkManager::sendBatchRequest。整个批次发往同一个连接
+    QVector<QFuture<data::MessageFrame>> sendBatchRequest(const data::MessageFrame &batch,
+                                                          QVector<NetworkManager::BatchEntry> entries);
+    int pendingCount() const;
+
+    // 把各连接的延迟直方图累加进 snapshot
+    void mergeLatencyInto(LatencyRecorder::Snapshot &snapshot) const;
+    WriteStats writeStats() const;
+
+signals:
+    // 第一个连接建立时 / 最后一个连接断开时
+    void connected();
+    void disconnected();
+    void connectedCountChanged(int count);
+    void connectionError(const QString &error);
+    void messageReceived(const data::MessageFrame &message);
+    void heartbeatReceived();
+
+private:
+    void onConnectionUp();
+    void onConnectionDown();
+
+    QVector<QThread *> m_ioThreads;
+    QVector<NetworkManager *> m_connections;
+    int m_connectedCount;
+    mutable std::atomic<quint32> m_nextConnection;
+};
+
+#endif // CONNECTIONPOOL_H
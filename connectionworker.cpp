@@ -0,0 +1,443 @@
+#include "connectionworker.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QtEndian>
+#include <utility>
+
+namespace {
+// 单个批次最多容纳的帧数，避免一次读取把一个 Arena 撑得过大
+constexpr size_t kMaxFramesPerBatch = 1024;
+// 套接字写缓冲的高/低水位：超过高水位停止从出站队列取帧，回落到低水位后恢复
+constexpr qint64 kWriteHighWatermark = 4 * 1024 * 1024;
+constexpr qint64 kWriteLowWatermark = 1024 * 1024;
+// 小于该大小的帧参与合并；合并块的上限
+constexpr qsizetype kCoalesceThreshold = 16 * 1024;
+constexpr qsizetype kCoalesceBufferSize = 64 * 1024;
+// 建立连接的超时时间
+constexpr int kConnectTimeoutMs = 5000;
+}
+
+ConnectionWorker::ConnectionWorker(SpscQueue<InboundBatch *> *inbound,
+                                   SpscQueue<InboundBatch *> *recycled,
+                                   MpscQueue<QByteArray> *outbound,
+                                   BufferPool *bufferPool,
+                                   LatencyRecorder *latency,
+                                   QObject *parent)
+    : QObject(parent)
+      , m_inbound(inbound)
+      , m_recycled(recycled)
+      , m_outbound(outbound)
+      , m_bufferPool(bufferPool)
+      , m_latency(latency)
+      , m_heartbeatSentNs(-1)
+      , m_writeBlocked(false)
+      , m_spareBatch(nullptr)
+      , m_socket(new QTcpSocket(this))
+      , m_heartbeatTimer(new QTimer(this))
+      , m_reconnectTimer(new QTimer(this))
+      , m_connectTimer(new QTimer(this))
+      , m_port(0)
+      , m_autoReconnect(false)
+      , m_connecting(false)
+      , m_connected(false)
+      , m_flushScheduled(false)
+      , m_framesSignalled(false)
+      , m_readPaused(false)
+      , m_framesWritten(0)
+      , m_socketWrites(0)
+      , m_bytesWritten(0) {
+    connect(m_socket, &QTcpSocket::connected, this, &ConnectionWorker::onConnected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &ConnectionWorker::onDisconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &ConnectionWorker::onReadyRead);
+    connect(m_socket, &QTcpSocket::errorOccurred, this, &ConnectionWorker::onErrorOccurred);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &ConnectionWorker::onBytesWritten);
+
+    // 入站队列满时停止读取，限制套接字自身的缓冲，让 TCP 流控生效
+    m_socket->setReadBufferSize(1024 * 1024);
+
+    m_heartbeatClock.start();
+    m_heartbeatTimer->setInterval(30000);
+    connect(m_heartbeatTimer, &QTimer::timeout, this, &ConnectionWorker::onHeartbeatTimeout);
+
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, [this]() {
+        qInfo() << "Attempting to reconnect to server...";
+        beginConnect(m_host, m_port);
+    });
+
+    m_connectTimer->setSingleShot(true);
+    m_connectTimer->setInterval(kConnectTimeoutMs);
+    connect(m_connectTimer, &QTimer::timeout, this, [this]() {
+        qWarning() << "Connection to" << m_host << "timed out";
+        m_socket->abort();
+        emit connectionError("连接超时");
+        finishConnect(false);
+    });
+}
+
+ConnectionWorker::~ConnectionWorker() {
+    shutdown();
+    m_capture.detach();
+    delete m_spareBatch;
+}
+
+void ConnectionWorker::shutdown() {
+    // 不再重连，停掉所有定时器，断开连接并丢弃还没写出的帧
+    m_autoReconnect = false;
+    m_reconnectTimer->stop();
+    if (m_connecting) {
+        finishConnect(false);
+    }
+    disconnectFromServer();
+
+    recycleWrittenBuffers();
+    m_inFlight.clear();
+    m_bufferPool->release(std::move(m_staged));
+    m_staged = QByteArray();
+    QByteArray frame;
+    while (m_outbound->tryPop(frame)) {
+        m_bufferPool->release(std::move(frame));
+    }
+}
+
+bool ConnectionWorker::isConnected() const {
+    return m_connected.load(std::memory_order_acquire);
+}
+
+void ConnectionWorker::scheduleFlush() {
+    // 多次发送只投递一次 flush 事件
+    if (!m_flushScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, &ConnectionWorker::flushOutbound, Qt::QueuedConnection);
+    }
+}
+
+void ConnectionWorker::beginConsume() {
+    m_framesSignalled.store(false);
+}
+
+void ConnectionWorker::endConsume() {
+    // 消费端腾出了空间，恢复被入站队列暂停的读取
+    if (m_readPaused.exchange(false)) {
+        QMetaObject::invokeMethod(this, &ConnectionWorker::onReadyRead, Qt::QueuedConnection);
+    }
+}
+
+WriteStats ConnectionWorker::writeStats() const {
+    WriteStats stats;
+    stats.frames = m_framesWritten.load(std::memory_order_relaxed);
+    stats.writes = m_socketWrites.load(std::memory_order_relaxed);
+    stats.bytes = m_bytesWritten.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ConnectionWorker::beginConnect(const QString &host, quint16 port, ConnectCallback done) {
+    if (m_socket->state() == QAbstractSocket::ConnectedState) {
+        if (done) {
+            done(true);
+        }
+        return;
+    }
+    // 上一次尝试还没有结果时作废它，以本次为准
+    if (m_connecting) {
+        finishConnect(false);
+    }
+    m_reconnectTimer->stop();
+    m_socket->abort();
+
+    m_host = host;
+    m_port = port;
+    m_connectDone = std::move(done);
+    m_connecting = true;
+    m_connectTimer->start();
+    m_socket->connectToHost(host, port);
+}
+
+void ConnectionWorker::setCapture(std::shared_ptr<TrafficCapture> capture, quint16 stream) {
+    if (capture) {
+        m_capture.attach(std::move(capture), stream);
+    } else {
+        m_capture.detach();
+    }
+}
+
+void ConnectionWorker::finishConnect(bool connected) {
+    m_connecting = false;
+    m_connectTimer->stop();
+    if (ConnectCallback done = std::exchange(m_connectDone, {})) {
+        done(connected);
+    }
+    if (!connected && m_autoReconnect) {
+        m_reconnectTimer->start();
+    }
+}
+
+void ConnectionWorker::disconnectFromServer() {
+    stopHeartbeatTimer();
+    m_socket->disconnectFromHost();
+    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+        m_socket->waitForDisconnected(1000);
+    }
+}
+
+void ConnectionWorker::setAutoReconnect(bool enable, int interval) {
+    m_autoReconnect = enable;
+    if (enable) {
+        m_reconnectTimer->setInterval(interval);
+    } else {
+        m_reconnectTimer->stop();
+    }
+}
+
+void ConnectionWorker::onConnected() {
+    qInfo() << "Connected to server";
+    m_decoder.reset();
+    m_connected.store(true, std::memory_order_release);
+    startHeartbeatTimer();
+    emit connected();
+    finishConnect(true);
+}
+
+void ConnectionWorker::onDisconnected() {
+    qInfo() << "Disconnected from server";
+    m_connected.store(false, std::memory_order_release);
+    m_decoder.reset();
+    stopHeartbeatTimer();
+    m_heartbeatSentNs = -1;
+
+    // 断开时套接字已丢弃写缓冲，在途帧全部回收；还没出队的帧随连接作废
+    recycleWrittenBuffers();
+    m_inFlight.clear();
+    m_bufferPool->release(std::move(m_staged));
+    m_staged = QByteArray();
+    QByteArray frame;
+    while (m_outbound->tryPop(frame)) {
+        m_bufferPool->release(std::move(frame));
+    }
+    if (m_writeBlocked) {
+        m_writeBlocked = false;
+        emit backpressureChanged(false);
+    }
+
+    m_capture.flush();
+    emit disconnected();
+
+    if (m_autoReconnect) {
+        m_reconnectTimer->start();
+    }
+}
+
+void ConnectionWorker::onReadyRead() {
+    if (m_readPaused.load()) {
+        return;
+    }
+
+    m_decoder.readFrom(m_socket);
+
+    bool produced = false;
+    bool drained = false;
+    const char *frameData = nullptr;
+    quint32 frameSize = 0;
+    while (!drained) {
+        if (m_inbound->isFull()) {
+            // 入站队列满：暂停读取，等消费端 endConsume() 后再继续
+            m_readPaused.store(true);
+            if (m_inbound->isFull()) {
+                break;
+            }
+            m_readPaused.store(false);
+        }
+
+        InboundBatch *batch = takeBatch();
+        while (batch->size() < kMaxFramesPerBatch) {
+            if (!m_decoder.nextFrame(frameData, frameSize)) {
+                drained = true;
+                break;
+            }
+
+            if (m_capture.isActive()) {
+                m_capture.record(CaptureDirection::Inbound, frameData, frameSize);
+            }
+
+            // 帧及其子消息都分配在批次的 Arena 上，分发后随批次整体释放
+            data::MessageFrame *message = batch->createFrame();
+            if (!message->ParseFromArray(frameData, static_cast<int>(frameSize))) {
+                qWarning() << "Failed to parse message";
+                continue;
+            }
+
+            if (message->header().type() == data::HEARTBEAT) {
+                if (m_heartbeatSentNs >= 0) {
+                    m_latency->record(LatencyRecorder::Heartbeat, m_heartbeatClock.nsecsElapsed() - m_heartbeatSentNs);
+                    m_heartbeatSentNs = -1;
+                }
+                emit heartbeatReceived();
+            }
+            batch->append(message);
+        }
+
+        if (batch->isEmpty()) {
+            batch->reset();
+            m_spareBatch = batch;
+            break;
+        }
+        m_inbound->tryPush(std::move(batch));
+        produced = true;
+    }
+
+    if (m_decoder.hasError()) {
+        qWarning() << "Invalid frame size, aborting connection";
+        m_decoder.reset();
+        m_socket->abort();
+    }
+
+    if (produced && !m_framesSignalled.exchange(true)) {
+        emit framesAvailable();
+    }
+}
+
+InboundBatch *ConnectionWorker::takeBatch() {
+    InboundBatch *batch = nullptr;
+    if (m_spareBatch) {
+        std::swap(batch, m_spareBatch);
+    } else if (!m_recycled->tryPop(batch)) {
+        batch = new InboundBatch;
+    }
+    return batch;
+}
+
+void ConnectionWorker::onErrorOccurred(QAbstractSocket::SocketError error) {
+    Q_UNUSED(error);
+    qWarning() << "Socket error:" << m_socket->errorString();
+    emit connectionError(m_socket->errorString());
+    // 连接阶段的错误（拒绝连接、解析失败等）不会触发 disconnected，在这里结束本次尝试
+    if (m_connecting) {
+        finishConnect(false);
+    }
+}
+
+void ConnectionWorker::onHeartbeatTimeout() {
+    sendHeartbeat();
+}
+
+void ConnectionWorker::flushOutbound() {
+    m_flushScheduled.store(false);
+
+    // 一次取空出站队列，只把数据交给套接字缓冲，由事件循环异步写出，不等待写完
+    QByteArray frame;
+    while (!m_writeBlocked && m_outbound->tryPop(frame)) {
+        stageFrame(std::move(frame));
+        if (m_socket->bytesToWrite() + m_staged.size() > kWriteHighWatermark) {
+            // 剩余的帧留在出站队列里，队列满时 sendMessage 直接返回背压状态
+            m_writeBlocked = true;
+            emit backpressureChanged(true);
+        }
+    }
+    flushStaged();
+    recycleWrittenBuffers();
+}
+
+void ConnectionWorker::onBytesWritten() {
+    recycleWrittenBuffers();
+
+    if (m_writeBlocked && m_socket->bytesToWrite() <= kWriteLowWatermark) {
+        m_writeBlocked = false;
+        emit backpressureChanged(false);
+        flushOutbound();
+    }
+}
+
+void ConnectionWorker::stageFrame(QByteArray &&frame) {
+    m_framesWritten.fetch_add(1, std::memory_order_relaxed);
+    if (m_capture.isActive()) {
+        m_capture.record(CaptureDirection::Outbound, frame.constData() + FrameDecoder::kHeaderSize,
+                         quint32(frame.size() - FrameDecoder::kHeaderSize));
+    }
+
+    // 大帧保持零拷贝单独写出；写之前先把已合并的小帧写掉，保证顺序
+    if (frame.size() >= kCoalesceThreshold) {
+        flushStaged();
+        writeBuffer(std::move(frame));
+        return;
+    }
+
+    if (!m_staged.isEmpty() && m_staged.size() + frame.size() > kCoalesceBufferSize) {
+        flushStaged();
+    }
+    if (m_staged.isEmpty()) {
+        // 只有一帧时不拷贝，直接沿用它的缓冲区
+        m_staged = std::move(frame);
+        return;
+    }
+
+    if (m_staged.capacity() < m_staged.size() + frame.size()) {
+        QByteArray merged = m_bufferPool->acquire(kCoalesceBufferSize);
+        merged.resize(0);
+        merged.append(m_staged);
+        m_bufferPool->release(std::move(m_staged));
+        m_staged = std::move(merged);
+    }
+    m_staged.append(frame);
+    m_bufferPool->release(std::move(frame));
+}
+
+void ConnectionWorker::flushStaged() {
+    if (!m_staged.isEmpty()) {
+        writeBuffer(std::move(m_staged));
+        m_staged = QByteArray();
+    }
+}
+
+void ConnectionWorker::writeBuffer(QByteArray &&frame) {
+    m_socketWrites.fetch_add(1, std::memory_order_relaxed);
+    m_bytesWritten.fetch_add(quint64(frame.size()), std::memory_order_relaxed);
+
+    // write(QByteArray) 让套接字的写缓冲共享这块内存而不是拷贝
+    if (m_socket->write(frame) == -1) {
+        qWarning() << "Failed to write data to socket:" << m_socket->errorString();
+        m_bufferPool->release(std::move(frame));
+        return;
+    }
+    m_inFlight.push_back(std::move(frame));
+}
+
+void ConnectionWorker::recycleWrittenBuffers() {
+    // 套接字写完一块就释放对它的引用，此时缓冲区重新变成独占，可以回到池中
+    while (!m_inFlight.empty() && m_inFlight.front().isDetached()) {
+        m_bufferPool->release(std::move(m_inFlight.front()));
+        m_inFlight.pop_front();
+    }
+}
+
+void ConnectionWorker::sendHeartbeat() {
+    if (!isConnected()) {
+        return;
+    }
+
+    data::MessageFrame message;
+    auto *header = message.mutable_header();
+    header->set_request_id(m_heartbeatIds.next());
+    header->set_timestamp(QDateTime::currentMSecsSinceEpoch()); // 改为毫秒
+    header->set_type(data::HEARTBEAT);
+
+    message.mutable_heartbeat()->set_last_active_time(QDateTime::currentMSecsSinceEpoch()); // 改为毫秒
+
+    QByteArray frame;
+    if (!encodeFrame(message, *m_bufferPool, frame)) {
+        qWarning() << "Failed to serialize message";
+        return;
+    }
+    // 心跳不经过出站队列（背压时也要发出），和队列里已有的小帧合并成一次写入
+    m_heartbeatSentNs = m_heartbeatClock.nsecsElapsed();
+    stageFrame(std::move(frame));
+    flushOutbound();
+}
+
+void ConnectionWorker::startHeartbeatTimer() {
+    m_heartbeatTimer->start();
+    // 立即发送第一个心跳
+    QTimer::singleShot(0, this, &ConnectionWorker::sendHeartbeat);
+}
+
+void ConnectionWorker::stopHeartbeatTimer() {
+    m_heartbeatTimer->stop();
+}
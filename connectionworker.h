@@ -0,0 +1,138 @@
+#ifndef CONNECTIONWORKER_H
+#define CONNECTIONWORKER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include "bufferpool.h"
+#include "framedecoder.h"
+#include "inboundbatch.h"
+#include "latencyrecorder.h"
+#include "mpscqueue.h"
+#include "requestidgenerator.h"
+#include "spscqueue.h"
+#include "trafficcapture.h"
+#include "protoc/data_proto.pb.h"
+
+// 运行在网络 I/O 线程上的连接对象：拥有套接字、心跳/重连定时器和接收缓冲区。
+// 每次读取解析出的帧按批次（共享一个 Arena）放进入站队列交给 NetworkManager，
+// 用完的批次经回收队列送回复用；出站队列里的已编码帧由这里写出，
+// 套接字写缓冲超过高水位时暂停出队，直到回落到低水位（背压）。
+// 出站队列批量取出，连续的小帧合并成一块连续内存一次交给套接字，大帧单独写。
+
+// 出站写入统计：每次交给套接字的连续块在事件循环中对应一次 send 调用
+struct WriteStats
+{
+    quint64 frames = 0;
+    quint64 writes = 0;
+    quint64 bytes = 0;
+
+    double framesPerWrite() const { return writes > 0 ? double(frames) / double(writes) : 0.0; }
+};
+
+class ConnectionWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    ConnectionWorker(SpscQueue<InboundBatch *> *inbound,
+                     SpscQueue<InboundBatch *> *recycled,
+                     MpscQueue<QByteArray> *outbound,
+                     BufferPool *bufferPool,
+                     LatencyRecorder *latency,
+                     QObject *parent = nullptr);
+    ~ConnectionWorker();
+
+    using ConnectCallback = std::function<void(bool connected)>;
+
+    // 非阻塞连接，只能在 I/O 线程调用：结果（连上、出错或超时）在 I/O 线程上经 done 回报。
+    // 多个连接共用一个 I/O 线程时，某个连接连不上不会卡住其他连接
+    void beginConnect(const QString &host, quint16 port, ConnectCallback done = {});
+    // 只能在 I/O 线程调用：把收发的每一帧记入抓包文件，capture 为空时停止并写出缓冲的记录
+    void setCapture(std::shared_ptr<TrafficCapture> capture, quint16 stream);
+
+    // 以下方法线程安全，可在任意线程调用
+    bool isConnected() const;
+    void scheduleFlush();
+    void beginConsume();
+    void endConsume();
+    WriteStats writeStats() const;
+
+public slots:
+    void disconnectFromServer();
+    void setAutoReconnect(bool enable, int interval);
+    // 停止重连和心跳，断开连接并丢弃出站队列中还没写出的帧；析构时自动调用
+    void shutdown();
+
+signals:
+    void connected();
+    void disconnected();
+    void connectionError(const QString &error);
+    void heartbeatReceived();
+    void framesAvailable();
+    void backpressureChanged(bool active);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onReadyRead();
+    void onErrorOccurred(QAbstractSocket::SocketError error);
+    void onHeartbeatTimeout();
+    void flushOutbound();
+    void onBytesWritten();
+
+private:
+    InboundBatch *takeBatch();
+    void stageFrame(QByteArray &&frame);
+    void flushStaged();
+    void writeBuffer(QByteArray &&frame);
+    void recycleWrittenBuffers();
+    void sendHeartbeat();
+    void startHeartbeatTimer();
+    void stopHeartbeatTimer();
+    void finishConnect(bool connected);
+
+    SpscQueue<InboundBatch *> *m_inbound;
+    SpscQueue<InboundBatch *> *m_recycled;
+    MpscQueue<QByteArray> *m_outbound;
+    BufferPool *m_bufferPool;
+    LatencyRecorder *m_latency;
+    // 心跳往返计时：最近一次心跳的发送时间，-1 表示没有等待中的心跳
+    QElapsedTimer m_heartbeatClock;
+    qint64 m_heartbeatSentNs;
+    // 心跳的 request_id，前缀按连接区分
+    RequestIdGenerator m_heartbeatIds;
+    // 正在合并的小帧，下一次 flushStaged() 时作为一块写出
+    QByteArray m_staged;
+    // 已交给套接字、可能仍被其写缓冲共享的帧，按写入顺序排列
+    std::deque<QByteArray> m_inFlight;
+    bool m_writeBlocked;
+    InboundBatch *m_spareBatch;
+    QTcpSocket *m_socket;
+    QTimer *m_heartbeatTimer;
+    QTimer *m_reconnectTimer;
+    QTimer *m_connectTimer;
+    ConnectCallback m_connectDone;
+    QString m_host;
+    quint16 m_port;
+    bool m_autoReconnect;
+    bool m_connecting;
+    FrameDecoder m_decoder;
+    CaptureBuffer m_capture;
+
+    std::atomic<bool> m_connected;
+    std::atomic<bool> m_flushScheduled;
+    std::atomic<bool> m_framesSignalled;
+    std::atomic<bool> m_readPaused;
+
+    std::atomic<quint64> m_framesWritten;
+    std::atomic<quint64> m_socketWrites;
+    std::atomic<quint64> m_bytesWritten;
+};
+
+#endif // CONNECTIONWORKER_H
@@ -0,0 +1,70 @@
+#include "credentialfeeder.h"
+#include <QFile>
+#include <QTextStream>
+
+CredentialFeeder::CredentialFeeder()
+    : m_next(0)
+{
+}
+
+bool CredentialFeeder::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) {
+            *error = QString("无法打开账号文件: %1").arg(path);
+        }
+        return false;
+    }
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const QStringList fields = line.split(',');
+        if (lineNumber == 1 && fields[0].trimmed().compare("username", Qt::CaseInsensitive) == 0) {
+            continue;
+        }
+        if (fields.size() < 2 || fields.size() > 3 || fields[0].trimmed().isEmpty()) {
+            if (error) {
+                *error = QString("%1:%2: 应为 username,passwordHash[,clientId]").arg(path).arg(lineNumber);
+            }
+            return false;
+        }
+
+        Credential credential;
+        credential.username = fields[0].trimmed();
+        credential.passwordHash = fields[1].trimmed();
+        if (fields.size() == 3) {
+            credential.clientId = fields[2].trimmed();
+        }
+        add(credential);
+    }
+
+    if (m_credentials.isEmpty()) {
+        if (error) {
+            *error = QString("账号文件中没有账号: %1").arg(path);
+        }
+        return false;
+    }
+    return true;
+}
+
+void CredentialFeeder::add(const Credential &credential)
+{
+    m_credentials.append(credential);
+    if (m_credentials.last().clientId.isEmpty()) {
+        m_credentials.last().clientId = "ProtoClientTester-" + credential.username;
+    }
+}
+
+const Credential &CredentialFeeder::next()
+{
+    const quint32 index = m_next.fetch_add(1, std::memory_order_relaxed);
+    return m_credentials.at(int(index % quint32(m_credentials.size())));
+}
@@ -0,0 +1,39 @@
+#ifndef CREDENTIALFEEDER_H
+#define CREDENTIALFEEDER_H
+
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+struct Credential
+{
+    QString username;
+    QString passwordHash;
+    // 为空时使用 "ProtoClientTester-<username>"
+    QString clientId;
+};
+
+// 从文件读取压测账号，给每个虚拟用户分配一个。文件每行一个账号：
+//   username,passwordHash[,clientId]
+// 空行和 # 开头的行忽略，第一行的第一列是 "username" 时视为表头。
+class CredentialFeeder
+{
+public:
+    CredentialFeeder();
+
+    bool load(const QString &path, QString *error = nullptr);
+    void add(const Credential &credential);
+
+    int size() const { return m_credentials.size(); }
+    bool isEmpty() const { return m_credentials.isEmpty(); }
+    const Credential &at(int index) const { return m_credentials.at(index); }
+    const QVector<Credential> &credentials() const { return m_credentials; }
+    // 线程安全；按文件顺序轮流取，取完一轮从头开始。没有账号时不能调用
+    const Credential &next();
+
+private:
+    QVector<Credential> m_credentials;
+    std::atomic<quint32> m_next;
+};
+
+#endif // CREDENTIALFEEDER_H
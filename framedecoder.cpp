@@ -0,0 +1,111 @@
+#include "framedecoder.h"
+#include <QIODevice>
+#include <QtEndian>
+#include <cstring>
+
+FrameDecoder::FrameDecoder(qsizetype initialCapacity)
+    : m_buffer(new char[initialCapacity])
+      , m_initialCapacity(initialCapacity)
+      , m_capacity(initialCapacity)
+      , m_readPos(0)
+      , m_writePos(0)
+      , m_error(false) {
+}
+
+qint64 FrameDecoder::readFrom(QIODevice *device) {
+    qint64 total = 0;
+    for (;;) {
+        const qint64 available = device->bytesAvailable();
+        if (available <= 0) {
+            break;
+        }
+
+        prepareWrite(available);
+        const qint64 bytesRead = device->read(m_buffer.get() + m_writePos, m_capacity - m_writePos);
+        if (bytesRead <= 0) {
+            break;
+        }
+        m_writePos += bytesRead;
+        total += bytesRead;
+    }
+    return total;
+}
+
+void FrameDecoder::append(const char *data, qsizetype size) {
+    prepareWrite(size);
+    memcpy(m_buffer.get() + m_writePos, data, size);
+    m_writePos += size;
+}
+
+bool FrameDecoder::nextFrame(const char *&data, quint32 &size) {
+    const qsizetype available = m_writePos - m_readPos;
+    if (m_error || available < qsizetype(kHeaderSize)) {
+        return false;
+    }
+
+    const char *head = m_buffer.get() + m_readPos;
+    const quint32 frameSize = qFromBigEndian<quint32>(head);
+    if (frameSize > kMaxFrameSize) {
+        m_error = true;
+        return false;
+    }
+    if (available < qsizetype(kHeaderSize + frameSize)) {
+        return false;
+    }
+
+    data = head + kHeaderSize;
+    size = frameSize;
+    m_readPos += kHeaderSize + frameSize;
+    return true;
+}
+
+void FrameDecoder::reset() {
+    m_readPos = 0;
+    m_writePos = 0;
+    m_error = false;
+    if (m_capacity != m_initialCapacity) {
+        reallocate(m_initialCapacity);
+    }
+}
+
+void FrameDecoder::prepareWrite(qsizetype needed) {
+    const qsizetype live = m_writePos - m_readPos;
+    if (live == 0) {
+        // 缓冲区已全部消费，直接回到开头，不需要搬动数据。
+        // 容量保持不变（大帧之后也不收缩），只在 reset() 时恢复初始大小
+        m_readPos = 0;
+        m_writePos = 0;
+    } else if (live >= qsizetype(kHeaderSize)) {
+        // 当前帧长度已知时一次预留整帧空间，避免多 MB 的帧反复扩容
+        const quint32 frameSize = qFromBigEndian<quint32>(m_buffer.get() + m_readPos);
+        if (frameSize <= kMaxFrameSize) {
+            needed = qMax(needed, qsizetype(kHeaderSize + frameSize) - live);
+        }
+    }
+
+    if (m_capacity - m_writePos >= needed) {
+        return;
+    }
+
+    // 尾部空间不足时先尝试压缩：只搬动尚未解析完的残帧
+    if (m_readPos > 0 && m_capacity - live >= needed) {
+        memmove(m_buffer.get(), m_buffer.get() + m_readPos, live);
+        m_readPos = 0;
+        m_writePos = live;
+        return;
+    }
+
+    reallocate(qMax(m_capacity * 2, live + needed));
+}
+
+void FrameDecoder::reallocate(qsizetype newCapacity) {
+    const qsizetype live = m_writePos - m_readPos;
+    std::unique_ptr<char[]> buffer(new char[newCapacity]);
+    if (live > 0) {
+        memcpy(buffer.get(), m_buffer.get() + m_readPos, live);
+    }
+    m_buffer = std::move(buffer);
+    m_capacity = newCapacity;
+    m_readPos = 0;
+    m_writePos = live;
+}
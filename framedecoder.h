@@ -0,0 +1,45 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QtGlobal>
+#include <memory>
+
+class QIODevice;
+
+// 每个连接独立的接收缓冲区：数据直接从套接字读入预分配空间，
+// 完整的 4 字节大端长度前缀帧在缓冲区内原地解析，
+// 只有尾部空间不足时才把未消费的数据挪到缓冲区开头。
+class FrameDecoder
+{
+public:
+    static constexpr quint32 kHeaderSize = 4;
+    static constexpr quint32 kMaxFrameSize = 64 * 1024 * 1024;
+
+    explicit FrameDecoder(qsizetype initialCapacity = 64 * 1024);
+
+    // 读出设备中当前可读的全部数据，返回读取的字节数
+    qint64 readFrom(QIODevice *device);
+    void append(const char *data, qsizetype size);
+
+    // 取出下一个完整帧的负载（不含长度前缀）。
+    // 返回的指针指向内部缓冲区，在下一次 readFrom()/append()/reset() 之前有效。
+    bool nextFrame(const char *&data, quint32 &size);
+
+    bool hasError() const { return m_error; }
+    qsizetype bufferedBytes() const { return m_writePos - m_readPos; }
+    qsizetype capacity() const { return m_capacity; }
+    void reset();
+
+private:
+    void prepareWrite(qsizetype needed);
+    void reallocate(qsizetype newCapacity);
+
+    std::unique_ptr<char[]> m_buffer;
+    qsizetype m_initialCapacity;
+    qsizetype m_capacity;
+    qsizetype m_readPos;
+    qsizetype m_writePos;
+    bool m_error;
+};
+
+#endif // FRAMEDECODER_H
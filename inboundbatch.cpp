@@ -0,0 +1,27 @@
+#include "inboundbatch.h"
+
+namespace {
+google::protobuf::ArenaOptions makeArenaOptions(char *initialBlock) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initialBlock;
+    options.initial_block_size = InboundBatch::kInitialBlockSize;
+    options.start_block_size = 64 * 1024;
+    options.max_block_size = 1024 * 1024;
+    return options;
+}
+}
+
+InboundBatch::InboundBatch()
+    : m_initialBlock(new char[kInitialBlockSize])
+      , m_arena(makeArenaOptions(m_initialBlock.get())) {
+    m_frames.reserve(256);
+}
+
+data::MessageFrame *InboundBatch::createFrame() {
+    return google::protobuf::Arena::CreateMessage<data::MessageFrame>(&m_arena);
+}
+
+void InboundBatch::reset() {
+    m_frames.clear();
+    m_arena.Reset();
+}
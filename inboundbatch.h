@@ -0,0 +1,35 @@
+#ifndef INBOUNDBATCH_H
+#define INBOUNDBATCH_H
+
+#include <google/protobuf/arena.h>
+#include <memory>
+#include <vector>
+#include "protoc/data_proto.pb.h"
+
+// 一次读取得到的一批入站帧。帧都分配在本批次的 Arena 上，
+// 分发完成后 reset() 整体释放，批次对象本身在 I/O 线程和消费线程之间循环复用。
+class InboundBatch
+{
+public:
+    static constexpr size_t kInitialBlockSize = 256 * 1024;
+
+    InboundBatch();
+    InboundBatch(const InboundBatch &) = delete;
+    InboundBatch &operator=(const InboundBatch &) = delete;
+
+    data::MessageFrame *createFrame();
+    void append(data::MessageFrame *frame) { m_frames.push_back(frame); }
+    const std::vector<data::MessageFrame *> &frames() const { return m_frames; }
+    size_t size() const { return m_frames.size(); }
+    bool isEmpty() const { return m_frames.empty(); }
+
+    void reset();
+
+private:
+    // 初始块由批次持有，Arena::Reset() 之后仍然复用，不再触发 malloc
+    std::unique_ptr<char[]> m_initialBlock;
+    google::protobuf::Arena m_arena;
+    std::vector<data::MessageFrame *> m_frames;
+};
+
+#endif // INBOUNDBATCH_H
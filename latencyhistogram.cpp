@@ -0,0 +1,302 @@
+#include "latencyhistogram.h"
+#include <QDateTime>
+#include <QIODevice>
+#include <QtAlgorithms>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+constexpr qint32 kV2EncodingCookie = 0x1c849303 | 0x10;
+constexpr qint32 kV2CompressedEncodingCookie = 0x1c849304 | 0x10;
+constexpr int kEncodingHeaderSize = 40;
+
+// 单写者自增：读改写不需要原子指令，只要求其他线程读到完整的值
+inline void increment(std::atomic<quint64> &counter, quint64 delta = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+int countLeadingZeros(quint64 value)
+{
+    return int(qCountLeadingZeroBits(value));
+}
+
+// HdrHistogram 的 ZigZag + LEB128 变体：最多 9 字节，第 9 字节存满 8 位
+void putZigZag(QByteArray &out, qint64 value)
+{
+    quint64 encoded = (quint64(value) << 1) ^ quint64(value >> 63);
+    for (int i = 0; i < 8; ++i) {
+        if ((encoded >> 7) == 0) {
+            out.append(char(encoded));
+            return;
+        }
+        out.append(char((encoded & 0x7f) | 0x80));
+        encoded >>= 7;
+    }
+    out.append(char(encoded));
+}
+
+template<typename T>
+void putBigEndian(char *out, T value)
+{
+    qToBigEndian<T>(value, out);
+}
+}
+
+LatencyHistogram::LatencyHistogram(qint64 lowestDiscernibleValue, qint64 highestTrackableValue,
+                                   int significantDigits)
+    : m_lowestDiscernibleValue(qMax<qint64>(1, lowestDiscernibleValue))
+      , m_highestTrackableValue(qMax(highestTrackableValue, 2 * m_lowestDiscernibleValue))
+      , m_significantDigits(qBound(1, significantDigits, 5))
+      , m_totalCount(0)
+      , m_minValue(std::numeric_limits<qint64>::max())
+      , m_maxValue(0) {
+    const qint64 largestSingleUnitResolution = 2 * qint64(std::pow(10, m_significantDigits));
+    const int subBucketCountMagnitude = int(std::ceil(std::log2(double(largestSingleUnitResolution))));
+    m_subBucketHalfCountMagnitude = qMax(subBucketCountMagnitude, 1) - 1;
+    m_unitMagnitude = 63 - countLeadingZeros(quint64(m_lowestDiscernibleValue));
+    const qint64 subBucketCount = qint64(1) << (m_subBucketHalfCountMagnitude + 1);
+    m_subBucketHalfCount = subBucketCount / 2;
+    m_subBucketMask = (subBucketCount - 1) << m_unitMagnitude;
+
+    // 覆盖到 highestTrackableValue 需要的桶数
+    qint64 smallestUntrackableValue = subBucketCount << m_unitMagnitude;
+    m_bucketCount = 1;
+    while (smallestUntrackableValue <= m_highestTrackableValue) {
+        if (smallestUntrackableValue > std::numeric_limits<qint64>::max() / 2) {
+            ++m_bucketCount;
+            break;
+        }
+        smallestUntrackableValue <<= 1;
+        ++m_bucketCount;
+    }
+    m_countsLength = int((m_bucketCount + 1) * m_subBucketHalfCount);
+    m_counts.reset(new std::atomic<quint64>[m_countsLength]());
+}
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram &other)
+    : LatencyHistogram(other.m_lowestDiscernibleValue, other.m_highestTrackableValue, other.m_significantDigits) {
+    add(other);
+}
+
+LatencyHistogram &LatencyHistogram::operator=(const LatencyHistogram &other) {
+    if (this != &other) {
+        LatencyHistogram copy(other);
+        m_lowestDiscernibleValue = copy.m_lowestDiscernibleValue;
+        m_highestTrackableValue = copy.m_highestTrackableValue;
+        m_significantDigits = copy.m_significantDigits;
+        m_unitMagnitude = copy.m_unitMagnitude;
+        m_subBucketHalfCountMagnitude = copy.m_subBucketHalfCountMagnitude;
+        m_subBucketHalfCount = copy.m_subBucketHalfCount;
+        m_subBucketMask = copy.m_subBucketMask;
+        m_bucketCount = copy.m_bucketCount;
+        m_countsLength = copy.m_countsLength;
+        m_counts = std::move(copy.m_counts);
+        m_totalCount.store(copy.m_totalCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_minValue.store(copy.m_minValue.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_maxValue.store(copy.m_maxValue.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+void LatencyHistogram::record(qint64 value) {
+    value = qBound<qint64>(0, value, m_highestTrackableValue);
+    increment(m_counts[countsIndexFor(value)]);
+    increment(m_totalCount);
+    if (value < m_minValue.load(std::memory_order_relaxed)) {
+        m_minValue.store(value, std::memory_order_relaxed);
+    }
+    if (value > m_maxValue.load(std::memory_order_relaxed)) {
+        m_maxValue.store(value, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other) {
+    if (other.m_countsLength == m_countsLength && other.m_unitMagnitude == m_unitMagnitude
+        && other.m_subBucketHalfCountMagnitude == m_subBucketHalfCountMagnitude) {
+        for (int i = 0; i < m_countsLength; ++i) {
+            const quint64 count = other.m_counts[i].load(std::memory_order_relaxed);
+            if (count != 0) {
+                increment(m_counts[i], count);
+            }
+        }
+        increment(m_totalCount, other.totalCount());
+    } else {
+        // 配置不同时按每个桶的代表值逐个记入
+        for (int i = 0; i < other.m_countsLength; ++i) {
+            const quint64 count = other.m_counts[i].load(std::memory_order_relaxed);
+            if (count != 0) {
+                const qint64 value = qMin(other.valueFromIndex(i), m_highestTrackableValue);
+                increment(m_counts[countsIndexFor(value)], count);
+                increment(m_totalCount, count);
+            }
+        }
+    }
+
+    if (other.totalCount() > 0) {
+        m_minValue.store(qMin(m_minValue.load(std::memory_order_relaxed), other.minValue()),
+                         std::memory_order_relaxed);
+        m_maxValue.store(qMax(maxValue(), other.maxValue()), std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < m_countsLength; ++i) {
+        m_counts[i].store(0, std::memory_order_relaxed);
+    }
+    m_totalCount.store(0, std::memory_order_relaxed);
+    m_minValue.store(std::numeric_limits<qint64>::max(), std::memory_order_relaxed);
+    m_maxValue.store(0, std::memory_order_relaxed);
+}
+
+qint64 LatencyHistogram::minValue() const {
+    return totalCount() == 0 ? 0 : m_minValue.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+    const quint64 total = totalCount();
+    if (total == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < m_countsLength; ++i) {
+        const quint64 count = m_counts[i].load(std::memory_order_relaxed);
+        if (count != 0) {
+            // 与 HdrHistogram 一致，用桶的中点代表该桶
+            const qint64 value = valueFromIndex(i);
+            const double median = double(lowestEquivalentValue(value) + highestEquivalentValue(value)) / 2.0;
+            sum += median * double(count);
+        }
+    }
+    return sum / double(total);
+}
+
+qint64 LatencyHistogram::valueAtPercentile(double percentile) const {
+    const quint64 total = totalCount();
+    if (total == 0) {
+        return 0;
+    }
+    percentile = qBound(0.0, percentile, 100.0);
+    if (percentile >= 100.0) {
+        return maxValue();
+    }
+
+    const quint64 countAtPercentile = qMax<quint64>(1, quint64(std::ceil(percentile / 100.0 * double(total))));
+    quint64 cumulative = 0;
+    for (int i = 0; i < m_countsLength; ++i) {
+        cumulative += m_counts[i].load(std::memory_order_relaxed);
+        if (cumulative >= countAtPercentile) {
+            const qint64 value = valueFromIndex(i);
+            const qint64 result = percentile == 0.0 ? lowestEquivalentValue(value) : highestEquivalentValue(value);
+            return qMin(result, maxValue());
+        }
+    }
+    return maxValue();
+}
+
+int LatencyHistogram::countsIndexFor(qint64 value) const {
+    const int leadingZeroCountBase = 64 - m_unitMagnitude - m_subBucketHalfCountMagnitude - 1;
+    const int bucketIndex = leadingZeroCountBase - countLeadingZeros(quint64(value | m_subBucketMask));
+    const qint64 subBucketIndex = value >> (bucketIndex + m_unitMagnitude);
+    const qint64 bucketBaseIndex = qint64(bucketIndex + 1) << m_subBucketHalfCountMagnitude;
+    return int(bucketBaseIndex + (subBucketIndex - m_subBucketHalfCount));
+}
+
+qint64 LatencyHistogram::valueFromIndex(int index) const {
+    int bucketIndex = (index >> m_subBucketHalfCountMagnitude) - 1;
+    qint64 subBucketIndex = (index & (m_subBucketHalfCount - 1)) + m_subBucketHalfCount;
+    if (bucketIndex < 0) {
+        subBucketIndex -= m_subBucketHalfCount;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << (bucketIndex + m_unitMagnitude);
+}
+
+qint64 LatencyHistogram::lowestEquivalentValue(qint64 value) const {
+    const int index = countsIndexFor(value);
+    return valueFromIndex(index);
+}
+
+qint64 LatencyHistogram::highestEquivalentValue(qint64 value) const {
+    // 下一个桶的起点减一；桶宽 = 1 << (unitMagnitude + 调整后的桶序号)
+    const int leadingZeroCountBase = 64 - m_unitMagnitude - m_subBucketHalfCountMagnitude - 1;
+    const int bucketIndex = leadingZeroCountBase - countLeadingZeros(quint64(value | m_subBucketMask));
+    const qint64 subBucketIndex = value >> (bucketIndex + m_unitMagnitude);
+    const int adjustedBucket = subBucketIndex >= 2 * m_subBucketHalfCount ? bucketIndex + 1 : bucketIndex;
+    const qint64 range = qint64(1) << (m_unitMagnitude + adjustedBucket);
+    return lowestEquivalentValue(value) + range - 1;
+}
+
+QByteArray LatencyHistogram::encode() const {
+    QByteArray out(kEncodingHeaderSize, Qt::Uninitialized);
+
+    // 负载：计数依次 ZigZag 编码，连续的 0 压缩成一个负数（-连续个数）
+    const int countsLimit = totalCount() > 0 ? countsIndexFor(maxValue()) + 1 : 0;
+    int index = 0;
+    while (index < countsLimit) {
+        const quint64 count = m_counts[index++].load(std::memory_order_relaxed);
+        qint64 zeros = 0;
+        if (count == 0) {
+            zeros = 1;
+            while (index < countsLimit && m_counts[index].load(std::memory_order_relaxed) == 0) {
+                ++zeros;
+                ++index;
+            }
+        }
+        putZigZag(out, zeros > 1 ? -zeros : qint64(count));
+    }
+
+    char *header = out.data();
+    putBigEndian<qint32>(header, kV2EncodingCookie);
+    putBigEndian<qint32>(header + 4, qint32(out.size() - kEncodingHeaderSize));
+    putBigEndian<qint32>(header + 8, 0); // normalizingIndexOffset
+    putBigEndian<qint32>(header + 12, m_significantDigits);
+    putBigEndian<qint64>(header + 16, m_lowestDiscernibleValue);
+    putBigEndian<qint64>(header + 24, m_highestTrackableValue);
+    const double conversionRatio = 1.0;
+    quint64 ratioBits = 0;
+    std::memcpy(&ratioBits, &conversionRatio, sizeof(ratioBits));
+    putBigEndian<quint64>(header + 32, ratioBits);
+    return out;
+}
+
+QByteArray LatencyHistogram::encodeCompressed() const {
+    // qCompress 输出 = 4 字节大端原始长度 + zlib 流；HdrHistogram 只要 zlib 流
+    const QByteArray deflated = qCompress(encode()).mid(4);
+    QByteArray out(8, Qt::Uninitialized);
+    putBigEndian<qint32>(out.data(), kV2CompressedEncodingCookie);
+    putBigEndian<qint32>(out.data() + 4, qint32(deflated.size()));
+    out.append(deflated);
+    return out;
+}
+
+HistogramLogWriter::HistogramLogWriter(QIODevice *device, double maxValueUnitRatio)
+    : m_device(device)
+      , m_maxValueUnitRatio(maxValueUnitRatio) {
+}
+
+void HistogramLogWriter::writeHeader(qint64 startTimeMsecsSinceEpoch) {
+    const double startSeconds = double(startTimeMsecsSinceEpoch) / 1000.0;
+    const QString startText = QDateTime::fromMSecsSinceEpoch(startTimeMsecsSinceEpoch).toString(Qt::ISODate);
+    QByteArray header;
+    header += "#[Histogram log format version 1.3]\n";
+    header += QString("#[StartTime: %1 (seconds since epoch), %2]\n").arg(startSeconds, 0, 'f', 3).arg(startText).toUtf8();
+    header += QString("#[BaseTime: %1 (seconds since epoch)]\n").arg(startSeconds, 0, 'f', 3).toUtf8();
+    header += "\"StartTimestamp\",\"Interval_Length\",\"Interval_Max\",\"Interval_Compressed_Histogram\"\n";
+    m_device->write(header);
+}
+
+void HistogramLogWriter::writeInterval(const QString &tag, double startSeconds, double lengthSeconds,
+                                       const LatencyHistogram &histogram) {
+    QByteArray line;
+    if (!tag.isEmpty()) {
+        line += "Tag=" + tag.toUtf8() + ',';
+    }
+    line += QByteArray::number(startSeconds, 'f', 3) + ','
+            + QByteArray::number(lengthSeconds, 'f', 3) + ','
+            + QByteArray::number(double(histogram.maxValue()) / m_maxValueUnitRatio, 'f', 3) + ','
+            + histogram.encodeCompressed().toBase64() + '\n';
+    m_device->write(line);
+}
@@ -0,0 +1,80 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+class QIODevice;
+
+// 高动态范围（HdrHistogram 布局）延迟直方图：在 [lowest, highest] 范围内保持 significantDigits 位有效精度，
+// 内存只与范围和精度有关，与记录次数无关。
+// record() 只允许一个线程写入（计数用 relaxed 原子读改写，不加锁也不用 lock 前缀指令），
+// 其他线程可以随时 add() 合并或查询百分位，读到的是写入线程稍早的状态。
+class LatencyHistogram
+{
+public:
+    // 默认单位纳秒：1 µs 分辨率，最长 1 小时，3 位有效数字
+    explicit LatencyHistogram(qint64 lowestDiscernibleValue = 1000,
+                              qint64 highestTrackableValue = 3600LL * 1000 * 1000 * 1000,
+                              int significantDigits = 3);
+    LatencyHistogram(const LatencyHistogram &other);
+    LatencyHistogram &operator=(const LatencyHistogram &other);
+
+    // 超出范围的值按上限记录，负值按 0 记录
+    void record(qint64 value);
+    // 合并另一个配置相同的直方图
+    void add(const LatencyHistogram &other);
+    void reset();
+
+    quint64 totalCount() const { return m_totalCount.load(std::memory_order_relaxed); }
+    qint64 minValue() const;
+    qint64 maxValue() const { return m_maxValue.load(std::memory_order_relaxed); }
+    double mean() const;
+    qint64 valueAtPercentile(double percentile) const;
+
+    // HdrHistogram V2 压缩编码（cookie 0x1c849314），与其他语言的 HdrHistogram 实现互通
+    QByteArray encodeCompressed() const;
+
+private:
+    int countsIndexFor(qint64 value) const;
+    qint64 valueFromIndex(int index) const;
+    qint64 lowestEquivalentValue(qint64 value) const;
+    qint64 highestEquivalentValue(qint64 value) const;
+    QByteArray encode() const;
+
+    qint64 m_lowestDiscernibleValue;
+    qint64 m_highestTrackableValue;
+    int m_significantDigits;
+    int m_unitMagnitude;
+    int m_subBucketHalfCountMagnitude;
+    qint64 m_subBucketHalfCount;
+    qint64 m_subBucketMask;
+    int m_bucketCount;
+    int m_countsLength;
+
+    std::unique_ptr<std::atomic<quint64>[]> m_counts;
+    std::atomic<quint64> m_totalCount;
+    std::atomic<qint64> m_minValue;
+    std::atomic<qint64> m_maxValue;
+};
+
+// 按 HdrHistogram 日志格式（1.3）写出直方图，可用 HistogramLogProcessor 等工具离线比较。
+// 每行一个带 Tag 的区间，时间以秒计，最大值按 maxValueUnitRatio 换算（纳秒记录时为毫秒）。
+class HistogramLogWriter
+{
+public:
+    explicit HistogramLogWriter(QIODevice *device, double maxValueUnitRatio = 1e6);
+
+    void writeHeader(qint64 startTimeMsecsSinceEpoch);
+    void writeInterval(const QString &tag, double startSeconds, double lengthSeconds,
+                       const LatencyHistogram &histogram);
+
+private:
+    QIODevice *m_device;
+    double m_maxValueUnitRatio;
+};
+
+#endif // LATENCYHISTOGRAM_H
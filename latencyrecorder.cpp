@@ -0,0 +1,145 @@
+#include "latencyrecorder.h"
+#include <QMutexLocker>
+
+namespace {
+// 进程内每个活着的线程占一个紧凑的编号，线程退出后编号回收给新线程。
+// 记录器按编号直接索引分片，线程这边不保存任何指向记录器的条目，记录器销毁后没有残留。
+// 接手旧编号的线程也接手旧线程留在各记录器里的分片：旧线程已经退出，分片仍只有一个写者
+QMutex g_threadIndexMutex;
+std::vector<int> g_freeThreadIndexes;
+int g_nextThreadIndex = 0;
+
+struct ThreadIndex
+{
+    int value;
+
+    ThreadIndex() {
+        QMutexLocker locker(&g_threadIndexMutex);
+        if (g_freeThreadIndexes.empty()) {
+            value = g_nextThreadIndex++;
+        } else {
+            value = g_freeThreadIndexes.back();
+            g_freeThreadIndexes.pop_back();
+        }
+    }
+
+    ~ThreadIndex() {
+        QMutexLocker locker(&g_threadIndexMutex);
+        g_freeThreadIndexes.push_back(value);
+    }
+};
+
+thread_local ThreadIndex t_threadIndex;
+}
+
+LatencyRecorder::LatencyRecorder() {
+    for (std::atomic<ThreadChunk *> &chunk : m_threadChunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+LatencyRecorder::~LatencyRecorder() {
+    for (std::atomic<ThreadChunk *> &chunk : m_threadChunks) {
+        delete chunk.load(std::memory_order_relaxed);
+    }
+}
+
+int LatencyRecorder::slotFor(data::RequestType requestType) {
+    switch (requestType) {
+    case data::LOGIN_REQUEST:
+    case data::LOGIN_RESPONSE:
+        return Login;
+    case data::SAVE_SOURCE_CODE_REQUEST:
+    case data::SAVE_SOURCE_CODE_RESPONSE:
+        return SaveSource;
+    case data::COMPILE_SOURCE_REQUEST:
+    case data::COMPILE_SOURCE_RESPONSE:
+        return CompileSource;
+    case data::EXECUTE_IR_REQUEST:
+    case data::EXECUTE_IR_RESPONSE:
+        return ExecuteIr;
+    case data::HEARTBEAT:
+        return Heartbeat;
+    default:
+        return -1;
+    }
+}
+
+const char *LatencyRecorder::slotName(int slot) {
+    switch (slot) {
+    case Login:
+        return "LOGIN";
+    case SaveSource:
+        return "SAVE_SOURCE_CODE";
+    case CompileSource:
+        return "COMPILE_SOURCE";
+    case ExecuteIr:
+        return "EXECUTE_IR";
+    case Heartbeat:
+        return "HEARTBEAT";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+void LatencyRecorder::record(data::RequestType requestType, qint64 latencyNs) {
+    const int slot = slotFor(requestType);
+    if (slot >= 0) {
+        record(Slot(slot), latencyNs);
+    }
+}
+
+void LatencyRecorder::record(Slot slot, qint64 latencyNs) {
+    Shard *shard = localShard();
+    std::unique_ptr<LatencyHistogram> &histogram = shard->histograms[slot];
+    if (!histogram) {
+        // 分配需要和 mergeInto() 的读取互斥
+        QMutexLocker locker(&m_mutex);
+        histogram.reset(new LatencyHistogram);
+    }
+    histogram->record(latencyNs);
+}
+
+void LatencyRecorder::mergeInto(Snapshot &into) const {
+    QMutexLocker locker(&m_mutex);
+    for (const std::unique_ptr<Shard> &shard : m_shards) {
+        for (int slot = 0; slot < SlotCount; ++slot) {
+            if (shard->histograms[slot]) {
+                into[slot].add(*shard->histograms[slot]);
+            }
+        }
+    }
+}
+
+LatencyRecorder::Snapshot LatencyRecorder::snapshot() const {
+    Snapshot result;
+    mergeInto(result);
+    return result;
+}
+
+LatencyRecorder::Shard *LatencyRecorder::localShard() {
+    const int index = t_threadIndex.value;
+    if (index >= kThreadChunks * kThreadChunkSize) {
+        qFatal("LatencyRecorder: too many live recording threads");
+    }
+
+    std::atomic<ThreadChunk *> &chunkSlot = m_threadChunks[index / kThreadChunkSize];
+    ThreadChunk *chunk = chunkSlot.load(std::memory_order_acquire);
+    if (chunk) {
+        if (Shard *shard = chunk->shards[index % kThreadChunkSize]) {
+            return shard;
+        }
+    }
+
+    // 本线程第一次在这个记录器里记录
+    Shard *shard = new Shard;
+    QMutexLocker locker(&m_mutex);
+    m_shards.emplace_back(shard);
+    chunk = chunkSlot.load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new ThreadChunk;
+        chunkSlot.store(chunk, std::memory_order_release);
+    }
+    chunk->shards[index % kThreadChunkSize] = shard;
+    return shard;
+}
@@ -0,0 +1,68 @@
+#ifndef LATENCYRECORDER_H
+#define LATENCYRECORDER_H
+
+#include <QMutex>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "latencyhistogram.h"
+#include "protoc/data_proto.pb.h"
+
+// 按请求类型分开的延迟记录器。每个记录线程第一次调用时登记一组自己的直方图（只加一次锁），
+// 之后的 record() 按线程编号直接取到本线程的直方图，不查表、不加锁、线程之间不共享缓存行；
+// snapshot() 在报告时把所有线程的直方图按类型合并。
+class LatencyRecorder
+{
+public:
+    enum Slot {
+        Login,
+        SaveSource,
+        CompileSource,
+        ExecuteIr,
+        Heartbeat,
+        SlotCount
+    };
+
+    using Snapshot = std::array<LatencyHistogram, SlotCount>;
+
+    LatencyRecorder();
+    ~LatencyRecorder();
+
+    LatencyRecorder(const LatencyRecorder &) = delete;
+    LatencyRecorder &operator=(const LatencyRecorder &) = delete;
+
+    // 请求类型映射到槽位，不统计的类型返回 -1
+    static int slotFor(data::RequestType requestType);
+    static const char *slotName(int slot);
+
+    void record(data::RequestType requestType, qint64 latencyNs);
+    void record(Slot slot, qint64 latencyNs);
+
+    // 线程安全；合并到 into 中（可以把多个记录器累加到同一份快照）
+    void mergeInto(Snapshot &into) const;
+    Snapshot snapshot() const;
+
+private:
+    struct Shard
+    {
+        // 直方图较大，按槽位首次使用时再分配
+        std::array<std::unique_ptr<LatencyHistogram>, SlotCount> histograms;
+    };
+
+    // 线程编号到分片的映射分两级，第二级按需分配；只有编号的持有线程写自己的槽位
+    static constexpr int kThreadChunkSize = 64;
+    static constexpr int kThreadChunks = 256;
+    struct ThreadChunk
+    {
+        std::array<Shard *, kThreadChunkSize> shards{};
+    };
+
+    Shard *localShard();
+
+    mutable QMutex m_mutex;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::array<std::atomic<ThreadChunk *>, kThreadChunks> m_threadChunks;
+};
+
+#endif // LATENCYRECORDER_H
@@ -0,0 +1,739 @@
+#include "loadgenerator.h"
+#include <QDateTime>
+#include <QJsonValue>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include <cmath>
+
+namespace {
+// 限速模式下的发送节拍
+constexpr int kPaceIntervalMs = 1;
+
+LatencyRecorder::Slot kindSlot(LoadRequestKind kind)
+{
+    switch (kind) {
+    case LoadRequestKind::Login:
+        return LatencyRecorder::Login;
+    case LoadRequestKind::Save:
+        return LatencyRecorder::SaveSource;
+    case LoadRequestKind::Compile:
+        return LatencyRecorder::CompileSource;
+    default:
+        return LatencyRecorder::ExecuteIr;
+    }
+}
+
+double toMs(qint64 ns)
+{
+    return double(ns) / 1e6;
+}
+
+void printLatency(QTextStream &out, const char *title, const LatencyRecorder::Snapshot &latency)
+{
+    out << "\n" << title << "\n";
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+               .arg("request type", -18).arg("count", 10).arg("p50", 9).arg("p90", 9)
+               .arg("p99", 9).arg("p99.9", 9).arg("p99.99", 9).arg("max", 9);
+    for (int slot = 0; slot < LatencyRecorder::SlotCount; ++slot) {
+        const LatencyHistogram &histogram = latency[slot];
+        if (histogram.totalCount() == 0) {
+            continue;
+        }
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                   .arg(QString::fromLatin1(LatencyRecorder::slotName(slot)), -18)
+                   .arg(histogram.totalCount(), 10)
+                   .arg(toMs(histogram.valueAtPercentile(50)), 9, 'f', 3)
+                   .arg(toMs(histogram.valueAtPercentile(90)), 9, 'f', 3)
+                   .arg(toMs(histogram.valueAtPercentile(99)), 9, 'f', 3)
+                   .arg(toMs(histogram.valueAtPercentile(99.9)), 9, 'f', 3)
+                   .arg(toMs(histogram.valueAtPercentile(99.99)), 9, 'f', 3)
+                   .arg(toMs(histogram.maxValue()), 9, 'f', 3);
+    }
+}
+}
+
+bool LoadConfig::parseMix(const QString &text, QString *error)
+{
+    std::array<int, int(LoadRequestKind::Count)> weights = {0, 0, 0, 0};
+    const QStringList items = text.split(',', Qt::SkipEmptyParts);
+    for (const QString &item : items) {
+        const QStringList pair = item.split('=');
+        bool ok = false;
+        const int weight = pair.size() == 2 ? pair[1].trimmed().toInt(&ok) : 0;
+        if (!ok || weight < 0) {
+            if (error) {
+                *error = QString("无效的请求配比项: %1").arg(item);
+            }
+            return false;
+        }
+
+        const QString name = pair[0].trimmed().toLower();
+        int index = -1;
+        for (int i = 0; i < int(LoadRequestKind::Count); ++i) {
+            if (name == LoadGenerator::kindName(LoadRequestKind(i))) {
+                index = i;
+            }
+        }
+        if (index < 0) {
+            if (error) {
+                *error = QString("未知的请求类型: %1").arg(name);
+            }
+            return false;
+        }
+        weights[index] = weight;
+    }
+
+    int total = 0;
+    for (int weight : weights) {
+        total += weight;
+    }
+    if (total == 0) {
+        if (error) {
+            *error = "请求配比的权重之和必须大于 0";
+        }
+        return false;
+    }
+
+    mix = weights;
+    return true;
+}
+
+bool LoadConfig::applyJson(const QJsonObject &object, QString *error)
+{
+    if (object.contains("host")) {
+        host = object.value("host").toString(host);
+    }
+    if (object.contains("port")) {
+        port = static_cast<quint16>(object.value("port").toInt(port));
+    }
+    if (object.contains("connections")) {
+        connections = object.value("connections").toInt(connections);
+    }
+    if (object.contains("rate")) {
+        rate = object.value("rate").toDouble(rate);
+    }
+    if (object.contains("concurrency")) {
+        concurrency = object.value("concurrency").toInt(concurrency);
+    }
+    if (object.contains("duration")) {
+        durationSec = object.value("duration").toInt(durationSec);
+    }
+    if (object.contains("username")) {
+        username = object.value("username").toString(username);
+    }
+    if (object.contains("passwordHash")) {
+        passwordHash = object.value("passwordHash").toString(passwordHash);
+    }
+    if (object.contains("users")) {
+        usersFile = object.value("users").toString(usersFile);
+    }
+    if (object.contains("batch")) {
+        batchSize = object.value("batch").toInt(batchSize);
+    }
+    if (object.contains("batchDelayUs")) {
+        batchDelayUs = object.value("batchDelayUs").toInt(batchDelayUs);
+    }
+    if (object.contains("codeId")) {
+        codeId = object.value("codeId").toString(codeId);
+    }
+    if (object.contains("language")) {
+        language = object.value("language").toString(language);
+    }
+    if (object.contains("sourceSize")) {
+        sourceSize = object.value("sourceSize").toInt(sourceSize);
+    }
+    if (object.contains("irCodeId")) {
+        irCodeId = object.value("irCodeId").toString(irCodeId);
+    }
+    if (object.contains("mode")) {
+        if (!data::ExecuteIRCodeRequest_ExecutionMode_Parse(object.value("mode").toString().toUpper().toStdString(),
+                                                            &executionMode)) {
+            if (error) {
+                *error = QString("未知的执行模式: %1").arg(object.value("mode").toString());
+            }
+            return false;
+        }
+    }
+
+    if (object.contains("requestIds")) {
+        const QString formatName = object.value("requestIds").toString().toLower();
+        if (formatName == "compact") {
+            requestIdFormat = RequestIdFormat::Compact;
+        } else if (formatName == "uuid") {
+            requestIdFormat = RequestIdFormat::Uuid;
+        } else {
+            if (error) {
+                *error = QString("未知的 request_id 格式: %1").arg(formatName);
+            }
+            return false;
+        }
+    }
+    if (object.contains("loop")) {
+        const QString loopName = object.value("loop").toString().toLower();
+        if (loopName == "open") {
+            loop = LoadLoop::Open;
+        } else if (loopName == "closed") {
+            loop = LoadLoop::Closed;
+        } else {
+            if (error) {
+                *error = QString("未知的发压模式: %1").arg(loopName);
+            }
+            return false;
+        }
+    }
+    if (object.contains("arrival")) {
+        const QString arrivalName = object.value("arrival").toString().toLower();
+        if (arrivalName == "fixed") {
+            arrival = LoadArrival::Fixed;
+        } else if (arrivalName == "poisson") {
+            arrival = LoadArrival::Poisson;
+        } else {
+            if (error) {
+                *error = QString("未知的到达分布: %1").arg(arrivalName);
+            }
+            return false;
+        }
+    }
+
+    if (object.contains("workflows")) {
+        if (!object.value("workflows").isArray()) {
+            if (error) {
+                *error = "workflows 必须是数组";
+            }
+            return false;
+        }
+        workflows = object.value("workflows").toArray();
+    }
+
+    // mix 既可以写成 "save=1,execute=2" 也可以写成 {"save": 1, "execute": 2}
+    const QJsonValue mixValue = object.value("mix");
+    if (mixValue.isString()) {
+        return parseMix(mixValue.toString(), error);
+    }
+    if (mixValue.isObject()) {
+        QStringList items;
+        const QJsonObject mixObject = mixValue.toObject();
+        for (auto it = mixObject.constBegin(); it != mixObject.constEnd(); ++it) {
+            items << QString("%1=%2").arg(it.key()).arg(it.value().toInt());
+        }
+        return parseMix(items.join(','), error);
+    }
+    return true;
+}
+
+QString LoadReport::responseError(const data::MessageFrame &response)
+{
+    switch (response.header().type()) {
+    case data::ERROR_RESPONSE: {
+        const auto &error = response.error_response();
+        if (error.detail().empty()) {
+            return QString::fromStdString(error.message());
+        }
+        return QString::fromStdString(error.message() + ": " + error.detail());
+    }
+    case data::LOGIN_RESPONSE:
+        return response.login_response().success() ? QString() : QStringLiteral("login rejected");
+    case data::SAVE_SOURCE_CODE_RESPONSE:
+        return response.save_source_response().success()
+                   ? QString() : "save: " + QString::fromStdString(response.save_source_response().message());
+    case data::COMPILE_SOURCE_RESPONSE:
+        return response.compile_response().success()
+                   ? QString() : "compile: " + QString::fromStdString(response.compile_response().message());
+    case data::EXECUTE_IR_RESPONSE:
+        return response.execute_ir_response().success()
+                   ? QString() : "execute: " + QString::fromStdString(response.execute_ir_response().error_message());
+    default:
+        return QString("unexpected response type %1").arg(static_cast<int>(response.header().type()));
+    }
+}
+
+QString LoadReport::format() const
+{
+    QString text;
+    QTextStream out(&text);
+    const double seconds = double(elapsedNs) / 1e9;
+
+    out << QString("connections: %1, duration: %2 s, %3 loop\n")
+               .arg(connected).arg(seconds, 0, 'f', 2)
+               .arg(loop == LoadLoop::Open ? "open" : "closed");
+    if (users > 0) {
+        out << QString("virtual users: %1, logged in: %2\n").arg(users).arg(usersLoggedIn);
+    }
+    out << QString("%1 %2 %3 %4 %5\n")
+               .arg("type", -8).arg("sent", 10).arg("ok", 10).arg("failed", 8).arg("ok/s", 10);
+
+    KindStats total;
+    auto printCounts = [&](const QString &name, const KindStats &stats) {
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(name, -8)
+                   .arg(stats.sent, 10)
+                   .arg(stats.succeeded, 10)
+                   .arg(stats.failed, 8)
+                   .arg(seconds > 0 ? double(stats.succeeded) / seconds : 0.0, 10, 'f', 1);
+    };
+    for (int i = 0; i < int(LoadRequestKind::Count); ++i) {
+        const KindStats &stats = kinds[i];
+        if (stats.sent == 0) {
+            continue;
+        }
+        printCounts(QString::fromLatin1(LoadGenerator::kindName(LoadRequestKind(i))), stats);
+        total.sent += stats.sent;
+        total.succeeded += stats.succeeded;
+        total.failed += stats.failed;
+    }
+    printCounts("total", total);
+
+    if (!workflows.isEmpty()) {
+        out << QString("\n%1 %2 %3 %4 %5\n")
+                   .arg("workflow", -20).arg("started", 10).arg("completed", 10).arg("failed", 8)
+                   .arg("abandoned", 10);
+        for (const WorkflowStats &stats : workflows) {
+            out << QString("%1 %2 %3 %4 %5\n")
+                       .arg(stats.name, -20)
+                       .arg(stats.started, 10)
+                       .arg(stats.completed, 10)
+                       .arg(stats.failed, 8)
+                       .arg(stats.abandoned, 10);
+        }
+    }
+
+    printLatency(out, "response time (ms, from intended start)", responseTime);
+    printLatency(out, "service time (ms, from send)", serviceTime);
+
+    if (!errors.isEmpty()) {
+        out << "\nerrors:\n";
+        for (auto it = errors.constBegin(); it != errors.constEnd(); ++it) {
+            out << QString("  %1  %2\n").arg(it.value(), 10).arg(it.key());
+        }
+    }
+    return text;
+}
+
+void LoadReport::writeHistogramLog(QIODevice *device) const
+{
+    HistogramLogWriter writer(device);
+    writer.writeHeader(startTimeMsecs);
+    const double lengthSeconds = double(elapsedNs) / 1e9;
+    for (int slot = 0; slot < LatencyRecorder::SlotCount; ++slot) {
+        const QString name = QString::fromLatin1(LatencyRecorder::slotName(slot));
+        if (responseTime[slot].totalCount() > 0) {
+            writer.writeInterval("response." + name, 0.0, lengthSeconds, responseTime[slot]);
+        }
+        if (serviceTime[slot].totalCount() > 0) {
+            writer.writeInterval("service." + name, 0.0, lengthSeconds, serviceTime[slot]);
+        }
+    }
+}
+
+LoadGenerator::LoadGenerator(const LoadConfig &config, const LoadScenario &scenario, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_scenario(scenario)
+    , m_random(QRandomGenerator::global()->generate())
+    , m_pendingLogins(0)
+    , m_iterations(0)
+    , m_paceTimer(new QTimer(this))
+    , m_durationTimer(new QTimer(this))
+    , m_nextIntendedNs(0)
+    , m_nextConnection(0)
+    , m_stopping(false)
+    , m_finished(false)
+{
+    if (m_scenario.isDeclared()) {
+        for (int i = 0; i < m_scenario.workflowCount(); ++i) {
+            LoadReport::WorkflowStats stats;
+            stats.name = m_scenario.workflow(i).name;
+            m_report.workflows.append(stats);
+        }
+    }
+
+    m_paceTimer->setTimerType(Qt::PreciseTimer);
+    m_paceTimer->setInterval(kPaceIntervalMs);
+    connect(m_paceTimer, &QTimer::timeout, this, &LoadGenerator::onPaceTick);
+
+    m_durationTimer->setSingleShot(true);
+    connect(m_durationTimer, &QTimer::timeout, this, &LoadGenerator::onDurationElapsed);
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    // 连接的批量层里可能攒着虚拟用户的请求，发送失败时回调会同步回到虚拟用户的客户端，先趁它们还在时发出
+    for (ProtoClient *client : std::as_const(m_clients)) {
+        if (RequestBatcher *batcher = client->batcher()) {
+            batcher->flush();
+        }
+    }
+    // 虚拟用户的客户端借用连接的连接池和批量层、引用各自的会话，必须先于二者销毁；
+    // 不能交给 QObject 按创建顺序删除子对象
+    qDeleteAll(m_userClients);
+    qDeleteAll(m_userSessions);
+    qDeleteAll(m_clients);
+}
+
+const char *LoadGenerator::kindName(LoadRequestKind kind)
+{
+    switch (kind) {
+    case LoadRequestKind::Login:
+        return "login";
+    case LoadRequestKind::Save:
+        return "save";
+    case LoadRequestKind::Compile:
+        return "compile";
+    case LoadRequestKind::Execute:
+        return "execute";
+    default:
+        return "unknown";
+    }
+}
+
+bool LoadGenerator::start()
+{
+    // 各连接自身的请求使用默认会话
+    SessionManager::instance().defaultContext().setRequestIdFormat(m_config.requestIdFormat);
+    for (int i = 0; i < m_config.connections; ++i) {
+        auto *client = new ProtoClient(this);
+        client->setBatching(m_config.batchSize, m_config.batchDelayUs);
+        if (client->connectToServer(m_config.host, m_config.port)) {
+            m_clients.append(client);
+        } else {
+            delete client;
+        }
+    }
+    if (m_clients.isEmpty()) {
+        return false;
+    }
+
+    if (m_capture) {
+        for (int i = 0; i < m_clients.size(); ++i) {
+            m_clients[i]->startCapture(m_capture, quint16(i));
+        }
+    }
+
+    m_outstanding.fill(0, m_clients.size());
+    m_report.connected = m_clients.size();
+    if (m_users.isEmpty()) {
+        beginLoad();
+    } else {
+        loginUsers();
+    }
+    return true;
+}
+
+void LoadGenerator::setUsers(const CredentialFeeder &users)
+{
+    m_users = users.credentials();
+}
+
+void LoadGenerator::loginUsers()
+{
+    // 登录请求一次全部发出，在连接上流水线执行；全部有结果后才开始计时发压
+    m_connectionUsers.resize(m_clients.size());
+    m_nextUser.fill(0, m_clients.size());
+    m_pendingLogins = m_users.size();
+    m_report.users = m_users.size();
+    for (int i = 0; i < m_users.size(); ++i) {
+        const Credential &credential = m_users.at(i);
+        const int connection = i % m_clients.size();
+        auto *session = new SessionContext(credential.clientId, this);
+        session->setCredentials(credential.username, credential.passwordHash);
+        session->setRequestIdFormat(m_config.requestIdFormat);
+        auto *client = new ProtoClient(m_clients[connection]->connectionPool(), session, this);
+        // 同一连接上的虚拟用户共用连接的批量层，不同用户的请求合进同一个批次
+        client->shareBatching(m_clients[connection]->batcher());
+        m_userSessions.append(session);
+        m_userClients.append(client);
+        m_connectionUsers[connection].append(i);
+
+        client->login(credential.username, credential.passwordHash, "LoadGenerator", "1.0.0")
+            .then(this, [this](const data::MessageFrame &response) {
+                onUserLoggedIn(response);
+            });
+    }
+}
+
+void LoadGenerator::onUserLoggedIn(const data::MessageFrame &response)
+{
+    const QString error = LoadReport::responseError(response);
+    if (error.isEmpty()) {
+        ++m_report.usersLoggedIn;
+    } else {
+        // 登录失败的用户照常参与发压，其请求的失败会计入对应类型
+        ++m_report.errors["virtual user login: " + error];
+    }
+    if (--m_pendingLogins == 0) {
+        beginLoad();
+    }
+}
+
+void LoadGenerator::beginLoad()
+{
+    m_report.startTimeMsecs = QDateTime::currentMSecsSinceEpoch();
+    m_clock.start();
+    m_durationTimer->start(m_config.durationSec * 1000);
+
+    m_report.loop = isOpenLoop() ? LoadLoop::Open : LoadLoop::Closed;
+    if (m_config.rate > 0) {
+        m_nextIntendedNs = 0;
+        m_paceTimer->start();
+    } else {
+        // 闭环模式：每个连接保持固定数量的工作流在运行，一个结束后立即启动下一个
+        for (int connection = 0; connection < m_clients.size(); ++connection) {
+            for (int i = 0; i < qMax(1, m_config.concurrency); ++i) {
+                issue(connection, m_clock.nsecsElapsed());
+            }
+        }
+    }
+}
+
+void LoadGenerator::onPaceTick()
+{
+    // 把预定时刻已到的请求全部发出；开环不看在途数量，落后时按原时刻补发
+    const qint64 now = m_clock.nsecsElapsed();
+    while (m_nextIntendedNs <= now) {
+        const int connection = pickConnection();
+        if (connection < 0) {
+            // 闭环且所有连接都占满：发送被推迟，等响应回来再继续
+            return;
+        }
+
+        if (isOpenLoop()) {
+            issue(connection, m_nextIntendedNs);
+            m_nextIntendedNs += nextIntervalNs();
+        } else {
+            // 闭环从实际发送时刻计时，下一次按本次实际发送时刻排期，不补发积压
+            issue(connection, now);
+            m_nextIntendedNs = qMax(m_nextIntendedNs, now) + nextIntervalNs();
+        }
+    }
+}
+
+void LoadGenerator::onDurationElapsed()
+{
+    m_stopping = true;
+    m_paceTimer->stop();
+    m_report.elapsedNs = m_clock.nsecsElapsed();
+    finishIfDrained();
+}
+
+bool LoadGenerator::isOpenLoop() const
+{
+    return m_config.rate > 0 && m_config.loop == LoadLoop::Open;
+}
+
+qint64 LoadGenerator::nextIntervalNs()
+{
+    const double meanNs = 1e9 / m_config.rate;
+    if (m_config.arrival == LoadArrival::Poisson) {
+        // 泊松到达：间隔服从均值为 1/rate 的指数分布
+        const double uniform = m_random.generateDouble();
+        return qMax<qint64>(1, qint64(-std::log(1.0 - uniform) * meanNs));
+    }
+    return qMax<qint64>(1, qint64(meanNs));
+}
+
+int LoadGenerator::pickConnection()
+{
+    // 在连接间轮转；闭环时跳过在途请求已满的连接
+    const int count = m_clients.size();
+    for (int attempt = 0; attempt < count; ++attempt) {
+        const int connection = m_nextConnection;
+        m_nextConnection = (m_nextConnection + 1) % count;
+        if (isOpenLoop() || m_outstanding[connection] < qMax(1, m_config.concurrency)) {
+            return connection;
+        }
+    }
+    return -1;
+}
+
+ProtoClient *LoadGenerator::clientFor(const LoadIteration &iteration) const
+{
+    return iteration.user >= 0 ? m_userClients[iteration.user] : m_clients[iteration.connection];
+}
+
+void LoadGenerator::issue(int connection, qint64 intendedStartNs)
+{
+    auto *iteration = new LoadIteration;
+    iteration->workflow = m_scenario.pickWorkflow(m_random);
+    iteration->connection = connection;
+    iteration->number = m_iterations++;
+    if (connection < m_connectionUsers.size() && !m_connectionUsers[connection].isEmpty()) {
+        // 连接上的虚拟用户轮流执行工作流
+        const QVector<int> &users = m_connectionUsers[connection];
+        int &next = m_nextUser[connection];
+        iteration->user = users[next];
+        next = (next + 1) % users.size();
+    }
+    iteration->outputs.resize(m_scenario.workflow(iteration->workflow).steps.size());
+
+    ++m_outstanding[connection];
+    if (m_scenario.isDeclared()) {
+        ++m_report.workflows[iteration->workflow].started;
+    }
+    runStep(iteration, intendedStartNs);
+}
+
+void LoadGenerator::runStep(LoadIteration *iteration, qint64 intendedStartNs)
+{
+    ProtoClient *client = clientFor(*iteration);
+    const LoadStep &step = m_scenario.workflow(iteration->workflow).steps[iteration->step];
+    QString &output = iteration->outputs[iteration->step];
+
+    QFuture<data::MessageFrame> future;
+    switch (step.kind) {
+    case LoadRequestKind::Login:
+        if (iteration->user >= 0) {
+            // 虚拟用户用自己的账号重新登录，场景里的 username/passwordHash 不起作用
+            future = client->login(client->session()->username(), client->session()->passwordHash(),
+                                   "LoadGenerator", "1.0.0");
+        } else {
+            future = client->login(step.username.render(*iteration, m_random),
+                                   step.passwordHash.render(*iteration, m_random), "LoadGenerator", "1.0.0");
+        }
+        break;
+    case LoadRequestKind::Save:
+        // 先记下请求里的 code_id，响应没有回填时后续步骤用它
+        output = step.codeId.render(*iteration, m_random);
+        future = client->saveSourceCode(output, step.language.render(*iteration, m_random), step.source,
+                                        step.codeName.render(*iteration, m_random));
+        break;
+    case LoadRequestKind::Compile:
+        future = client->compileSourceCode(step.codeId.render(*iteration, m_random),
+                                           step.compilerOptions.render(*iteration, m_random), step.optimize,
+                                           step.targetIrVersion.render(*iteration, m_random));
+        break;
+    default: {
+        data::ExecuteIRCodeRequest_ExecutionMode mode = step.executionMode;
+        if (!step.mode.isConstant()) {
+            const QString modeName = step.mode.render(*iteration, m_random).toUpper();
+            if (!data::ExecuteIRCodeRequest_ExecutionMode_Parse(modeName.toStdString(), &mode)) {
+                // 和发送失败一样异步完成，闭环时不会在同一个调用栈里无限重启工作流
+                ++m_report.kinds[int(step.kind)].sent;
+                const data::MessageFrame response = NetworkManager::makeErrorResponse(
+                    std::string(), data::BAD_REQUEST, "未知的执行模式: " + modeName);
+                QMetaObject::invokeMethod(this, [this, iteration, intendedStartNs, response]() {
+                    onResponse(iteration, intendedStartNs, response);
+                }, Qt::QueuedConnection);
+                return;
+            }
+        }
+        QMap<QString, QString> parameters;
+        for (const auto &parameter : step.parameters) {
+            parameters.insert(parameter.first, parameter.second.render(*iteration, m_random));
+        }
+        future = client->executeIrCode(step.irCodeId.render(*iteration, m_random), mode, parameters,
+                                       step.timeoutSec);
+        break;
+    }
+    }
+
+    ++m_report.kinds[int(step.kind)].sent;
+    future.then(this, [this, iteration, intendedStartNs](const data::MessageFrame &response) {
+        onResponse(iteration, intendedStartNs, response);
+    });
+}
+
+void LoadGenerator::onResponse(LoadIteration *iteration, qint64 intendedStartNs,
+                               const data::MessageFrame &response)
+{
+    const LoadWorkflow &workflow = m_scenario.workflow(iteration->workflow);
+    const LoadStep &step = workflow.steps[iteration->step];
+    m_responseTime.record(kindSlot(step.kind), m_clock.nsecsElapsed() - intendedStartNs);
+
+    LoadReport::KindStats &stats = m_report.kinds[int(step.kind)];
+    const QString error = LoadReport::responseError(response);
+    if (!error.isEmpty()) {
+        ++stats.failed;
+        ++m_report.errors[error];
+        // 依赖链断了，本次执行中止
+        if (m_scenario.isDeclared()) {
+            ++m_report.workflows[iteration->workflow].failed;
+        }
+        finishIteration(iteration);
+        return;
+    }
+    ++stats.succeeded;
+
+    const QString output = LoadScenario::stepOutput(step.kind, response);
+    if (!output.isEmpty()) {
+        iteration->outputs[iteration->step] = output;
+    }
+
+    if (++iteration->step == workflow.steps.size()) {
+        if (m_scenario.isDeclared()) {
+            ++m_report.workflows[iteration->workflow].completed;
+        }
+        finishIteration(iteration);
+        return;
+    }
+    if (m_stopping) {
+        if (m_scenario.isDeclared()) {
+            ++m_report.workflows[iteration->workflow].abandoned;
+        }
+        finishIteration(iteration);
+        return;
+    }
+
+    // 下一步的预定时刻是响应时刻加上思考时间，定时器晚到的部分计入下一步的响应时间
+    const int thinkMs = step.thinkTime.sampleMs(m_random);
+    if (thinkMs <= 0) {
+        runStep(iteration, m_clock.nsecsElapsed());
+        return;
+    }
+    const qint64 nextStartNs = m_clock.nsecsElapsed() + qint64(thinkMs) * 1000000;
+    QTimer::singleShot(thinkMs, Qt::PreciseTimer, this, [this, iteration, nextStartNs]() {
+        if (m_stopping) {
+            if (m_scenario.isDeclared()) {
+                ++m_report.workflows[iteration->workflow].abandoned;
+            }
+            finishIteration(iteration);
+            return;
+        }
+        runStep(iteration, nextStartNs);
+    });
+}
+
+void LoadGenerator::finishIteration(LoadIteration *iteration)
+{
+    const int connection = iteration->connection;
+    delete iteration;
+    --m_outstanding[connection];
+
+    if (m_stopping) {
+        finishIfDrained();
+        return;
+    }
+    if (m_config.rate > 0) {
+        // 限速闭环：腾出的名额可能正好有推迟的请求在等
+        if (!isOpenLoop()) {
+            onPaceTick();
+        }
+        return;
+    }
+    // 连接已断开的分片不再补发，其余连接照常运行
+    if (m_clients[connection]->isConnected()) {
+        issue(connection, m_clock.nsecsElapsed());
+    }
+}
+
+void LoadGenerator::finishIfDrained()
+{
+    if (!m_stopping || m_finished) {
+        return;
+    }
+    for (int outstanding : m_outstanding) {
+        if (outstanding > 0) {
+            return;
+        }
+    }
+    m_finished = true;
+    m_responseTime.mergeInto(m_report.responseTime);
+    for (ProtoClient *client : std::as_const(m_clients)) {
+        client->mergeLatencyInto(m_report.serviceTime);
+        if (m_capture) {
+            client->stopCapture();
+        }
+    }
+    emit finished();
+}
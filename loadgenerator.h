@@ -0,0 +1,191 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include <array>
+#include <memory>
+#include "credentialfeeder.h"
+#include "latencyrecorder.h"
+#include "loadscenario.h"
+#include "protoclient.h"
+#include "trafficcapture.h"
+
+// 闭环：连接上的在途请求达到 concurrency 时等待响应再发下一个（服务端排队会拖慢发压，延迟从实际发送算起）；
+// 开环：按预定到达时刻发送，不管有多少请求还没返回，延迟从预定时刻算起（修正协调遗漏）
+enum class LoadLoop {
+    Closed,
+    Open
+};
+
+// 开环/限速闭环的到达间隔：固定间隔，或指数分布间隔（泊松到达）
+enum class LoadArrival {
+    Fixed,
+    Poisson
+};
+
+struct LoadConfig
+{
+    QString host = "127.0.0.1";
+    quint16 port = 8888;
+    int connections = 1;
+    // 目标总速率（请求/秒）；0 表示不限速，此时总是闭环，每个连接保持 concurrency 个在途请求
+    double rate = 0;
+    int concurrency = 1;
+    LoadLoop loop = LoadLoop::Open;
+    LoadArrival arrival = LoadArrival::Fixed;
+    int durationSec = 10;
+    // 各类请求的权重，按比例随机抽取
+    std::array<int, int(LoadRequestKind::Count)> mix = {0, 1, 1, 1};
+
+    QString username = "loadtest";
+    QString passwordHash;
+    // 账号文件（见 CredentialFeeder）；设置后每个账号是一个有独立会话的虚拟用户
+    QString usersFile;
+    RequestIdFormat requestIdFormat = RequestIdFormat::Compact;
+    // 每个连接一个自动批量层（见 RequestBatcher），连接上的虚拟用户共用：
+    // 攒满 batchSize 个请求或等了 batchDelayUs 微秒后合成一帧；<= 1 时关闭
+    int batchSize = 0;
+    int batchDelayUs = RequestBatcher::kDefaultMaxDelayUs;
+    QString codeId = "loadtest-code";
+    QString language = "cpp";
+    int sourceSize = 1024;
+    QString irCodeId = "loadtest-ir";
+    data::ExecuteIRCodeRequest_ExecutionMode executionMode = data::ExecuteIRCodeRequest_ExecutionMode_JIT;
+
+    // 多步工作流声明（见 LoadScenario）；为空时按 mix 发送单个请求
+    QJsonArray workflows;
+
+    // "login=1,save=2,compile=2,execute=5"
+    bool parseMix(const QString &text, QString *error = nullptr);
+    // 场景文件中与命令行同名的键（host、port、connections、rate、mix 等）以及 workflows
+    bool applyJson(const QJsonObject &object, QString *error = nullptr);
+};
+
+struct LoadReport
+{
+    struct KindStats
+    {
+        quint64 sent = 0;
+        quint64 succeeded = 0;
+        quint64 failed = 0;
+    };
+
+    struct WorkflowStats
+    {
+        QString name;
+        quint64 started = 0;
+        quint64 completed = 0;
+        quint64 failed = 0;
+        // 压测结束时还没走完、不再继续的执行
+        quint64 abandoned = 0;
+    };
+
+    std::array<KindStats, int(LoadRequestKind::Count)> kinds;
+    // 只在场景声明了 workflows 时填写
+    QVector<WorkflowStats> workflows;
+    // 响应时间：从预定发送时刻到完成（开环下包含客户端侧排队，闭环下等于服务时间）
+    LatencyRecorder::Snapshot responseTime;
+    // 服务时间：所有连接按请求类型合并的登记到完成时间（纳秒），含心跳往返时间
+    LatencyRecorder::Snapshot serviceTime;
+    LoadLoop loop = LoadLoop::Closed;
+    // 失败原因（ERROR_RESPONSE 的 message 或响应里的错误说明）及次数
+    QMap<QString, quint64> errors;
+    qint64 startTimeMsecs = 0;
+    qint64 elapsedNs = 0;
+    int connected = 0;
+    // 虚拟用户数及发压前登录成功的个数
+    int users = 0;
+    int usersLoggedIn = 0;
+
+    // 成功返回空串，否则返回用于归类统计的失败原因
+    static QString responseError(const data::MessageFrame &response);
+
+    QString format() const;
+    // 每个请求类型一行，Tag 为 response.<类型> / service.<类型>，覆盖整个压测区间
+    void writeHistogramLog(QIODevice *device) const;
+};
+
+// 无界面的压测引擎：打开 N 个 ProtoClient 连接，按场景的权重持续启动工作流（save → compile → execute 等），
+// 步骤之间按思考时间间隔，后续步骤使用前序响应里的 code_id / ir_code_id。
+// 开环时按预定到达时刻启动并从该时刻计延迟，闭环时每个连接同时运行 concurrency 个工作流；
+// 持续 durationSec 秒后停止启动、等待在途请求完成并发出 finished()。
+// 设置了虚拟用户时，各用户按序号轮流分到连接上，先全部登录再开始发压，
+// 每个工作流由所在连接上的下一个用户执行，请求头带该用户自己的 client_id 和 auth_token。
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    // scenario 需已编译成功
+    LoadGenerator(const LoadConfig &config, const LoadScenario &scenario, QObject *parent = nullptr);
+    ~LoadGenerator();
+
+    // 在 start() 之前调用：每个连接收发的帧都记入 capture，连接号即连接序号，压测结束时停止
+    void setCapture(std::shared_ptr<TrafficCapture> capture) { m_capture = std::move(capture); }
+    // 在 start() 之前调用：每个账号一个虚拟用户
+    void setUsers(const CredentialFeeder &users);
+
+    // 建立连接并开始发压；一个连接都连不上时返回 false
+    bool start();
+    const LoadReport &report() const { return m_report; }
+
+    static const char *kindName(LoadRequestKind kind);
+
+signals:
+    void finished();
+
+private slots:
+    void onPaceTick();
+    void onDurationElapsed();
+
+private:
+    void loginUsers();
+    void onUserLoggedIn(const data::MessageFrame &response);
+    void beginLoad();
+    bool isOpenLoop() const;
+    qint64 nextIntervalNs();
+    int pickConnection();
+    ProtoClient *clientFor(const LoadIteration &iteration) const;
+    void issue(int connection, qint64 intendedStartNs);
+    void runStep(LoadIteration *iteration, qint64 intendedStartNs);
+    void onResponse(LoadIteration *iteration, qint64 intendedStartNs, const data::MessageFrame &response);
+    void finishIteration(LoadIteration *iteration);
+    void finishIfDrained();
+
+    LoadConfig m_config;
+    LoadScenario m_scenario;
+    std::shared_ptr<TrafficCapture> m_capture;
+    QRandomGenerator m_random;
+    QVector<ProtoClient *> m_clients;
+    QVector<Credential> m_users;
+    // 虚拟用户：共用连接 m_clients[i % 连接数]，各自持有一个 SessionContext。
+    // 三者都以本对象为父对象，析构时按 客户端、会话、连接 的顺序显式删除
+    QVector<ProtoClient *> m_userClients;
+    QVector<SessionContext *> m_userSessions;
+    // 每个连接上的虚拟用户序号，以及下一个轮到的位置
+    QVector<QVector<int>> m_connectionUsers;
+    QVector<int> m_nextUser;
+    int m_pendingLogins;
+    // 每个连接上正在运行的工作流数
+    QVector<int> m_outstanding;
+    quint64 m_iterations;
+
+    QElapsedTimer m_clock;
+    QTimer *m_paceTimer;
+    QTimer *m_durationTimer;
+    qint64 m_nextIntendedNs;
+    int m_nextConnection;
+    LatencyRecorder m_responseTime;
+    bool m_stopping;
+    bool m_finished;
+    LoadReport m_report;
+};
+
+#endif // LOADGENERATOR_H
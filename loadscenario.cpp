@@ -0,0 +1,393 @@
+#include "loadscenario.h"
+#include "loadgenerator.h"
+#include <QJsonArray>
+#include <QVariant>
+
+namespace {
+using StepList = QVector<QPair<QString, LoadRequestKind>>;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 数字、布尔等标量按文本处理，便于在场景文件里直接写 "n": 100
+QString scalarText(const QJsonValue &value, const QString &fallback)
+{
+    if (value.isUndefined() || value.isNull()) {
+        return fallback;
+    }
+    return value.isString() ? value.toString() : value.toVariant().toString();
+}
+
+// 同名步骤以最近的一个为准
+int findStep(const StepList &steps, const QString &name)
+{
+    for (int i = steps.size() - 1; i >= 0; --i) {
+        if (steps[i].first == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int lastStepOfKind(const StepList &steps, LoadRequestKind kind)
+{
+    for (int i = steps.size() - 1; i >= 0; --i) {
+        if (steps[i].second == kind) {
+            return i;
+        }
+    }
+    return -1;
+}
+}
+
+bool ParamTemplate::compile(const QString &text, const StepList &previousSteps, QString *error)
+{
+    m_constant.clear();
+    m_segments.clear();
+    m_literalSize = 0;
+
+    QVector<Segment> segments;
+    QString literal;
+    qsizetype pos = 0;
+    while (pos < text.size()) {
+        const qsizetype open = text.indexOf("${", pos);
+        if (open < 0) {
+            literal += QStringView(text).mid(pos);
+            break;
+        }
+        literal += QStringView(text).mid(pos, open - pos);
+        const qsizetype close = text.indexOf('}', open + 2);
+        if (close < 0) {
+            setError(error, QString("模板缺少右括号: %1").arg(text));
+            return false;
+        }
+
+        if (!literal.isEmpty()) {
+            Segment segment;
+            segment.text = literal;
+            m_literalSize += literal.size();
+            segments.append(segment);
+            literal.clear();
+        }
+
+        const QString expression = text.mid(open + 2, close - open - 2).trimmed();
+        Segment segment;
+        if (expression == "connection") {
+            segment.kind = SegmentKind::Connection;
+        } else if (expression == "iteration") {
+            segment.kind = SegmentKind::Iteration;
+        } else if (expression.startsWith("random:")) {
+            const QStringList bounds = expression.mid(7).split(':');
+            bool lowOk = false;
+            bool highOk = false;
+            segment.kind = SegmentKind::Random;
+            segment.low = bounds.size() == 2 ? bounds[0].toLongLong(&lowOk) : 0;
+            segment.high = bounds.size() == 2 ? bounds[1].toLongLong(&highOk) : 0;
+            if (!lowOk || !highOk || segment.high < segment.low) {
+                setError(error, QString("无效的随机数范围: ${%1}").arg(expression));
+                return false;
+            }
+        } else if (expression.startsWith("choice:")) {
+            segment.kind = SegmentKind::Choice;
+            segment.choices = expression.mid(7).split('|');
+        } else {
+            const qsizetype dot = expression.indexOf('.');
+            const int step = dot > 0 ? findStep(previousSteps, expression.left(dot)) : -1;
+            if (step < 0) {
+                setError(error, QString("未知的模板变量或引用了后续步骤: ${%1}").arg(expression));
+                return false;
+            }
+            const QString field = expression.mid(dot + 1);
+            const LoadRequestKind kind = previousSteps[step].second;
+            if (field != LoadScenario::outputName(kind)) {
+                setError(error, QString("%1 步骤的输出是 %2，不是 %3")
+                                    .arg(previousSteps[step].first, QString::fromLatin1(LoadScenario::outputName(kind)),
+                                         field));
+                return false;
+            }
+            segment.kind = SegmentKind::StepOutput;
+            segment.step = step;
+        }
+        segments.append(segment);
+        pos = close + 1;
+    }
+
+    if (segments.isEmpty()) {
+        m_constant = literal;
+        return true;
+    }
+    if (!literal.isEmpty()) {
+        Segment segment;
+        segment.text = literal;
+        m_literalSize += literal.size();
+        segments.append(segment);
+    }
+    m_segments = std::move(segments);
+    return true;
+}
+
+QString ParamTemplate::render(const LoadIteration &iteration, QRandomGenerator &random) const
+{
+    if (m_segments.isEmpty()) {
+        return m_constant;
+    }
+
+    QString result;
+    result.reserve(m_literalSize + 32);
+    for (const Segment &segment : m_segments) {
+        switch (segment.kind) {
+        case SegmentKind::Literal:
+            result += segment.text;
+            break;
+        case SegmentKind::Connection:
+            result += QString::number(iteration.connection);
+            break;
+        case SegmentKind::Iteration:
+            result += QString::number(iteration.number);
+            break;
+        case SegmentKind::Random:
+            result += QString::number(random.bounded(segment.low, segment.high + 1));
+            break;
+        case SegmentKind::Choice:
+            result += segment.choices.at(int(random.bounded(quint32(segment.choices.size()))));
+            break;
+        case SegmentKind::StepOutput:
+            result += iteration.outputs.value(segment.step);
+            break;
+        }
+    }
+    return result;
+}
+
+bool LoadScenario::compile(const LoadConfig &config, QString *error)
+{
+    m_workflows.clear();
+    m_cumulativeWeights.clear();
+    m_totalWeight = 0;
+    m_sources.clear();
+    m_declared = !config.workflows.isEmpty();
+
+    if (m_declared) {
+        for (int i = 0; i < config.workflows.size(); ++i) {
+            if (!config.workflows[i].isObject()) {
+                setError(error, QString("第 %1 个工作流不是对象").arg(i + 1));
+                return false;
+            }
+            LoadWorkflow workflow;
+            workflow.name = QString("workflow-%1").arg(i + 1);
+            if (!compileWorkflow(config.workflows[i].toObject(), config, &workflow, error)) {
+                return false;
+            }
+            m_workflows.append(workflow);
+        }
+    } else {
+        // 没有声明工作流：每种请求一个单步工作流，权重取自 mix
+        for (int i = 0; i < int(LoadRequestKind::Count); ++i) {
+            if (config.mix[i] <= 0) {
+                continue;
+            }
+            const QString name = QString::fromLatin1(LoadGenerator::kindName(LoadRequestKind(i)));
+            LoadWorkflow workflow;
+            workflow.name = name;
+            workflow.weight = config.mix[i];
+            LoadStep step;
+            if (!compileStep(QJsonObject{{"type", name}}, config, {}, &step, error)) {
+                return false;
+            }
+            workflow.steps.append(step);
+            m_workflows.append(workflow);
+        }
+    }
+
+    for (const LoadWorkflow &workflow : std::as_const(m_workflows)) {
+        m_totalWeight += workflow.weight;
+        m_cumulativeWeights.append(m_totalWeight);
+    }
+    if (m_totalWeight <= 0) {
+        setError(error, "工作流的权重之和必须大于 0");
+        return false;
+    }
+    return true;
+}
+
+int LoadScenario::pickWorkflow(QRandomGenerator &random) const
+{
+    const int value = int(random.bounded(quint32(m_totalWeight)));
+    for (int i = 0; i < m_cumulativeWeights.size(); ++i) {
+        if (value < m_cumulativeWeights[i]) {
+            return i;
+        }
+    }
+    return m_cumulativeWeights.size() - 1;
+}
+
+QString LoadScenario::stepOutput(LoadRequestKind kind, const data::MessageFrame &response)
+{
+    switch (kind) {
+    case LoadRequestKind::Login:
+        return QString::fromStdString(response.login_response().session_id());
+    case LoadRequestKind::Save:
+        return QString::fromStdString(response.save_source_response().code_id());
+    case LoadRequestKind::Compile:
+        return QString::fromStdString(response.compile_response().ir_code_id());
+    default:
+        return QString::fromStdString(response.execute_ir_response().execution_result());
+    }
+}
+
+const char *LoadScenario::outputName(LoadRequestKind kind)
+{
+    switch (kind) {
+    case LoadRequestKind::Login:
+        return "sessionId";
+    case LoadRequestKind::Save:
+        return "codeId";
+    case LoadRequestKind::Compile:
+        return "irCodeId";
+    default:
+        return "result";
+    }
+}
+
+bool LoadScenario::compileWorkflow(const QJsonObject &object, const LoadConfig &config, LoadWorkflow *workflow,
+                                   QString *error)
+{
+    workflow->name = object.value("name").toString(workflow->name);
+    workflow->weight = object.value("weight").toInt(1);
+    if (workflow->weight < 0) {
+        setError(error, QString("工作流 %1 的权重不能为负数").arg(workflow->name));
+        return false;
+    }
+
+    const QJsonArray steps = object.value("steps").toArray();
+    if (steps.isEmpty()) {
+        setError(error, QString("工作流 %1 没有步骤").arg(workflow->name));
+        return false;
+    }
+
+    StepList previousSteps;
+    for (const QJsonValue &value : steps) {
+        LoadStep step;
+        QString stepError;
+        if (!compileStep(value.toObject(), config, previousSteps, &step, &stepError)) {
+            setError(error, QString("工作流 %1 第 %2 步: %3")
+                                .arg(workflow->name).arg(previousSteps.size() + 1).arg(stepError));
+            return false;
+        }
+        previousSteps.append({step.name, step.kind});
+        workflow->steps.append(step);
+    }
+    return true;
+}
+
+bool LoadScenario::compileStep(const QJsonObject &object, const LoadConfig &config,
+                               const StepList &previousSteps, LoadStep *step, QString *error)
+{
+    const QString type = object.value("type").toString().toLower();
+    int kindIndex = -1;
+    for (int i = 0; i < int(LoadRequestKind::Count); ++i) {
+        if (type == LoadGenerator::kindName(LoadRequestKind(i))) {
+            kindIndex = i;
+        }
+    }
+    if (kindIndex < 0) {
+        setError(error, QString("未知的步骤类型: %1").arg(type));
+        return false;
+    }
+    step->kind = LoadRequestKind(kindIndex);
+    step->name = object.value("name").toString(type);
+
+    auto compileField = [&](const char *key, const QString &fallback, ParamTemplate *field) {
+        return field->compile(scalarText(object.value(key), fallback), previousSteps, error);
+    };
+
+    switch (step->kind) {
+    case LoadRequestKind::Login:
+        if (!compileField("username", config.username, &step->username)
+            || !compileField("passwordHash", config.passwordHash, &step->passwordHash)) {
+            return false;
+        }
+        break;
+    case LoadRequestKind::Save:
+        if (!compileField("codeId", config.codeId, &step->codeId)
+            || !compileField("language", config.language, &step->language)
+            || !compileField("codeName", QString(), &step->codeName)) {
+            return false;
+        }
+        step->source = object.contains("source")
+                           ? object.value("source").toString()
+                           : sourceOfSize(object.value("sourceSize").toInt(config.sourceSize));
+        break;
+    case LoadRequestKind::Compile: {
+        // 默认编译本工作流里最近一次保存的代码
+        const int save = lastStepOfKind(previousSteps, LoadRequestKind::Save);
+        const QString defaultCodeId = save >= 0 ? QString("${%1.codeId}").arg(previousSteps[save].first)
+                                                : config.codeId;
+        if (!compileField("codeId", defaultCodeId, &step->codeId)
+            || !compileField("compilerOptions", QString(), &step->compilerOptions)
+            || !compileField("targetIrVersion", QString(), &step->targetIrVersion)) {
+            return false;
+        }
+        step->optimize = object.value("optimize").toBool(false);
+        break;
+    }
+    default: {
+        // 默认执行本工作流里最近一次编译出的 IR
+        const int compile = lastStepOfKind(previousSteps, LoadRequestKind::Compile);
+        const QString defaultIrCodeId = compile >= 0
+                                            ? QString("${%1.irCodeId}").arg(previousSteps[compile].first)
+                                            : config.irCodeId;
+        const QString defaultMode = QString::fromStdString(
+            data::ExecuteIRCodeRequest_ExecutionMode_Name(config.executionMode));
+        if (!compileField("irCodeId", defaultIrCodeId, &step->irCodeId)
+            || !compileField("mode", defaultMode, &step->mode)) {
+            return false;
+        }
+        if (step->mode.isConstant()) {
+            const QString mode = step->mode.render(LoadIteration(), *QRandomGenerator::global());
+            if (!data::ExecuteIRCodeRequest_ExecutionMode_Parse(mode.toUpper().toStdString(),
+                                                                &step->executionMode)) {
+                setError(error, QString("未知的执行模式: %1").arg(mode));
+                return false;
+            }
+        }
+
+        const QJsonObject parameters = object.value("parameters").toObject();
+        for (auto it = parameters.constBegin(); it != parameters.constEnd(); ++it) {
+            ParamTemplate value;
+            if (!value.compile(scalarText(it.value(), QString()), previousSteps, error)) {
+                return false;
+            }
+            step->parameters.append({it.key(), value});
+        }
+        step->timeoutSec = uint32_t(qMax(1, object.value("timeout").toInt(30)));
+        break;
+    }
+    }
+
+    return step->thinkTime.parse(object.value("thinkTime"), error);
+}
+
+QString LoadScenario::sourceOfSize(int size)
+{
+    // 同样大小的源码只生成一次，各步骤共享同一份（隐式共享）
+    for (const auto &source : std::as_const(m_sources)) {
+        if (source.first == size) {
+            return source.second;
+        }
+    }
+
+    static const QString line = "int add(int a, int b) { return a + b; }\n";
+    QString source;
+    source.reserve(size + line.size());
+    while (source.size() < size) {
+        source += line;
+    }
+    source.truncate(size);
+    m_sources.append({size, source});
+    return source;
+}
@@ -0,0 +1,157 @@
+#ifndef LOADSCENARIO_H
+#define LOADSCENARIO_H
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QPair>
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "randomdistribution.h"
+#include "protoc/data_proto.pb.h"
+
+struct LoadConfig;
+
+// 压测请求类型，顺序即报告中的输出顺序
+enum class LoadRequestKind {
+    Login,
+    Save,
+    Compile,
+    Execute,
+    Count
+};
+
+// 一次工作流执行的状态，模板变量和前序步骤的输出都从这里取
+struct LoadIteration
+{
+    int workflow = 0;
+    int step = 0;
+    int connection = 0;
+    // 执行本次工作流的虚拟用户（见 LoadGenerator::setUsers）；-1 表示使用连接自身的会话
+    int user = -1;
+    quint64 number = 0;
+    // 每个步骤响应里提取的值：login 的 session_id、save 的 code_id、compile 的 ir_code_id、execute 的执行结果
+    QVector<QString> outputs;
+};
+
+// 预编译的参数模板。支持的占位符：
+//   ${connection}          连接序号
+//   ${iteration}           工作流执行序号（全局递增）
+//   ${random:MIN:MAX}      [MIN, MAX] 内的随机整数
+//   ${choice:A|B|C}        随机选一项
+//   ${STEP.FIELD}          前序步骤的输出，例如 ${save.codeId}、${compile.irCodeId}
+// 不含占位符的模板直接返回编译时保存的字符串，不产生分配。
+class ParamTemplate
+{
+public:
+    // previousSteps 是当前步骤之前的步骤（名称, 类型），${STEP.FIELD} 只能引用它们
+    bool compile(const QString &text, const QVector<QPair<QString, LoadRequestKind>> &previousSteps,
+                 QString *error);
+    bool isConstant() const { return m_segments.isEmpty(); }
+    QString render(const LoadIteration &iteration, QRandomGenerator &random) const;
+
+private:
+    enum class SegmentKind {
+        Literal,
+        Connection,
+        Iteration,
+        Random,
+        Choice,
+        StepOutput
+    };
+
+    struct Segment
+    {
+        SegmentKind kind = SegmentKind::Literal;
+        QString text;
+        QStringList choices;
+        qint64 low = 0;
+        qint64 high = 0;
+        int step = -1;
+    };
+
+    QString m_constant;
+    QVector<Segment> m_segments;
+    qsizetype m_literalSize = 0;
+};
+
+// 步骤之后、下一步之前的思考时间（毫秒），写法见 RandomDistribution，
+// 例如 {"distribution": "uniform", "min": 10, "max": 50}
+struct ThinkTime
+{
+    RandomDistribution distribution;
+
+    bool parse(const QJsonValue &value, QString *error) { return distribution.parse(value, "思考时间", error); }
+    int sampleMs(QRandomGenerator &random) const { return qRound(distribution.sample(random)); }
+};
+
+struct LoadStep
+{
+    LoadRequestKind kind = LoadRequestKind::Execute;
+    QString name;
+
+    ParamTemplate username;
+    ParamTemplate passwordHash;
+
+    ParamTemplate codeId;
+    ParamTemplate language;
+    ParamTemplate codeName;
+    QString source;
+
+    ParamTemplate compilerOptions;
+    ParamTemplate targetIrVersion;
+    bool optimize = false;
+
+    ParamTemplate irCodeId;
+    // 模板是常量时编译期解析成 executionMode，否则每次渲染后解析
+    ParamTemplate mode;
+    data::ExecuteIRCodeRequest_ExecutionMode executionMode = data::ExecuteIRCodeRequest_ExecutionMode_JIT;
+    QVector<QPair<QString, ParamTemplate>> parameters;
+    uint32_t timeoutSec = 30;
+
+    ThinkTime thinkTime;
+};
+
+struct LoadWorkflow
+{
+    QString name;
+    int weight = 1;
+    QVector<LoadStep> steps;
+};
+
+// 压测场景：一组按权重抽取的工作流，每个工作流按顺序执行若干步骤，某一步失败时本次执行中止。
+// 在开始发压前编译一次（模板解析、源码生成、依赖检查），运行时只做渲染。
+// 配置里没有 workflows 时，按 mix 为每种请求生成一个单步工作流。
+class LoadScenario
+{
+public:
+    bool compile(const LoadConfig &config, QString *error = nullptr);
+
+    // 场景来自配置里声明的 workflows，而不是由 mix 生成
+    bool isDeclared() const { return m_declared; }
+    int workflowCount() const { return m_workflows.size(); }
+    const LoadWorkflow &workflow(int index) const { return m_workflows.at(index); }
+    int pickWorkflow(QRandomGenerator &random) const;
+
+    // 从成功的响应中取出步骤输出（见 LoadIteration::outputs）；响应里没有时返回空串，
+    // 调用方保留发送时记下的请求值（例如服务端没有回填 code_id 的保存响应）
+    static QString stepOutput(LoadRequestKind kind, const data::MessageFrame &response);
+    static const char *outputName(LoadRequestKind kind);
+
+private:
+    bool compileWorkflow(const QJsonObject &object, const LoadConfig &config, LoadWorkflow *workflow,
+                         QString *error);
+    bool compileStep(const QJsonObject &object, const LoadConfig &config,
+                     const QVector<QPair<QString, LoadRequestKind>> &previousSteps, LoadStep *step,
+                     QString *error);
+    QString sourceOfSize(int size);
+
+    QVector<LoadWorkflow> m_workflows;
+    QVector<int> m_cumulativeWeights;
+    int m_totalWeight = 0;
+    bool m_declared = false;
+    QVector<QPair<int, QString>> m_sources;
+};
+
+#endif // LOADSCENARIO_H
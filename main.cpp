@@ -1,10 +1,17 @@
 #include "mainwindow.h"
+#include "loadgenerator.h"
+#include "trafficcapture.h"
+#include "trafficreplayer.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonDocument>
 #include <QStyleFactory>
 #include <QFile>
 #include <QTextStream>
 #include <QDateTime>
 #include <QDir>
+#include <QThread>
 
 void setupApplication()
 {
@@ -24,8 +31,216 @@ void setupApplication()
     }
 }
 
+bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 无界面压测模式：不创建任何窗口部件，按命令行或场景文件驱动 LoadGenerator
+int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ProtoClientTester");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("YourCompany");
+    QCoreApplication::setOrganizationDomain("yourcompany.com");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ProtoClientTester headless load generator");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        {"headless", "Run without GUI as a load generator."},
+        {"scenario", "JSON file with the same keys as the options below, plus \"workflows\".", "file"},
+        {"host", "Server host.", "host"},
+        {"port", "Server port.", "port"},
+        {"connections", "Number of connections.", "n"},
+        {"rate", "Target total requests per second (0 = unthrottled closed loop).", "rps"},
+        {"loop", "With --rate: open (intended-start schedule, default) or closed.", "loop"},
+        {"arrival", "Inter-arrival times with --rate: fixed or poisson.", "arrival"},
+        {"concurrency", "In-flight requests per connection in closed loop.", "n"},
+        {"duration", "Test duration in seconds.", "seconds"},
+        {"mix", "Request mix, e.g. login=1,save=2,compile=2,execute=5.", "mix"},
+        {"username", "Login username.", "name"},
+        {"password-hash", "Login password hash.", "hash"},
+        {"users", "File with one username,passwordHash[,clientId] per line; each becomes a virtual user.", "file"},
+        {"code-id", "code_id for save/compile.", "id"},
+        {"ir-code-id", "ir_code_id for execute.", "id"},
+        {"source-size", "Source size in characters for save.", "chars"},
+        {"mode", "Execution mode: JIT, INTERPRET or BOTH.", "mode"},
+        {"request-ids", "request_id format: compact (prefix + counter, default) or uuid.", "format"},
+        {"batch", "Coalesce save/compile/execute requests into BatchRequest frames of up to n requests.", "n"},
+        {"batch-delay", "Longest time a request waits for its batch to fill (default 200).", "us"},
+        {"histogram-log", "Write per-request-type latency histograms in HdrHistogram log format.", "file"},
+        {"capture", "Record every inbound and outbound frame of the run into a capture file.", "file"},
+        {"replay", "Replay the outbound requests of a capture file instead of generating load.", "file"},
+        {"speed", "Replay speed: 1 = original timing, N = N times faster, max = as fast as possible.", "factor"},
+        {"max-in-flight", "Outstanding request limit when replaying at max speed.", "n"},
+        {"io-threads", "I/O threads shared by the replay connections.", "n"},
+        {"auth-token", "auth_token written into replayed request headers.", "token"},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    LoadConfig config;
+    QString error;
+
+    // 先读场景文件，命令行参数覆盖文件中的同名设置
+    if (parser.isSet("scenario")) {
+        QFile file(parser.value("scenario"));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "无法打开场景文件: " << file.fileName() << Qt::endl;
+            return 2;
+        }
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (!document.isObject()) {
+            err << "场景文件格式错误: " << parseError.errorString() << Qt::endl;
+            return 2;
+        }
+        if (!config.applyJson(document.object(), &error)) {
+            err << error << Qt::endl;
+            return 2;
+        }
+    }
+
+    QJsonObject overrides;
+    const QStringList intOptions = {"port", "connections", "concurrency", "duration"};
+    for (const QString &name : intOptions) {
+        if (parser.isSet(name)) {
+            overrides.insert(name, parser.value(name).toInt());
+        }
+    }
+    if (parser.isSet("rate")) {
+        overrides.insert("rate", parser.value("rate").toDouble());
+    }
+    if (parser.isSet("source-size")) {
+        overrides.insert("sourceSize", parser.value("source-size").toInt());
+    }
+    if (parser.isSet("batch")) {
+        overrides.insert("batch", parser.value("batch").toInt());
+    }
+    if (parser.isSet("batch-delay")) {
+        overrides.insert("batchDelayUs", parser.value("batch-delay").toInt());
+    }
+    const QList<QPair<QString, QString>> stringOptions = {
+        {"host", "host"}, {"mix", "mix"}, {"username", "username"}, {"password-hash", "passwordHash"},
+        {"users", "users"}, {"code-id", "codeId"}, {"ir-code-id", "irCodeId"}, {"mode", "mode"},
+        {"loop", "loop"}, {"arrival", "arrival"}, {"request-ids", "requestIds"}};
+    for (const auto &option : stringOptions) {
+        if (parser.isSet(option.first)) {
+            overrides.insert(option.second, parser.value(option.first));
+        }
+    }
+    if (!config.applyJson(overrides, &error)) {
+        err << error << Qt::endl;
+        return 2;
+    }
+
+    auto writeResults = [&](const LoadReport &report) {
+        QTextStream(stdout) << report.format();
+        if (parser.isSet("histogram-log")) {
+            QFile logFile(parser.value("histogram-log"));
+            if (logFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                report.writeHistogramLog(&logFile);
+            } else {
+                err << "无法写入直方图日志: " << logFile.fileName() << Qt::endl;
+            }
+        }
+    };
+
+    if (parser.isSet("replay")) {
+        ReplayConfig replay;
+        replay.capturePath = parser.value("replay");
+        replay.host = config.host;
+        replay.port = config.port;
+        replay.connections = config.connections;
+        replay.ioThreads = parser.isSet("io-threads") ? parser.value("io-threads").toInt()
+                                                      : qMin(config.connections, QThread::idealThreadCount());
+        const QString speed = parser.value("speed");
+        replay.speed = speed.isEmpty() ? 1.0 : (speed == "max" ? 0.0 : speed.toDouble());
+        if (parser.isSet("max-in-flight")) {
+            replay.maxInFlight = qMax(1, parser.value("max-in-flight").toInt());
+        }
+        replay.authToken = parser.value("auth-token");
+
+        GOOGLE_PROTOBUF_VERIFY_VERSION;
+        int ret = 0;
+        {
+            TrafficReplayer replayer(replay);
+            QObject::connect(&replayer, &TrafficReplayer::finished, &app, &QCoreApplication::quit);
+            if (!replayer.start(&error)) {
+                err << error << Qt::endl;
+                ret = 1;
+            } else {
+                ret = app.exec();
+                writeResults(replayer.report());
+            }
+        }
+        google::protobuf::ShutdownProtobufLibrary();
+        return ret;
+    }
+
+    // 场景在开始发压前编译一次，配置错误在这里报告
+    LoadScenario scenario;
+    if (!scenario.compile(config, &error)) {
+        err << error << Qt::endl;
+        return 2;
+    }
+
+    CredentialFeeder users;
+    if (!config.usersFile.isEmpty() && !users.load(config.usersFile, &error)) {
+        err << error << Qt::endl;
+        return 2;
+    }
+
+    std::shared_ptr<TrafficCapture> capture;
+    if (parser.isSet("capture")) {
+        capture = std::make_shared<TrafficCapture>();
+        if (!capture->open(parser.value("capture"), &error)) {
+            err << error << Qt::endl;
+            return 2;
+        }
+    }
+
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    int ret = 0;
+    {
+        LoadGenerator generator(config, scenario);
+        generator.setCapture(capture);
+        generator.setUsers(users);
+        QObject::connect(&generator, &LoadGenerator::finished, &app, &QCoreApplication::quit);
+        if (!generator.start()) {
+            err << "无法连接到服务器 " << config.host << ":" << config.port << Qt::endl;
+            ret = 1;
+        } else {
+            ret = app.exec();
+            writeResults(generator.report());
+            if (capture) {
+                capture->close();
+                if (capture->droppedChunks() > 0) {
+                    err << "抓包写盘跟不上，丢弃了 " << capture->droppedChunks() << " 个记录块" << Qt::endl;
+                }
+            }
+        }
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return ret;
+}
+
 int main(int argc, char *argv[])
 {
+    if (isHeadless(argc, argv)) {
+        return runHeadless(argc, argv);
+    }
+
     QApplication a(argc, argv);
 
     // 设置应用程序
@@ -40,6 +255,9 @@ int main(int argc, char *argv[])
 
     int ret = a.exec();
 
+    // 会话和账号是后写的，退出前写完
+    SessionManager::instance().flush();
+
     // 清理protobuf
     google::protobuf::ShutdownProtobufLibrary();
 
@@ -200,17 +200,27 @@ void MainWindow::on_pushButtonExecute_clicked()
         return;
     }
 
-    data::ExecuteIRCodeRequest_ExecutionMode mode;
-    switch (ui->comboBoxExecMode->currentIndex()) {
-    case 0: mode = data::ExecuteIRCodeRequest_ExecutionMode_JIT; break;
-    case 1: mode = data::ExecuteIRCodeRequest_ExecutionMode_INTERPRET; break;
-    case 2: mode = data::ExecuteIRCodeRequest_ExecutionMode_BOTH; break;
-    default: mode = data::ExecuteIRCodeRequest_ExecutionMode_JIT;
+    uint32_t timeout = static_cast<uint32_t>(ui->spinBoxTimeout->value());
+
+    m_client->executeIrCode(irCodeId, selectedExecutionMode(), {}, timeout);
+}
+
+void MainWindow::on_pushButtonRunPipeline_clicked()
+{
+    QString codeId = ui->lineEditCodeId->text();
+    QString language = ui->comboBoxLanguage->currentText();
+    QString sourceCode = ui->textEditSourceCode->toPlainText();
+    QString codeName = ui->lineEditCodeName->text();
+
+    if (sourceCode.isEmpty()) {
+        QMessageBox::warning(this, "输入错误", "源代码不能为空");
+        return;
     }
 
     uint32_t timeout = static_cast<uint32_t>(ui->spinBoxTimeout->value());
 
-    m_client->executeIrCode(irCodeId, mode, {}, timeout);
+    // 各步结果照常通过 saveSourceCodeResult / compileResult / executeResult 显示
+    m_client->runPipeline(codeId, language, sourceCode, codeName, "", false, selectedExecutionMode(), {}, timeout);
 }
 
 void MainWindow::on_pushButtonClearResult_clicked()
@@ -301,3 +311,13 @@ void MainWindow::showStatusMessage(const QString &message, int timeout)
 {
     ui->statusBar->showMessage(message, timeout);
 }
+
+data::ExecuteIRCodeRequest_ExecutionMode MainWindow::selectedExecutionMode() const
+{
+    switch (ui->comboBoxExecMode->currentIndex()) {
+    case 0: return data::ExecuteIRCodeRequest_ExecutionMode_JIT;
+    case 1: return data::ExecuteIRCodeRequest_ExecutionMode_INTERPRET;
+    case 2: return data::ExecuteIRCodeRequest_ExecutionMode_BOTH;
+    default: return data::ExecuteIRCodeRequest_ExecutionMode_JIT;
+    }
+}
@@ -34,6 +34,7 @@ private slots:
     void on_pushButtonSaveSource_clicked();
     void on_pushButtonCompile_clicked();
     void on_pushButtonExecute_clicked();
+    void on_pushButtonRunPipeline_clicked();
     void on_pushButtonClearResult_clicked();
     void on_pushButtonLoadSource_clicked();
 
@@ -45,6 +46,7 @@ private:
     void loadSettings();
     void saveSettings();
     void showStatusMessage(const QString &message, int timeout = 5000);
+    data::ExecuteIRCodeRequest_ExecutionMode selectedExecutionMode() const;
 
     Ui::MainWindow *ui;
     ProtoClient *m_client;
@@ -0,0 +1,111 @@
+#include "mockserver.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QTimer>
+
+// 本地模拟服务端：按 4 字节大端长度前缀 + data::MessageFrame 协议应答，
+// 用于在没有真实后端时跑压测、基准和回放
+int main(int argc, char *argv[])
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("protoclient_mockserver");
+    QCoreApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mock MessageFrame server for ProtoClientTester");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        {"config", "JSON file with port, threads, notificationsPerSec, notificationSize, sessionTtlSec, atomicBatches and per-type \"responses\".", "file"},
+        {"port", "Listen port.", "port"},
+        {"threads", "I/O threads.", "n"},
+        {"notify-rate", "Notification pushes per second across all connections.", "per-second"},
+        {"session-ttl", "Seconds until a login session expires (login responses carry now + ttl).", "seconds"},
+        {"atomic-batches", "How to handle need_atomic batches: chain (default), reject or ignore.", "mode"},
+        {"stats", "Print throughput once per second."},
+    });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    MockServerConfig config;
+    QString error;
+
+    // 先读配置文件，命令行参数覆盖文件中的同名设置
+    if (parser.isSet("config")) {
+        QFile file(parser.value("config"));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "无法打开配置文件: " << file.fileName() << Qt::endl;
+            return 2;
+        }
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (!document.isObject()) {
+            err << "配置文件格式错误: " << parseError.errorString() << Qt::endl;
+            return 2;
+        }
+        if (!config.applyJson(document.object(), &error)) {
+            err << error << Qt::endl;
+            return 2;
+        }
+    }
+
+    QJsonObject overrides;
+    if (parser.isSet("port")) {
+        overrides.insert("port", parser.value("port").toInt());
+    }
+    if (parser.isSet("threads")) {
+        overrides.insert("threads", parser.value("threads").toInt());
+    }
+    if (parser.isSet("notify-rate")) {
+        overrides.insert("notificationsPerSec", parser.value("notify-rate").toDouble());
+    }
+    if (parser.isSet("session-ttl")) {
+        overrides.insert("sessionTtlSec", parser.value("session-ttl").toLongLong());
+    }
+    if (parser.isSet("atomic-batches")) {
+        overrides.insert("atomicBatches", parser.value("atomic-batches"));
+    }
+    if (!config.applyJson(overrides, &error)) {
+        err << error << Qt::endl;
+        return 2;
+    }
+
+    MockServer server(config);
+    if (!server.start(&error)) {
+        err << error << Qt::endl;
+        return 1;
+    }
+    QTextStream(stdout) << "Mock server listening on port " << server.serverPort()
+                        << " with " << config.threads << " I/O threads" << Qt::endl;
+
+    QTimer statsTimer;
+    QElapsedTimer statsClock;
+    MockStats last;
+    if (parser.isSet("stats")) {
+        statsClock.start();
+        QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+            const MockStats now = server.stats();
+            const double seconds = qMax(1e-3, double(statsClock.restart()) / 1000.0);
+            QTextStream(stdout) << QString("conns %1  in %2/s  out %3/s  errors %4/s  notify %5/s  %6 MB/s out")
+                                       .arg(now.connections)
+                                       .arg(qRound64(double(now.framesIn - last.framesIn) / seconds))
+                                       .arg(qRound64(double(now.framesOut - last.framesOut) / seconds))
+                                       .arg(qRound64(double(now.errors - last.errors) / seconds))
+                                       .arg(qRound64(double(now.notifications - last.notifications) / seconds))
+                                       .arg(double(now.bytesOut - last.bytesOut) / seconds / (1024 * 1024), 0, 'f', 1)
+                                << Qt::endl;
+            last = now;
+        });
+        statsTimer.start(1000);
+    }
+
+    const int result = app.exec();
+    google::protobuf::ShutdownProtobufLibrary();
+    return result;
+}
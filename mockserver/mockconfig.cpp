@@ -0,0 +1,121 @@
+#include "mockconfig.h"
+
+namespace {
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+bool applyProfile(const QJsonObject &object, MockResponseProfile *profile, QString *error)
+{
+    if (object.contains("latency") && !profile->latency.parse(object.value("latency"), error)) {
+        return false;
+    }
+    if (object.contains("errorRate")) {
+        profile->errorRate = object.value("errorRate").toDouble();
+        if (profile->errorRate < 0 || profile->errorRate > 1) {
+            setError(error, "errorRate 必须在 0 到 1 之间");
+            return false;
+        }
+    }
+    if (object.contains("errorStatus")) {
+        const QString name = object.value("errorStatus").toString().toUpper();
+        if (!data::StatusCode_Parse(name.toStdString(), &profile->errorStatus)) {
+            setError(error, QString("未知的状态码: %1").arg(name));
+            return false;
+        }
+    }
+    if (object.contains("commonCode")) {
+        profile->commonCode = object.value("commonCode").toInt(-1);
+    }
+    if (object.contains("networkCode")) {
+        profile->networkCode = object.value("networkCode").toInt(-1);
+    }
+    if (object.contains("responseSize")) {
+        profile->responseSize = qMax(0, object.value("responseSize").toInt());
+    }
+    return true;
+}
+}
+
+bool MockServerConfig::applyJson(const QJsonObject &object, QString *error)
+{
+    if (object.contains("port")) {
+        port = static_cast<quint16>(object.value("port").toInt(port));
+    }
+    if (object.contains("threads")) {
+        threads = qMax(1, object.value("threads").toInt(threads));
+    }
+    if (object.contains("notificationsPerSec")) {
+        notificationsPerSec = qMax(0.0, object.value("notificationsPerSec").toDouble());
+    }
+    if (object.contains("notificationSize")) {
+        notificationSize = qMax(0, object.value("notificationSize").toInt());
+    }
+    if (object.contains("sessionTtlSec")) {
+        sessionTtlSec = qMax<qint64>(0, object.value("sessionTtlSec").toInteger(sessionTtlSec));
+    }
+    if (object.contains("atomicBatches")) {
+        const QString mode = object.value("atomicBatches").toString().toLower();
+        if (mode == "chain") {
+            atomicBatches = MockAtomicBatches::Chain;
+        } else if (mode == "reject") {
+            atomicBatches = MockAtomicBatches::Reject;
+        } else if (mode == "ignore") {
+            atomicBatches = MockAtomicBatches::Ignore;
+        } else {
+            setError(error, QString("atomicBatches 只能是 chain、reject 或 ignore: %1").arg(mode));
+            return false;
+        }
+    }
+
+    const QJsonObject responses = object.value("responses").toObject();
+    if (responses.contains("default")) {
+        for (MockResponseProfile &profile : profiles) {
+            if (!applyProfile(responses.value("default").toObject(), &profile, error)) {
+                return false;
+            }
+        }
+    }
+    for (auto it = responses.constBegin(); it != responses.constEnd(); ++it) {
+        if (it.key() == "default") {
+            continue;
+        }
+        int index = -1;
+        for (int i = 0; i < int(MockRequestKind::Count); ++i) {
+            if (it.key() == kindName(MockRequestKind(i))) {
+                index = i;
+            }
+        }
+        if (index < 0) {
+            setError(error, QString("未知的请求类型: %1").arg(it.key()));
+            return false;
+        }
+        QString profileError;
+        if (!applyProfile(it.value().toObject(), &profiles[index], &profileError)) {
+            setError(error, QString("%1: %2").arg(it.key(), profileError));
+            return false;
+        }
+    }
+    return true;
+}
+
+const char *MockServerConfig::kindName(MockRequestKind kind)
+{
+    switch (kind) {
+    case MockRequestKind::Login:
+        return "login";
+    case MockRequestKind::Save:
+        return "save";
+    case MockRequestKind::Compile:
+        return "compile";
+    case MockRequestKind::Execute:
+        return "execute";
+    case MockRequestKind::Heartbeat:
+        return "heartbeat";
+    default:
+        return "unknown";
+    }
+}
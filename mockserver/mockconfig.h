@@ -0,0 +1,73 @@
+#ifndef MOCKCONFIG_H
+#define MOCKCONFIG_H
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QRandomGenerator>
+#include <QString>
+#include <array>
+#include "randomdistribution.h"
+#include "protoc/data_proto.pb.h"
+
+// 模拟服务端按请求类型分别配置应答
+enum class MockRequestKind {
+    Login,
+    Save,
+    Compile,
+    Execute,
+    Heartbeat,
+    Count
+};
+
+// 应答延迟（毫秒，可带小数），写法见 RandomDistribution，
+// 例如 {"distribution": "exponential", "mean": 2}
+struct MockLatency
+{
+    RandomDistribution distribution;
+
+    bool parse(const QJsonValue &value, QString *error) { return distribution.parse(value, "延迟", error); }
+    qint64 sampleNs(QRandomGenerator &random) const { return qint64(distribution.sample(random) * 1e6); }
+};
+
+struct MockResponseProfile
+{
+    MockLatency latency;
+    // 以该概率返回 ErrorResponse 而不是正常应答
+    double errorRate = 0;
+    data::StatusCode errorStatus = data::INTERNAL_ERROR;
+    // >= 0 时在 ErrorResponse 里填 common_code / network_code（二者是 oneof，common_code 优先）
+    int commonCode = -1;
+    int networkCode = -1;
+    // 正常应答里主体文本的字节数：login 的 user_nickname、save/compile 的 message、execute 的 execution_result
+    int responseSize = 0;
+};
+
+// need_atomic 的 BatchRequest 怎么处理：按顺序串起来执行（Chain）、整体拒绝（Reject，
+// 对批次帧回 ERROR_RESPONSE）、忽略 need_atomic 各自执行（Ignore）。后两种用来验证客户端的串联回退
+enum class MockAtomicBatches {
+    Chain,
+    Reject,
+    Ignore
+};
+
+struct MockServerConfig
+{
+    quint16 port = 8888;
+    int threads = 4;
+    // 所有连接合计每秒推送的 Notification 数，0 表示不推送
+    double notificationsPerSec = 0;
+    int notificationSize = 64;
+    // 登录应答里 expire_time（秒级 Unix 时间）= 应答时间 + sessionTtlSec
+    qint64 sessionTtlSec = 3600;
+    MockAtomicBatches atomicBatches = MockAtomicBatches::Chain;
+    std::array<MockResponseProfile, int(MockRequestKind::Count)> profiles;
+
+    // {"port": 8888, "threads": 4, "notificationsPerSec": 100, "sessionTtlSec": 3600, "atomicBatches": "reject",
+    //  "responses": {"execute": {"latency": 2, "errorRate": 0.01, "commonCode": 3, "responseSize": 1024}}}
+    // responses 里还可以用 "default" 给所有类型设置相同的值，再由具体类型覆盖
+    bool applyJson(const QJsonObject &object, QString *error = nullptr);
+
+    static const char *kindName(MockRequestKind kind);
+};
+
+#endif // MOCKCONFIG_H
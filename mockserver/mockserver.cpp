@@ -0,0 +1,532 @@
+#include "mockserver.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QtEndian>
+#include <cmath>
+
+namespace {
+// 套接字写缓冲的高/低水位：客户端不读时暂停读取它的请求，回落后恢复
+constexpr qint64 kWriteHighWatermark = 8 * 1024 * 1024;
+constexpr qint64 kWriteLowWatermark = 1024 * 1024;
+constexpr qint64 kReadBufferSize = 1024 * 1024;
+constexpr qsizetype kOutboxReserve = 64 * 1024;
+// 通知推送的节拍
+constexpr int kNotificationTickMs = 10;
+// 定时器只有毫秒精度，提前这么多到期的应答也一并发出
+constexpr qint64 kDelaySlackNs = 500 * 1000;
+
+bool kindFor(data::MessageFrame::BodyCase body, MockRequestKind &kind) {
+    switch (body) {
+    case data::MessageFrame::kLoginRequest:
+        kind = MockRequestKind::Login;
+        return true;
+    case data::MessageFrame::kSaveSourceRequest:
+        kind = MockRequestKind::Save;
+        return true;
+    case data::MessageFrame::kCompileRequest:
+        kind = MockRequestKind::Compile;
+        return true;
+    case data::MessageFrame::kExecuteIrRequest:
+        kind = MockRequestKind::Execute;
+        return true;
+    case data::MessageFrame::kHeartbeat:
+        kind = MockRequestKind::Heartbeat;
+        return true;
+    default:
+        return false;
+    }
+}
+}
+
+MockWorker::MockWorker(const MockServerConfig &config, int threadCount, QObject *parent)
+    : QObject(parent)
+      , m_config(config)
+      , m_random(QRandomGenerator::securelySeeded())
+      , m_batchTimestamp(0)
+      , m_nextConnectionId(0)
+      , m_delayedSequence(0)
+      , m_delayedTimer(new QTimer(this))
+      , m_delayedArmedNs(0)
+      , m_notificationTimer(new QTimer(this))
+      , m_notificationsPerTick(config.notificationsPerSec / qMax(1, threadCount) * kNotificationTickMs / 1000.0)
+      , m_notificationCredit(0)
+      , m_notificationSequence(0)
+      , m_connectionCount(0)
+      , m_framesIn(0)
+      , m_framesOut(0)
+      , m_errors(0)
+      , m_notifications(0)
+      , m_bytesIn(0)
+      , m_bytesOut(0) {
+    m_clock.start();
+    for (int i = 0; i < int(MockRequestKind::Count); ++i) {
+        m_padding[i].assign(size_t(m_config.profiles[i].responseSize), 'x');
+    }
+    m_notificationText.assign(size_t(m_config.notificationSize), 'n');
+
+    m_delayedTimer->setSingleShot(true);
+    m_delayedTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_delayedTimer, &QTimer::timeout, this, &MockWorker::onDelayedTimeout);
+
+    m_notificationTimer->setTimerType(Qt::PreciseTimer);
+    m_notificationTimer->setInterval(kNotificationTickMs);
+    connect(m_notificationTimer, &QTimer::timeout, this, &MockWorker::onNotificationTick);
+    if (m_notificationsPerTick > 0) {
+        m_notificationTimer->start();
+    }
+}
+
+MockWorker::~MockWorker() {
+    m_connections.clear();
+}
+
+void MockWorker::addConnection(qintptr descriptor) {
+    auto *socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(descriptor)) {
+        qWarning() << "Failed to adopt socket descriptor:" << socket->errorString();
+        delete socket;
+        return;
+    }
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    // 只缓冲有限的入站数据，暂停读取时由 TCP 流控挡住客户端
+    socket->setReadBufferSize(kReadBufferSize);
+
+    auto connection = std::make_unique<Connection>();
+    connection->id = ++m_nextConnectionId;
+    connection->socket = socket;
+    connection->readPaused = false;
+    connection->outbox.reserve(kOutboxReserve);
+    Connection *raw = connection.get();
+    const quint64 id = connection->id;
+    m_connections.emplace(id, std::move(connection));
+    m_connectionCount.fetch_add(1, std::memory_order_relaxed);
+
+    connect(socket, &QTcpSocket::readyRead, this, [this, raw]() {
+        onReadyRead(raw);
+    });
+    connect(socket, &QTcpSocket::bytesWritten, this, [this, raw]() {
+        onBytesWritten(raw);
+    });
+    // 断开可能发生在写套接字的过程中，排队到下一轮事件循环再释放连接
+    connect(socket, &QTcpSocket::disconnected, this, [this, id]() {
+        removeConnection(id);
+    }, Qt::QueuedConnection);
+
+    // 描述符交过来之前可能已经有数据到达
+    if (socket->bytesAvailable() > 0) {
+        onReadyRead(raw);
+    }
+}
+
+MockStats MockWorker::stats() const {
+    MockStats stats;
+    stats.connections = m_connectionCount.load(std::memory_order_relaxed);
+    stats.framesIn = m_framesIn.load(std::memory_order_relaxed);
+    stats.framesOut = m_framesOut.load(std::memory_order_relaxed);
+    stats.errors = m_errors.load(std::memory_order_relaxed);
+    stats.notifications = m_notifications.load(std::memory_order_relaxed);
+    stats.bytesIn = m_bytesIn.load(std::memory_order_relaxed);
+    stats.bytesOut = m_bytesOut.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MockWorker::onReadyRead(Connection *connection) {
+    if (connection->readPaused) {
+        return;
+    }
+
+    const qint64 read = connection->decoder.readFrom(connection->socket);
+    if (read > 0) {
+        m_bytesIn.fetch_add(quint64(read), std::memory_order_relaxed);
+    }
+    if (connection->decoder.hasError()) {
+        qWarning() << "Invalid frame length from client, closing connection";
+        connection->socket->abort();
+        return;
+    }
+
+    // 同一批应答共用一个时间戳，省掉逐帧取时间
+    m_batchTimestamp = QDateTime::currentMSecsSinceEpoch();
+    const size_t delayedBefore = m_delayed.size();
+    quint64 frames = 0;
+    const char *data = nullptr;
+    quint32 size = 0;
+    while (connection->decoder.nextFrame(data, size)) {
+        handleFrame(connection, data, size);
+        ++frames;
+    }
+    m_batch.reset();
+    m_framesIn.fetch_add(frames, std::memory_order_relaxed);
+
+    flush(connection);
+    if (m_delayed.size() != delayedBefore) {
+        scheduleDelayed();
+    }
+    if (connection->socket->bytesToWrite() > kWriteHighWatermark) {
+        connection->readPaused = true;
+    }
+}
+
+void MockWorker::onBytesWritten(Connection *connection) {
+    if (connection->readPaused && connection->socket->bytesToWrite() <= kWriteLowWatermark) {
+        connection->readPaused = false;
+        onReadyRead(connection);
+    }
+}
+
+void MockWorker::removeConnection(quint64 id) {
+    auto it = m_connections.find(id);
+    if (it == m_connections.end()) {
+        return;
+    }
+    it->second->socket->disconnect(this);
+    it->second->socket->deleteLater();
+    m_connections.erase(it);
+    m_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MockWorker::handleFrame(Connection *connection, const char *data, quint32 size) {
+    data::MessageFrame *request = m_batch.createFrame();
+    if (!request->ParseFromArray(data, int(size))) {
+        // 连 request_id 都拿不到，没法回错误应答
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 批量请求没有汇总应答，每个子请求按自己的 request_id 单独应答，延迟也各自抽样
+    if (request->has_batch()) {
+        if (request->batch().need_atomic() && m_config.atomicBatches == MockAtomicBatches::Reject) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+            sendResponse(connection, *buildError(*request, data::BAD_REQUEST, "atomic batch not supported", -1, -1), 0);
+            return;
+        }
+        if (request->batch().need_atomic() && m_config.atomicBatches == MockAtomicBatches::Chain) {
+            handleAtomicBatch(connection, request->batch());
+            return;
+        }
+        for (const data::MessageFrame &subRequest : request->batch().sub_requests()) {
+            handleRequest(connection, subRequest);
+        }
+        return;
+    }
+    handleRequest(connection, *request);
+}
+
+void MockWorker::handleAtomicBatch(Connection *connection, const data::BatchRequest &batch) {
+    // 原子批次按顺序执行，应答也按顺序、每一步在前一步之后发出。
+    // 编译留空的 code_id 取前面保存得到的，执行留空的 ir_code_id 取前面编译得到的；
+    // 某一步失败后，剩下的步骤不再执行，以 INTERNAL_ERROR 应答
+    std::string codeId;
+    std::string irCodeId;
+    qint64 delayNs = 0;
+    bool failed = false;
+    for (const data::MessageFrame &subRequest : batch.sub_requests()) {
+        if (failed) {
+            m_errors.fetch_add(1, std::memory_order_relaxed);
+            sendResponse(connection, *buildError(subRequest, data::INTERNAL_ERROR,
+                                                 "atomic batch aborted", -1, -1), delayNs);
+            continue;
+        }
+
+        const data::MessageFrame *step = &subRequest;
+        if (subRequest.has_compile_request() && subRequest.compile_request().code_id().empty()) {
+            data::MessageFrame *filled = m_batch.createFrame();
+            filled->CopyFrom(subRequest);
+            filled->mutable_compile_request()->set_code_id(codeId);
+            step = filled;
+        } else if (subRequest.has_execute_ir_request() && subRequest.execute_ir_request().ir_code_id().empty()) {
+            data::MessageFrame *filled = m_batch.createFrame();
+            filled->CopyFrom(subRequest);
+            filled->mutable_execute_ir_request()->set_ir_code_id(irCodeId);
+            step = filled;
+        }
+
+        const data::MessageFrame *response = handleRequest(connection, *step, &delayNs);
+        if (response->has_save_source_response()) {
+            codeId = response->save_source_response().code_id();
+        } else if (response->has_compile_response()) {
+            irCodeId = response->compile_response().ir_code_id();
+        }
+        failed = response->has_error_response();
+    }
+}
+
+const data::MessageFrame *MockWorker::handleRequest(Connection *connection, const data::MessageFrame &request,
+                                                    qint64 *delayNs) {
+    MockRequestKind kind;
+    if (!kindFor(request.body_case(), kind)) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        const data::MessageFrame *error = buildError(request, data::BAD_REQUEST, "unsupported request", -1, -1);
+        sendResponse(connection, *error, delayNs ? *delayNs : 0);
+        return error;
+    }
+
+    const MockResponseProfile &profile = m_config.profiles[int(kind)];
+    data::MessageFrame *response = nullptr;
+    if (profile.errorRate > 0 && m_random.generateDouble() < profile.errorRate) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        response = buildError(request, profile.errorStatus, "mock error", profile.commonCode, profile.networkCode);
+    } else {
+        response = buildResponse(request, kind);
+    }
+
+    qint64 responseDelayNs = qMax<qint64>(0, profile.latency.sampleNs(m_random));
+    if (delayNs) {
+        responseDelayNs += *delayNs;
+        *delayNs = responseDelayNs;
+    }
+    sendResponse(connection, *response, responseDelayNs);
+    return response;
+}
+
+void MockWorker::sendResponse(Connection *connection, const data::MessageFrame &response, qint64 delayNs) {
+    if (delayNs <= 0) {
+        appendFrame(connection->outbox, response);
+        m_framesOut.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 延迟应答现在就编码，Arena 在本批结束时整体释放
+    DelayedFrame delayed{m_clock.nsecsElapsed() + delayNs, ++m_delayedSequence, connection->id, QByteArray()};
+    appendFrame(delayed.frame, response);
+    m_delayed.push(std::move(delayed));
+}
+
+data::MessageFrame *MockWorker::buildResponse(const data::MessageFrame &request, MockRequestKind kind) {
+    data::MessageFrame *response = m_batch.createFrame();
+    auto *header = response->mutable_header();
+    header->set_request_id(request.header().request_id());
+    header->set_client_id(request.header().client_id());
+    header->set_timestamp(m_batchTimestamp);
+
+    const std::string &padding = m_padding[int(kind)];
+    switch (kind) {
+    case MockRequestKind::Login: {
+        header->set_type(data::LOGIN_RESPONSE);
+        auto *login = response->mutable_login_response();
+        login->set_success(true);
+        login->set_session_id("mock-session-" + request.header().request_id());
+        login->set_expire_time(quint64(m_batchTimestamp / 1000 + m_config.sessionTtlSec));
+        login->set_user_nickname(padding);
+        break;
+    }
+    case MockRequestKind::Save: {
+        header->set_type(data::SAVE_SOURCE_CODE_RESPONSE);
+        const auto &save = request.save_source_request();
+        auto *saved = response->mutable_save_source_response();
+        saved->set_success(true);
+        saved->set_code_id(save.code_id().empty() ? "code-" + request.header().request_id() : save.code_id());
+        saved->set_message(padding);
+        break;
+    }
+    case MockRequestKind::Compile: {
+        header->set_type(data::COMPILE_SOURCE_RESPONSE);
+        auto *compiled = response->mutable_compile_response();
+        compiled->set_success(true);
+        compiled->set_ir_code_id("ir-" + request.compile_request().code_id());
+        compiled->set_message(padding);
+        break;
+    }
+    case MockRequestKind::Execute: {
+        header->set_type(data::EXECUTE_IR_RESPONSE);
+        auto *executed = response->mutable_execute_ir_response();
+        executed->set_success(true);
+        executed->set_execution_result(padding);
+        executed->set_execution_mode_used(
+            data::ExecuteIRCodeRequest::ExecutionMode_Name(request.execute_ir_request().mode()));
+        break;
+    }
+    case MockRequestKind::Heartbeat: {
+        header->set_type(data::HEARTBEAT);
+        auto *heartbeat = response->mutable_heartbeat();
+        heartbeat->set_connection_status("OK");
+        heartbeat->set_last_active_time(quint64(m_batchTimestamp));
+        break;
+    }
+    default:
+        break;
+    }
+    return response;
+}
+
+data::MessageFrame *MockWorker::buildError(const data::MessageFrame &request, data::StatusCode status,
+                                           const char *detail, int commonCode, int networkCode) {
+    data::MessageFrame *response = m_batch.createFrame();
+    auto *header = response->mutable_header();
+    header->set_request_id(request.header().request_id());
+    header->set_client_id(request.header().client_id());
+    header->set_timestamp(m_batchTimestamp);
+    header->set_type(data::ERROR_RESPONSE);
+
+    auto *error = response->mutable_error_response();
+    error->set_message(data::StatusCode_Name(status));
+    error->set_detail(detail);
+    error->set_request_type(data::RequestType_Name(request.header().type()));
+    // 错误码是 oneof，两个都配置时只填 common_code
+    if (commonCode >= 0) {
+        error->set_common_code(static_cast<common::ErrorCode>(commonCode));
+    } else if (networkCode >= 0) {
+        error->set_network_code(static_cast<network::ErrorCode>(networkCode));
+    }
+    return response;
+}
+
+void MockWorker::appendFrame(QByteArray &out, const data::MessageFrame &frame) {
+    const size_t size = frame.ByteSizeLong();
+    const qsizetype offset = out.size();
+    out.resize(offset + qsizetype(FrameDecoder::kHeaderSize + size));
+    uchar *target = reinterpret_cast<uchar *>(out.data()) + offset;
+    qToBigEndian<quint32>(quint32(size), target);
+    frame.SerializeWithCachedSizesToArray(target + FrameDecoder::kHeaderSize);
+}
+
+void MockWorker::flush(Connection *connection) {
+    if (connection->outbox.isEmpty()) {
+        return;
+    }
+    m_bytesOut.fetch_add(quint64(connection->outbox.size()), std::memory_order_relaxed);
+    connection->socket->write(connection->outbox);
+    // 保留容量给下一批
+    connection->outbox.resize(0);
+}
+
+void MockWorker::scheduleDelayed() {
+    if (m_delayed.empty()) {
+        m_delayedTimer->stop();
+        return;
+    }
+    const qint64 dueNs = m_delayed.top().dueNs;
+    if (m_delayedTimer->isActive() && m_delayedArmedNs <= dueNs) {
+        return;
+    }
+    const qint64 waitNs = qMax<qint64>(0, dueNs - m_clock.nsecsElapsed());
+    m_delayedArmedNs = dueNs;
+    m_delayedTimer->start(int((waitNs + 999999) / 1000000));
+}
+
+void MockWorker::onDelayedTimeout() {
+    const qint64 now = m_clock.nsecsElapsed();
+    std::vector<Connection *> touched;
+    while (!m_delayed.empty() && m_delayed.top().dueNs <= now + kDelaySlackNs) {
+        const DelayedFrame &delayed = m_delayed.top();
+        // 连接已经断开的应答直接丢弃
+        auto it = m_connections.find(delayed.connectionId);
+        if (it != m_connections.end()) {
+            Connection *connection = it->second.get();
+            if (connection->outbox.isEmpty()) {
+                touched.push_back(connection);
+            }
+            connection->outbox.append(delayed.frame);
+            m_framesOut.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_delayed.pop();
+    }
+    for (Connection *connection : touched) {
+        flush(connection);
+    }
+    scheduleDelayed();
+}
+
+void MockWorker::onNotificationTick() {
+    m_notificationCredit += m_notificationsPerTick;
+    const quint64 count = quint64(m_notificationCredit);
+    m_notificationCredit -= double(count);
+    if (count == 0 || m_connections.empty()) {
+        return;
+    }
+
+    // 本节拍的通知只编码一次，按连接平分，余数从轮转位置开始分
+    data::MessageFrame notification;
+    auto *header = notification.mutable_header();
+    header->set_request_id("notify-" + std::to_string(++m_notificationSequence));
+    header->set_timestamp(QDateTime::currentMSecsSinceEpoch());
+    header->set_type(data::NOTIFICATION);
+    auto *body = notification.mutable_notification();
+    body->set_type(data::Notification_NotifyType_SYSTEM_ANNOUNCEMENT);
+    body->set_content(m_notificationText);
+    body->set_create_time(quint64(header->timestamp()));
+    QByteArray encoded;
+    appendFrame(encoded, notification);
+
+    const quint64 connections = m_connections.size();
+    const quint64 share = count / connections;
+    const quint64 remainderStart = m_notificationSequence % connections;
+    const quint64 remainderEnd = remainderStart + count % connections;
+    quint64 index = 0;
+    for (auto &entry : m_connections) {
+        Connection *connection = entry.second.get();
+        quint64 copies = share;
+        if ((index >= remainderStart && index < remainderEnd) || index + connections < remainderEnd) {
+            ++copies;
+        }
+        ++index;
+        for (quint64 i = 0; i < copies; ++i) {
+            connection->outbox.append(encoded);
+        }
+        flush(connection);
+    }
+    m_notifications.fetch_add(count, std::memory_order_relaxed);
+    m_framesOut.fetch_add(count, std::memory_order_relaxed);
+}
+
+MockServer::MockServer(const MockServerConfig &config, QObject *parent)
+    : QTcpServer(parent)
+      , m_config(config)
+      , m_nextWorker(0) {
+}
+
+MockServer::~MockServer() {
+    close();
+    for (QThread *thread : std::as_const(m_threads)) {
+        thread->quit();
+    }
+    for (QThread *thread : std::as_const(m_threads)) {
+        thread->wait();
+    }
+}
+
+bool MockServer::start(QString *error) {
+    const int threads = qMax(1, m_config.threads);
+    for (int i = 0; i < threads; ++i) {
+        auto *thread = new QThread(this);
+        thread->setObjectName(QString("MockIO-%1").arg(i));
+        auto *worker = new MockWorker(m_config, threads);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+        thread->start();
+        m_threads.append(thread);
+        m_workers.append(worker);
+    }
+
+    if (!listen(QHostAddress::Any, m_config.port)) {
+        if (error) {
+            *error = QString("无法监听端口 %1: %2").arg(m_config.port).arg(errorString());
+        }
+        return false;
+    }
+    return true;
+}
+
+MockStats MockServer::stats() const {
+    MockStats total;
+    for (const MockWorker *worker : m_workers) {
+        const MockStats stats = worker->stats();
+        total.connections += stats.connections;
+        total.framesIn += stats.framesIn;
+        total.framesOut += stats.framesOut;
+        total.errors += stats.errors;
+        total.notifications += stats.notifications;
+        total.bytesIn += stats.bytesIn;
+        total.bytesOut += stats.bytesOut;
+    }
+    return total;
+}
+
+void MockServer::incomingConnection(qintptr descriptor) {
+    // 描述符交给工作线程创建套接字，accept 线程不碰任何读写
+    MockWorker *worker = m_workers[m_nextWorker];
+    m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+    QMetaObject::invokeMethod(worker, [worker, descriptor]() {
+        worker->addConnection(descriptor);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,148 @@
+#ifndef MOCKSERVER_H
+#define MOCKSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "framedecoder.h"
+#include "inboundbatch.h"
+#include "mockconfig.h"
+#include "protoc/data_proto.pb.h"
+
+struct MockStats
+{
+    quint64 connections = 0;
+    quint64 framesIn = 0;
+    quint64 framesOut = 0;
+    quint64 errors = 0;
+    quint64 notifications = 0;
+    quint64 bytesIn = 0;
+    quint64 bytesOut = 0;
+};
+
+// 一个 I/O 线程上的全部连接。每次 readyRead 把可读数据全部解析完，
+// 请求和应答都分配在本线程的 Arena 上，应答直接编码进连接的输出缓冲，整批只写一次套接字。
+// 配置了延迟的应答先编码好放进按到期时间排序的堆，由一个精确定时器统一发出。
+class MockWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MockWorker(const MockServerConfig &config, int threadCount, QObject *parent = nullptr);
+    ~MockWorker();
+
+    // 在工作线程中调用
+    void addConnection(qintptr descriptor);
+    // 线程安全
+    MockStats stats() const;
+
+private:
+    struct Connection
+    {
+        quint64 id;
+        QTcpSocket *socket;
+        FrameDecoder decoder;
+        QByteArray outbox;
+        bool readPaused;
+    };
+
+    struct DelayedFrame
+    {
+        qint64 dueNs;
+        quint64 sequence;
+        quint64 connectionId;
+        QByteArray frame;
+
+        // std::priority_queue 是大顶堆，反过来比较得到最早到期的在堆顶
+        bool operator<(const DelayedFrame &other) const {
+            return dueNs != other.dueNs ? dueNs > other.dueNs : sequence > other.sequence;
+        }
+    };
+
+    void onReadyRead(Connection *connection);
+    void onBytesWritten(Connection *connection);
+    void removeConnection(quint64 id);
+    void handleFrame(Connection *connection, const char *data, quint32 size);
+    void handleAtomicBatch(Connection *connection, const data::BatchRequest &batch);
+    // 生成应答并按抽样的延迟排期，应答不早于 *delayNs（为 nullptr 时不限），*delayNs 更新为本应答的延迟
+    const data::MessageFrame *handleRequest(Connection *connection, const data::MessageFrame &request,
+                                            qint64 *delayNs = nullptr);
+    void sendResponse(Connection *connection, const data::MessageFrame &response, qint64 delayNs);
+    data::MessageFrame *buildResponse(const data::MessageFrame &request, MockRequestKind kind);
+    data::MessageFrame *buildError(const data::MessageFrame &request, data::StatusCode status,
+                                   const char *detail, int commonCode, int networkCode);
+    void appendFrame(QByteArray &out, const data::MessageFrame &frame);
+    void flush(Connection *connection);
+
+    void scheduleDelayed();
+    void onDelayedTimeout();
+    void onNotificationTick();
+
+    MockServerConfig m_config;
+    QRandomGenerator m_random;
+    QElapsedTimer m_clock;
+    InboundBatch m_batch;
+    // 各类型应答的主体文本，按配置的大小预先生成
+    std::string m_padding[int(MockRequestKind::Count)];
+    std::string m_notificationText;
+    qint64 m_batchTimestamp;
+
+    std::unordered_map<quint64, std::unique_ptr<Connection>> m_connections;
+    quint64 m_nextConnectionId;
+
+    std::priority_queue<DelayedFrame> m_delayed;
+    quint64 m_delayedSequence;
+    QTimer *m_delayedTimer;
+    // 定时器当前对准的到期时间，新应答不比它早时不必重设定时器
+    qint64 m_delayedArmedNs;
+
+    QTimer *m_notificationTimer;
+    double m_notificationsPerTick;
+    double m_notificationCredit;
+    quint64 m_notificationSequence;
+
+    std::atomic<quint64> m_connectionCount;
+    std::atomic<quint64> m_framesIn;
+    std::atomic<quint64> m_framesOut;
+    std::atomic<quint64> m_errors;
+    std::atomic<quint64> m_notifications;
+    std::atomic<quint64> m_bytesIn;
+    std::atomic<quint64> m_bytesOut;
+};
+
+// 接受连接后按轮转把套接字描述符交给各 I/O 线程上的 MockWorker，自身只负责 accept
+class MockServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit MockServer(const MockServerConfig &config, QObject *parent = nullptr);
+    ~MockServer();
+
+    bool start(QString *error = nullptr);
+    // 各工作线程计数之和
+    MockStats stats() const;
+
+protected:
+    void incomingConnection(qintptr descriptor) override;
+
+private:
+    MockServerConfig m_config;
+    QVector<QThread *> m_threads;
+    QVector<MockWorker *> m_workers;
+    int m_nextWorker;
+};
+
+#endif // MOCKSERVER_H
@@ -0,0 +1,106 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// 有界多生产者单消费者无锁队列（每个槽位带序号的环形数组）。
+// tryPush() 可以在任意线程并发调用，生产者之间只竞争一次 CAS；tryPop() 只能由消费者线程调用。
+// 同一生产者先后推入的元素按顺序出队；某个生产者占住槽位但还没写完时，
+// 消费者在该槽位处返回 false，稍后再取。容量向上取整为 2 的幂，满/空时立即返回 false。
+template<typename T>
+class MpscQueue
+{
+public:
+    explicit MpscQueue(size_t capacity)
+        : m_capacity(roundUpToPowerOfTwo(capacity))
+        , m_mask(m_capacity - 1)
+        , m_cells(new Cell[m_capacity])
+    {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // 失败时 value 保持不变
+    bool tryPush(T &&value)
+    {
+        Cell *cell = nullptr;
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        Cell &cell = m_cells[head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        value = std::move(cell.value);
+        // 槽位留给下一圈的生产者
+        cell.sequence.store(head + m_capacity, std::memory_order_release);
+        m_head.store(head + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 近似值，仅用于统计和判断
+    size_t size() const
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    // 生产者竞争 m_tail，消费者独占 m_head，分开放在不同缓存行上避免伪共享
+    alignas(kCacheLine) std::atomic<size_t> m_tail{0};
+    alignas(kCacheLine) std::atomic<size_t> m_head{0};
+};
+
+#endif // MPSCQUEUE_H
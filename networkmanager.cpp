@@ -1,211 +1,407 @@
 #include "networkmanager.h"
+#include "connectionworker.h"
 #include <google/protobuf/util/json_util.h>
-#include <QThread>
 #include <QDebug>
-#include <QUuid>
+#include <QPromise>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+// 入站队列容量（批次数）和出站队列容量（帧数）
+constexpr size_t kInboundQueueCapacity = 256;
+constexpr size_t kOutboundQueueCapacity = 4096;
+// 请求截止时间的检查精度
+constexpr int kDeadlineTickMs = 10;
+
+// 本地发送失败时同步完成请求，这类结果不计入延迟统计
+thread_local bool t_completingLocally = false;
+}
 
 NetworkManager::NetworkManager(QObject *parent)
+    : NetworkManager(new QThread, true, parent) {
+}
+
+NetworkManager::NetworkManager(QThread *ioThread, QObject *parent)
+    : NetworkManager(ioThread, false, parent) {
+}
+
+NetworkManager::NetworkManager(QThread *ioThread, bool ownsThread, QObject *parent)
     : QObject(parent)
-      , m_socket(new QTcpSocket(this))
-      , m_heartbeatTimer(new QTimer(this))
-      , m_reconnectTimer(new QTimer(this))
-      , m_port(0)
-      , m_autoReconnect(false) {
-    connect(m_socket, &QTcpSocket::connected, this, &NetworkManager::onConnected);
-    connect(m_socket, &QTcpSocket::disconnected, this, &NetworkManager::onDisconnected);
-    connect(m_socket, &QTcpSocket::readyRead, this, &NetworkManager::onReadyRead);
-    connect(m_socket, &QTcpSocket::errorOccurred, this, &NetworkManager::onErrorOccurred);
-
-    m_heartbeatTimer->setInterval(30000);
-    connect(m_heartbeatTimer, &QTimer::timeout, this, &NetworkManager::onHeartbeatTimeout);
-
-    m_reconnectTimer->setSingleShot(true);
-    connect(m_reconnectTimer, &QTimer::timeout, this, [this]() {
-        qInfo() << "Attempting to reconnect to server...";
-        connectToServer(m_host.toString(), m_port);
-    });
+      , m_inbound(kInboundQueueCapacity)
+      , m_recycled(kInboundQueueCapacity)
+      , m_outbound(kOutboundQueueCapacity)
+      , m_ioThread(ioThread)
+      , m_ownsThread(ownsThread)
+      , m_worker(new ConnectionWorker(&m_inbound, &m_recycled, &m_outbound, &m_bufferPool, &m_latency))
+      , m_pending(kDeadlineTickMs)
+      , m_deadlineTimer(new QTimer(this)) {
+    m_clock.start();
+    // 所有请求共用一个定时器推进时间轮，没有截止时间时停止
+    m_deadlineTimer->setTimerType(Qt::PreciseTimer);
+    m_deadlineTimer->setInterval(kDeadlineTickMs);
+    connect(m_deadlineTimer, &QTimer::timeout, this, &NetworkManager::onDeadlineTick);
+
+    m_worker->moveToThread(m_ioThread);
+    if (m_ownsThread) {
+        m_ioThread->setParent(this);
+        m_ioThread->setObjectName("NetworkIO");
+        // 线程结束时在 I/O 线程内销毁连接对象（套接字通知器必须在所属线程释放）
+        connect(m_ioThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    }
+
+    connect(m_worker, &ConnectionWorker::connected, this, &NetworkManager::connected);
+    connect(m_worker, &ConnectionWorker::disconnected, this, &NetworkManager::onDisconnected);
+    connect(m_worker, &ConnectionWorker::connectionError, this, &NetworkManager::connectionError);
+    connect(m_worker, &ConnectionWorker::heartbeatReceived, this, &NetworkManager::heartbeatReceived);
+    connect(m_worker, &ConnectionWorker::framesAvailable, this, &NetworkManager::onFramesAvailable);
+    connect(m_worker, &ConnectionWorker::backpressureChanged, this, &NetworkManager::backpressureChanged);
+
+    if (m_ownsThread) {
+        m_ioThread->start();
+    }
 }
 
 NetworkManager::~NetworkManager() {
-    disconnectFromServer();
+    if (m_ownsThread) {
+        m_ioThread->quit();
+        m_ioThread->wait();
+    } else if (m_ioThread->isRunning()) {
+        // 共用的线程还在运行，在线程内同步销毁连接对象，其他连接不受影响
+        ConnectionWorker *worker = m_worker;
+        QMetaObject::invokeMethod(worker, [worker]() {
+            delete worker;
+        }, Qt::BlockingQueuedConnection);
+    } else {
+        delete m_worker;
+    }
+
+    InboundBatch *batch = nullptr;
+    while (m_inbound.tryPop(batch)) {
+        delete batch;
+    }
+    while (m_recycled.tryPop(batch)) {
+        delete batch;
+    }
 }
 
 bool NetworkManager::connectToServer(const QString &host, quint16 port) {
-    m_host = QHostAddress(host);
-    m_port = port;
+    QFuture<bool> future = connectToServerAsync(host, port);
+    future.waitForFinished();
+    return future.resultCount() > 0 && future.result();
+}
 
-    m_socket->connectToHost(host, port);
-    return m_socket->waitForConnected(5000);
+QFuture<bool> NetworkManager::connectToServerAsync(const QString &host, quint16 port) {
+    // promise 随回调一起交给 I/O 线程；连接对象先被销毁时 promise 未完成即析构，future 变为已取消
+    auto promise = std::make_shared<QPromise<bool>>();
+    promise->start();
+    QFuture<bool> future = promise->future();
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, host, port, promise]() {
+        worker->beginConnect(host, port, [promise](bool connected) {
+            promise->addResult(connected);
+            promise->finish();
+        });
+    }, Qt::QueuedConnection);
+    return future;
 }
 
 void NetworkManager::disconnectFromServer() {
-    stopHeartbeatTimer();
-    m_socket->disconnectFromHost();
-    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
-        m_socket->waitForDisconnected(1000);
-    }
+    QMetaObject::invokeMethod(m_worker, &ConnectionWorker::disconnectFromServer,
+                              Qt::BlockingQueuedConnection);
 }
 
 bool NetworkManager::isConnected() const {
-    return m_socket->state() == QAbstractSocket::ConnectedState;
+    return m_worker->isConnected();
 }
 
-bool NetworkManager::sendMessage(const data::MessageFrame &message) {
+NetworkManager::SendStatus NetworkManager::sendMessage(const data::MessageFrame &message) {
     if (!isConnected()) {
         qWarning() << "Not connected to server";
-        return false;
+        return SendStatus::NotConnected;
     }
 
-    QByteArray data;
-    quint32 size = message.ByteSizeLong();
-    // 修复：将主机字节序转换为网络字节序（大端序）
-    quint32 networkSize = qToBigEndian(size);
-    data.append(reinterpret_cast<const char *>(&networkSize), sizeof(networkSize));
-
-    std::string serialized;
-    if (!message.SerializeToString(&serialized)) {
+    // 在调用方线程完成序列化，I/O 线程只负责写出
+    QByteArray frame;
+    if (!encodeFrame(message, m_bufferPool, frame)) {
         qWarning() << "Failed to serialize message";
-        return false;
+        m_bufferPool.release(std::move(frame));
+        return SendStatus::EncodeFailed;
     }
+    return enqueueFrame(std::move(frame));
+}
 
-    data.append(serialized.c_str(), serialized.size());
-
-    qint64 bytesWritten = m_socket->write(data);
-    if (bytesWritten == -1) {
-        qWarning() << "Failed to write data to socket:" << m_socket->errorString();
-        return false;
+NetworkManager::SendStatus NetworkManager::enqueueFrame(QByteArray &&frame) {
+    if (!m_outbound.tryPush(std::move(frame))) {
+        m_bufferPool.release(std::move(frame));
+        return SendStatus::Backpressure;
     }
 
-    return m_socket->waitForBytesWritten(5000);
+    m_worker->scheduleFlush();
+    return SendStatus::Queued;
 }
 
-data::MessageFrame NetworkManager::sendRequest(const data::MessageFrame &request, int timeout) {
-    QMutexLocker locker(&m_mutex);
-
-    if (!sendMessage(request)) {
-        data::MessageFrame errorResponse;
-        auto *header = errorResponse.mutable_header();
-        header->set_request_id(request.header().request_id());
-        header->set_timestamp(QDateTime::currentSecsSinceEpoch());
-        header->set_type(data::ERROR_RESPONSE);
+QFuture<data::MessageFrame> NetworkManager::registerRequest(const std::string &requestId, data::RequestType type,
+                                                            ResponseCallback callback, qint64 deadline) {
+    // 延迟按单调时钟从登记到完成计算（包括超时和断线），不依赖 header 中的墙上时间
+    const qint64 sentNs = m_clock.nsecsElapsed();
+    // request_id 重复时在 add 内同步完成，和其他本地失败一样不计入延迟统计
+    const bool completingLocally = t_completingLocally;
+    t_completingLocally = true;
+    QFuture<data::MessageFrame> future = m_pending.add(requestId, deadline,
+        [this, sentNs, type, callback = std::move(callback)](const data::MessageFrame &response) {
+            if (!t_completingLocally) {
+                m_latency.record(type, m_clock.nsecsElapsed() - sentNs);
+            }
+            if (!callback) {
+                return;
+            }
+            if (QThread::currentThread() != thread()) {
+                // 发送失败和 request_id 重复在调用方线程同步完成，回调仍转到所属线程执行
+                QMetaObject::invokeMethod(this, [callback, response]() {
+                    callback(response);
+                }, Qt::QueuedConnection);
+                return;
+            }
+            callback(response);
+        },
+        [](const std::string &duplicateId) {
+            return makeErrorResponse(duplicateId, data::BAD_REQUEST, "request_id 与在途请求重复");
+        });
+    t_completingLocally = completingLocally;
+    return future;
+}
 
-        return errorResponse;
+void NetworkManager::failRequest(const std::string &requestId, SendStatus status) {
+    QString detail;
+    switch (status) {
+    case SendStatus::NotConnected:
+        detail = "未连接到服务器";
+        break;
+    case SendStatus::Backpressure:
+        detail = "发送队列已满";
+        break;
+    default:
+        detail = "请求编码失败";
+        break;
     }
+    t_completingLocally = true;
+    m_pending.complete(makeErrorResponse(requestId, data::SERVICE_UNAVAILABLE, detail));
+    t_completingLocally = false;
+}
 
-    QString requestId = QString::fromStdString(request.header().request_id());
-
-    if (!m_responseCondition.wait(&m_mutex, timeout)) {
-        qWarning() << "Request timeout for request ID:" << requestId;
-        data::MessageFrame timeoutResponse;
-        auto *header = timeoutResponse.mutable_header();
-        header->set_request_id(request.header().request_id());
-        header->set_timestamp(QDateTime::currentSecsSinceEpoch());
-        header->set_type(data::ERROR_RESPONSE);
+template<typename Send>
+QFuture<data::MessageFrame> NetworkManager::trackRequest(const std::string &requestId, data::RequestType type,
+                                                         ResponseCallback callback, int timeoutMs, Send &&send) {
+    // 先登记再发送，避免响应比登记先到
+    const qint64 deadline = timeoutMs > 0 ? m_clock.elapsed() + timeoutMs : 0;
+    QFuture<data::MessageFrame> future = registerRequest(requestId, type, std::move(callback), deadline);
+    if (future.isFinished()) {
+        // request_id 与在途请求重复，已以 ERROR_RESPONSE 完成，不再发送
+        return future;
+    }
 
-        return timeoutResponse;
+    const SendStatus status = send();
+    if (status != SendStatus::Queued) {
+        failRequest(requestId, status);
+    } else if (deadline > 0) {
+        startDeadlineTimer();
     }
 
-    return m_pendingResponses.value(requestId);
+    return future;
 }
 
-void NetworkManager::setAutoReconnect(bool enable, int interval) {
-    m_autoReconnect = enable;
-    if (enable) {
-        m_reconnectTimer->setInterval(interval);
-    } else {
-        m_reconnectTimer->stop();
-    }
+QFuture<data::MessageFrame> NetworkManager::sendRequest(const data::MessageFrame &request,
+                                                        ResponseCallback callback, int timeoutMs) {
+    return trackRequest(request.header().request_id(), request.header().type(), std::move(callback), timeoutMs,
+                        [this, &request]() {
+        return sendMessage(request);
+    });
 }
 
-void NetworkManager::onConnected() {
-    qInfo() << "Connected to server";
-    startHeartbeatTimer();
-    emit connected();
+QFuture<data::MessageFrame> NetworkManager::sendPreparedRequest(const PreparedRequest &request,
+                                                                const std::string &requestId,
+                                                                const std::string &authToken,
+                                                                ResponseCallback callback) {
+    return trackRequest(requestId, request.type(), std::move(callback), request.timeoutMs(),
+                        [this, &request, &requestId, &authToken]() {
+        if (!isConnected()) {
+            return SendStatus::NotConnected;
+        }
+        QByteArray frame = m_bufferPool.acquire(request.frameSize(qsizetype(requestId.size()),
+                                                                  qsizetype(authToken.size())));
+        request.writeFrame(frame.data(), requestId, QDateTime::currentMSecsSinceEpoch(), authToken);
+        return enqueueFrame(std::move(frame));
+    });
 }
 
-void NetworkManager::onDisconnected() {
-    qInfo() << "Disconnected from server";
-    stopHeartbeatTimer();
-    emit disconnected();
+QVector<QFuture<data::MessageFrame>> NetworkManager::sendBatchRequest(const data::MessageFrame &batch,
+                                                                      QVector<BatchEntry> entries) {
+    const auto &subRequests = batch.batch().sub_requests();
+    QVector<QFuture<data::MessageFrame>> futures;
+    if (subRequests.empty()) {
+        return futures;
+    }
 
-    if (m_autoReconnect) {
-        m_reconnectTimer->start();
+    // 批次帧自己的 request_id 也登记，不设截止时间：服务端整体拒绝批次时用它回 ERROR_RESPONSE，
+    // 这个错误转给每个还没完成的子请求。子请求全部有了结果后撤下这条登记
+    const std::string batchId = batch.header().request_id();
+    auto subIds = std::make_shared<std::vector<std::string>>();
+    subIds->reserve(size_t(subRequests.size()));
+    for (const data::MessageFrame &request : subRequests) {
+        subIds->push_back(request.header().request_id());
     }
+    registerRequest(batchId, data::BATCH_REQUEST, [this, subIds](const data::MessageFrame &response) {
+        if (response.header().type() != data::ERROR_RESPONSE) {
+            return;
+        }
+        data::MessageFrame error = response;
+        error.mutable_error_response()->set_request_type(data::RequestType_Name(data::BATCH_REQUEST));
+        for (const std::string &requestId : *subIds) {
+            error.mutable_header()->set_request_id(requestId);
+            m_pending.complete(error);
+        }
+    }, 0);
+
+    auto remaining = std::make_shared<std::atomic<int>>(subRequests.size());
+    const qint64 now = m_clock.elapsed();
+    bool hasDeadline = false;
+    futures.reserve(subRequests.size());
+    for (int i = 0; i < subRequests.size(); ++i) {
+        BatchEntry entry = i < entries.size() ? std::move(entries[i]) : BatchEntry();
+        const qint64 deadline = entry.timeoutMs > 0 ? now + entry.timeoutMs : 0;
+        hasDeadline = hasDeadline || deadline > 0;
+        const data::RequestHeader &header = subRequests.Get(i).header();
+        futures.append(registerRequest(header.request_id(), header.type(),
+            [this, remaining, batchId, callback = std::move(entry.callback)](const data::MessageFrame &response) {
+                if (callback) {
+                    callback(response);
+                }
+                if (remaining->fetch_sub(1) == 1) {
+                    releaseBatch(batchId);
+                }
+            }, deadline));
+    }
+
+    const SendStatus status = sendMessage(batch);
+    if (status != SendStatus::Queued) {
+        for (const data::MessageFrame &request : subRequests) {
+            failRequest(request.header().request_id(), status);
+        }
+    } else if (hasDeadline) {
+        startDeadlineTimer();
+    }
+
+    return futures;
 }
 
-void NetworkManager::onReadyRead() {
-    QByteArray data = m_socket->readAll();
-    static QByteArray buffer;
-    buffer.append(data);
-    qInfo() << "buffer.size():" << buffer.size();
-    while (buffer.size() >= 4) {
-        quint32 frameSize;
-        memcpy(&frameSize, buffer.constData(), sizeof(frameSize));
+void NetworkManager::releaseBatch(const std::string &batchId) {
+    data::MessageFrame done;
+    done.mutable_header()->set_request_id(batchId);
+    done.mutable_header()->set_type(data::BATCH_REQUEST);
+    const bool completingLocally = t_completingLocally;
+    t_completingLocally = true;
+    m_pending.complete(done);
+    t_completingLocally = completingLocally;
+}
 
-        // 修复：添加网络字节序到主机字节序的转换
-        // frameSize = ntohl(frameSize);
-        // 或使用 Qt 跨平台函数
-        frameSize = qFromBigEndian<quint32>(frameSize);
+int NetworkManager::pendingCount() const {
+    return static_cast<int>(m_pending.size());
+}
 
-        if (buffer.size() < 4 + frameSize) {
-            return;
-        }
-        qInfo() << "buffer:" << buffer;
-        QByteArray messageData = buffer.mid(4, frameSize);
-        buffer.remove(0, 4 + frameSize);
-        data::MessageFrame message;
-        if (message.ParseFromArray(messageData.constData(), messageData.size())) {
-            // 添加成功解析消息的控制台提示
-            qInfo() << "Successfully parsed message, type:" << static_cast<int>(message.header().type());
-
-            QString requestId = QString::fromStdString(message.header().request_id());
-
-            QMutexLocker locker(&m_mutex);
-            if (m_pendingResponses.contains(requestId)) {
-                m_pendingResponses[requestId] = message;
-                m_responseCondition.wakeAll();
-            } else {
-                emit messageReceived(message);
-            }
+LatencyRecorder::Snapshot NetworkManager::latencySnapshot() const {
+    return m_latency.snapshot();
+}
 
-            if (message.header().type() == data::HEARTBEAT) {
-                emit heartbeatReceived();
-            }
-        } else {
-            qWarning() << "Failed to parse message";
-        }
+const LatencyRecorder &NetworkManager::latencyRecorder() const {
+    return m_latency;
+}
+
+WriteStats NetworkManager::writeStats() const {
+    return m_worker->writeStats();
+}
+
+void NetworkManager::startDeadlineTimer() {
+    // 定时器只能在所属线程启动，其他线程发起的请求转交过去
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, &NetworkManager::startDeadlineTimer, Qt::QueuedConnection);
+        return;
+    }
+    if (!m_deadlineTimer->isActive() && m_pending.hasDeadlines()) {
+        m_deadlineTimer->start();
     }
 }
 
-void NetworkManager::onErrorOccurred(QAbstractSocket::SocketError error) {
-    qWarning() << "Socket error:" << m_socket->errorString();
-    emit connectionError(m_socket->errorString());
+data::MessageFrame NetworkManager::makeErrorResponse(const std::string &requestId, data::StatusCode status,
+                                                     const QString &detail) {
+    data::MessageFrame errorResponse;
+    auto *header = errorResponse.mutable_header();
+    header->set_request_id(requestId);
+    header->set_timestamp(QDateTime::currentMSecsSinceEpoch());
+    header->set_type(data::ERROR_RESPONSE);
+
+    auto *error = errorResponse.mutable_error_response();
+    error->set_message(data::StatusCode_Name(status));
+    error->set_detail(detail.toStdString());
+    return errorResponse;
 }
 
-void NetworkManager::onHeartbeatTimeout() {
-    sendHeartbeat();
+void NetworkManager::setAutoReconnect(bool enable, int interval) {
+    QMetaObject::invokeMethod(m_worker, [this, enable, interval]() {
+        m_worker->setAutoReconnect(enable, interval);
+    }, Qt::QueuedConnection);
 }
 
-void NetworkManager::sendHeartbeat() {
-    data::MessageFrame message;
-    auto *header = message.mutable_header();
-    header->set_request_id(QUuid::createUuid().toString().toStdString());
-    header->set_timestamp(QDateTime::currentMSecsSinceEpoch()); // 改为毫秒
-    header->set_type(data::HEARTBEAT);
+void NetworkManager::startCapture(std::shared_ptr<TrafficCapture> capture, quint16 stream) {
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker, capture = std::move(capture), stream]() {
+        worker->setCapture(capture, stream);
+    }, Qt::QueuedConnection);
+}
+
+void NetworkManager::stopCapture() {
+    QMetaObject::invokeMethod(m_worker, [worker = m_worker]() {
+        worker->setCapture(nullptr, 0);
+    }, Qt::BlockingQueuedConnection);
+}
+
+void NetworkManager::onFramesAvailable() {
+    m_worker->beginConsume();
+
+    // 帧以引用方式分发，不再拷贝；整批分发完后重置 Arena 并把批次还给 I/O 线程
+    InboundBatch *batch = nullptr;
+    while (m_inbound.tryPop(batch)) {
+        for (const data::MessageFrame *message : batch->frames()) {
+            dispatchMessage(*message);
+        }
+        batch->reset();
+        if (!m_recycled.tryPush(std::move(batch))) {
+            delete batch;
+        }
+    }
 
-    data::Heartbeat heartbeat;
-    heartbeat.set_last_active_time(QDateTime::currentMSecsSinceEpoch()); // 改为毫秒
-    message.mutable_heartbeat()->CopyFrom(heartbeat);
+    m_worker->endConsume();
+}
 
-    sendMessage(message);
+void NetworkManager::onDisconnected() {
+    // 连接断开后不会再有响应，立即让所有在途请求失败
+    m_pending.completeAll([](const std::string &requestId) {
+        return makeErrorResponse(requestId, data::SERVICE_UNAVAILABLE, "连接已断开");
+    });
+    m_deadlineTimer->stop();
+    emit disconnected();
 }
 
-void NetworkManager::startHeartbeatTimer() {
-    m_heartbeatTimer->start();
-    // 立即发送第一个心跳
-    QTimer::singleShot(0, this, &NetworkManager::sendHeartbeat);
+void NetworkManager::onDeadlineTick() {
+    m_pending.expire(m_clock.elapsed(), [](const std::string &requestId) {
+        return makeErrorResponse(requestId, data::TIMEOUT, "请求在截止时间前未收到响应");
+    });
+
+    if (!m_pending.hasDeadlines()) {
+        m_deadlineTimer->stop();
+    }
 }
 
-void NetworkManager::stopHeartbeatTimer() {
-    m_heartbeatTimer->stop();
+void NetworkManager::dispatchMessage(const data::MessageFrame &message) {
+    if (!m_pending.complete(message)) {
+        emit messageReceived(message);
+    }
 }
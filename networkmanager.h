@@ -2,62 +2,148 @@
 #define NETWORKMANAGER_H
 
 #include <QObject>
-#include <QTcpSocket>
+#include <QThread>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QDateTime>
-#include <QHostAddress>
 #include <QByteArray>
-#include <QMutex>
-#include <QWaitCondition>
+#include <QFuture>
+#include <QVector>
+#include <functional>
+#include "bufferpool.h"
+#include "connectionworker.h"
+#include "inboundbatch.h"
+#include "latencyrecorder.h"
+#include "mpscqueue.h"
+#include "pendingrequesttable.h"
+#include "preparedrequest.h"
+#include "spscqueue.h"
 #include "protoc/data_proto.pb.h"
 
+// 连接的前端对象，属于调用方线程。套接字读写、解析和心跳都在 I/O 线程中完成，
+// I/O 线程可以自己独占，也可以由调用方提供、与其他连接共用（见 ConnectionPool）。
+// 入站帧经有界 SPSC 队列交给所属线程；出站是 MPSC 队列，任意线程都可以并发发送。
 class NetworkManager : public QObject
 {
     Q_OBJECT
 
 public:
     explicit NetworkManager(QObject *parent = nullptr);
+    // 连接对象运行在 ioThread 上；线程由调用方启动，并且要比 NetworkManager 活得更久
+    explicit NetworkManager(QThread *ioThread, QObject *parent = nullptr);
     ~NetworkManager();
 
+    // 阻塞到连接建立、失败或超时，但不占用 I/O 线程
     bool connectToServer(const QString &host, quint16 port);
+    // 线程安全，不阻塞；连上时 future 结果为 true
+    QFuture<bool> connectToServerAsync(const QString &host, quint16 port);
     void disconnectFromServer();
     bool isConnected() const;
 
-    bool sendMessage(const data::MessageFrame &message);
-    data::MessageFrame sendRequest(const data::MessageFrame &request, int timeout = 5000);
+    using ResponseCallback = PendingRequestTable::Callback;
+
+    enum class SendStatus {
+        Queued,          // 已编码并放入出站队列
+        NotConnected,
+        Backpressure,    // 出站队列已满：套接字写不过来，稍后重试或降低发送速率
+        EncodeFailed
+    };
+
+    // 线程安全，可在任意线程并发调用；同一线程发出的帧按调用顺序写出。
+    // 帧在调用线程直接编码进池化缓冲区后入队，不等待数据写出，也从不阻塞：写不过来时返回 Backpressure
+    SendStatus sendMessage(const data::MessageFrame &message);
+    // 按 request_id 关联响应：返回的 future 和 callback 在响应到达时完成，
+    // 本地发送失败、request_id 与在途请求重复、连接断开或超过 timeoutMs 时以合成的 ERROR_RESPONSE 完成
+    // （timeoutMs <= 0 不设截止时间；重复的请求不会发出）。
+    // 线程安全；回调总在 NetworkManager 所属线程执行：在其他线程同步失败时 future 立即完成，回调排队执行。
+    QFuture<data::MessageFrame> sendRequest(const data::MessageFrame &request,
+                                            ResponseCallback callback = {},
+                                            int timeoutMs = kDefaultRequestTimeoutMs);
+    // 同 sendRequest，但帧由预编码模板生成：拷贝模板并写入 requestId、当前时间和 authToken，不再序列化。
+    // 截止时间取模板的 timeoutMs()
+    QFuture<data::MessageFrame> sendPreparedRequest(const PreparedRequest &request, const std::string &requestId,
+                                                    const std::string &authToken, ResponseCallback callback = {});
+
+    // BatchRequest 里一个子请求的回调和截止时间
+    struct BatchEntry
+    {
+        ResponseCallback callback;
+        int timeoutMs = kDefaultRequestTimeoutMs;
+    };
+
+    // 整个 BatchRequest 作为一帧发出，各子请求按自己的 request_id 登记，响应逐个到达、逐个完成；
+    // entries[i] 对应 sub_requests(i)，返回的 future 也一一对应。
+    // 服务端用批次帧的 request_id 回 ERROR_RESPONSE（整体拒绝）时，还没完成的子请求都以这个错误完成，
+    // 请求头里的 request_id 换成各自的，request_type 统一写成 "BATCH_REQUEST"，其余不变，
+    // 子请求据此区分批次被整体拒绝和自己执行失败。
+    // 发送失败时每个子请求都以合成的 ERROR_RESPONSE 完成。线程安全
+    QVector<QFuture<data::MessageFrame>> sendBatchRequest(const data::MessageFrame &batch,
+                                                          QVector<BatchEntry> entries);
+    int pendingCount() const;
+    // 按请求类型的延迟直方图（各记录线程合并后的结果）；心跳记录的是往返时间
+    LatencyRecorder::Snapshot latencySnapshot() const;
+    const LatencyRecorder &latencyRecorder() const;
+    // 出站写入计数：frames / writes 即平均每次套接字写入合并的帧数
+    WriteStats writeStats() const;
+
+    // 协议里的 ErrorResponse 没有 StatusCode 字段，状态名写在 message 中，说明写在 detail 中
+    static data::MessageFrame makeErrorResponse(const std::string &requestId, data::StatusCode status,
+                                                const QString &detail);
+
+    static constexpr int kDefaultRequestTimeoutMs = 30000;
 
     void setAutoReconnect(bool enable, int interval = 5000);
 
+    // 把本连接收发的每一帧（带单调时间戳和方向）追加到 capture；多个连接可以共用一个文件，用 stream 区分
+    void startCapture(std::shared_ptr<TrafficCapture> capture, quint16 stream = 0);
+    // 返回时本连接缓冲的记录已提交给 capture
+    void stopCapture();
+
 signals:
     void connected();
     void disconnected();
     void connectionError(const QString &error);
+    // message 分配在入站批次的 Arena 上，只在信号处理期间有效，需要保留时请拷贝
     void messageReceived(const data::MessageFrame &message);
     void heartbeatReceived();
+    // 套接字写缓冲超过高水位时 active = true，回落到低水位后 active = false
+    void backpressureChanged(bool active);
 
 private slots:
-    void onConnected();
+    void onFramesAvailable();
     void onDisconnected();
-    void onReadyRead();
-    void onErrorOccurred(QAbstractSocket::SocketError error);
-    void onHeartbeatTimeout();
-    // void onReconnectTimeout();
+    void onDeadlineTick();
 
 private:
-    bool readMessage(QByteArray &data);
-    void sendHeartbeat();
-    void startHeartbeatTimer();
-    void stopHeartbeatTimer();
-
-    QTcpSocket *m_socket;
-    QTimer *m_heartbeatTimer;
-    QTimer *m_reconnectTimer;
-    QHostAddress m_host;
-    quint16 m_port;
-    bool m_autoReconnect;
-    QMutex m_mutex;
-    QWaitCondition m_responseCondition;
-    QMap<QString, data::MessageFrame> m_pendingResponses;
+    NetworkManager(QThread *ioThread, bool ownsThread, QObject *parent);
+
+    // 登记请求后调用 send 发出；发送失败时以合成的 ERROR_RESPONSE 立即完成
+    template<typename Send>
+    QFuture<data::MessageFrame> trackRequest(const std::string &requestId, data::RequestType type,
+                                             ResponseCallback callback, int timeoutMs, Send &&send);
+    // 登记一个在途请求；deadline 是 m_clock 上的毫秒数，0 表示不设截止时间
+    QFuture<data::MessageFrame> registerRequest(const std::string &requestId, data::RequestType type,
+                                                ResponseCallback callback, qint64 deadline);
+    // 已登记的请求没能发出：以合成的 ERROR_RESPONSE 立即完成，不计入延迟统计
+    void failRequest(const std::string &requestId, SendStatus status);
+    // 批次的子请求都已完成：撤下批次帧自己的登记，不计入延迟统计
+    void releaseBatch(const std::string &batchId);
+    // 已编码好的帧放入出站队列
+    SendStatus enqueueFrame(QByteArray &&frame);
+    void startDeadlineTimer();
+    void dispatchMessage(const data::MessageFrame &message);
+
+    SpscQueue<InboundBatch *> m_inbound;
+    SpscQueue<InboundBatch *> m_recycled;
+    MpscQueue<QByteArray> m_outbound;
+    BufferPool m_bufferPool;
+    LatencyRecorder m_latency;
+    QThread *m_ioThread;
+    bool m_ownsThread;
+    ConnectionWorker *m_worker;
+    PendingRequestTable m_pending;
+    QElapsedTimer m_clock;
+    QTimer *m_deadlineTimer;
 };
 
 #endif // NETWORKMANAGER_H
@@ -0,0 +1,251 @@
+#include "pendingrequesttable.h"
+#include "requestidgenerator.h"
+#include <QDebug>
+
+namespace {
+// Fibonacci 哈希：计数器连续递增的 ID 也能均匀散开
+constexpr quint64 kHashMultiplier = 0x9e3779b97f4a7c15ull;
+constexpr size_t kMinSlots = 16;
+
+size_t slotsFor(size_t expectedRequests) {
+    size_t slots = kMinSlots;
+    while (slots < expectedRequests * 2) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+int shiftFor(size_t slots) {
+    int bits = 0;
+    while ((size_t(1) << bits) < slots) {
+        ++bits;
+    }
+    return 64 - bits;
+}
+}
+
+PendingRequestTable::PendingRequestTable(qint64 tickMs, size_t expectedRequests)
+    : m_slots(slotsFor(expectedRequests))
+      , m_shift(shiftFor(m_slots.size()))
+      , m_slotCount(0)
+      , m_size(0)
+      , m_wheel(tickMs) {
+    m_freeEntries.reserve(expectedRequests);
+}
+
+QFuture<data::MessageFrame> PendingRequestTable::add(const std::string &requestId, qint64 deadlineMs,
+                                                     Callback callback, const ResponseFactory &onDuplicate) {
+    QMutexLocker locker(&m_mutex);
+
+    quint64 key = 0;
+    if (find(requestId, &key)) {
+        locker.unlock();
+        qWarning() << "Duplicate request ID:" << QString::fromStdString(requestId);
+        Waiter waiter;
+        waiter.callback = std::move(callback);
+        QFuture<data::MessageFrame> future = waiter.promise.future();
+        waiter.promise.start();
+        if (onDuplicate) {
+            finish(waiter, onDuplicate(requestId));
+        } else {
+            future.cancel();
+            waiter.promise.finish();
+        }
+        return future;
+    }
+
+    Entry *entry = allocate();
+    entry->key = key;
+    if (key != 0) {
+        if ((m_slotCount + 1) * 2 > m_slots.size()) {
+            grow();
+        }
+        insertSlot(key, entry->index);
+        ++m_slotCount;
+    } else {
+        entry->textId = requestId;
+        m_textEntries.emplace(requestId, entry->index);
+    }
+    ++m_size;
+
+    entry->waiter.callback = std::move(callback);
+    if (deadlineMs > 0) {
+        m_wheel.schedule(entry, deadlineMs);
+    }
+    entry->waiter.promise.start();
+    return entry->waiter.promise.future();
+}
+
+bool PendingRequestTable::complete(const data::MessageFrame &response) {
+    QMutexLocker locker(&m_mutex);
+
+    quint64 key = 0;
+    Entry *entry = find(response.header().request_id(), &key);
+    if (!entry) {
+        return false;
+    }
+    m_wheel.cancel(entry);
+    Waiter waiter = release(entry, nullptr);
+    locker.unlock();
+
+    finish(waiter, response);
+    return true;
+}
+
+void PendingRequestTable::expire(qint64 nowMs, const ResponseFactory &makeResponse) {
+    std::vector<std::pair<std::string, Waiter>> expired;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_wheel.advance(nowMs, [this, &expired](TimingWheel::Node *node) {
+            std::string requestId;
+            Waiter waiter = release(static_cast<Entry *>(node), &requestId);
+            expired.emplace_back(std::move(requestId), std::move(waiter));
+        });
+    }
+
+    for (auto &item : expired) {
+        finish(item.second, makeResponse(item.first));
+    }
+}
+
+void PendingRequestTable::completeAll(const ResponseFactory &makeResponse) {
+    std::vector<std::pair<std::string, Waiter>> entries;
+    {
+        QMutexLocker locker(&m_mutex);
+        entries.reserve(m_size);
+        for (Entry &entry : m_entries) {
+            if (!entry.inUse) {
+                continue;
+            }
+            m_wheel.cancel(&entry);
+            std::string requestId;
+            Waiter waiter = release(&entry, &requestId);
+            entries.emplace_back(std::move(requestId), std::move(waiter));
+        }
+    }
+
+    for (auto &item : entries) {
+        finish(item.second, makeResponse(item.first));
+    }
+}
+
+size_t PendingRequestTable::size() const {
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
+
+bool PendingRequestTable::hasDeadlines() const {
+    QMutexLocker locker(&m_mutex);
+    return !m_wheel.isEmpty();
+}
+
+PendingRequestTable::Entry *PendingRequestTable::allocate() {
+    quint32 index;
+    if (!m_freeEntries.empty()) {
+        index = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    } else {
+        index = quint32(m_entries.size());
+        m_entries.emplace_back();
+        m_entries.back().index = index;
+    }
+    Entry &entry = m_entries[index];
+    entry.inUse = true;
+    return &entry;
+}
+
+PendingRequestTable::Waiter PendingRequestTable::release(Entry *entry, std::string *requestId) {
+    if (entry->key != 0) {
+        eraseSlot(findSlot(entry->key));
+        --m_slotCount;
+        if (requestId) {
+            *requestId = RequestIdGenerator::toString(entry->key);
+        }
+    } else {
+        m_textEntries.erase(entry->textId);
+        if (requestId) {
+            *requestId = std::move(entry->textId);
+        }
+        entry->textId.clear();
+    }
+    --m_size;
+
+    Waiter waiter = std::move(entry->waiter);
+    entry->waiter = Waiter();
+    entry->key = 0;
+    entry->inUse = false;
+    m_freeEntries.push_back(entry->index);
+    return waiter;
+}
+
+PendingRequestTable::Entry *PendingRequestTable::find(const std::string &requestId, quint64 *key) {
+    if (RequestIdGenerator::parse(requestId, key) && *key != 0) {
+        Slot *slot = findSlot(*key);
+        return slot ? &m_entries[slot->entry] : nullptr;
+    }
+
+    *key = 0;
+    auto it = m_textEntries.find(requestId);
+    return it != m_textEntries.end() ? &m_entries[it->second] : nullptr;
+}
+
+size_t PendingRequestTable::home(quint64 key) const {
+    return size_t((key * kHashMultiplier) >> m_shift);
+}
+
+PendingRequestTable::Slot *PendingRequestTable::findSlot(quint64 key) {
+    // 负载不超过一半，探测总会碰到空槽
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = home(key);; i = (i + 1) & mask) {
+        Slot &slot = m_slots[i];
+        if (slot.key == key) {
+            return &slot;
+        }
+        if (slot.key == 0) {
+            return nullptr;
+        }
+    }
+}
+
+void PendingRequestTable::insertSlot(quint64 key, quint32 entry) {
+    const size_t mask = m_slots.size() - 1;
+    size_t i = home(key);
+    while (m_slots[i].key != 0) {
+        i = (i + 1) & mask;
+    }
+    m_slots[i].key = key;
+    m_slots[i].entry = entry;
+}
+
+void PendingRequestTable::eraseSlot(Slot *slot) {
+    // 向后移位删除：把探测链上后面的槽前移填补空位，不留墓碑，查找长度不会随删除累积
+    const size_t mask = m_slots.size() - 1;
+    size_t hole = size_t(slot - m_slots.data());
+    for (size_t i = (hole + 1) & mask; m_slots[i].key != 0; i = (i + 1) & mask) {
+        // 槽 i 的理想位置不在 (hole, i] 之间时可以移到 hole
+        if (((i - home(m_slots[i].key)) & mask) >= ((i - hole) & mask)) {
+            m_slots[hole] = m_slots[i];
+            hole = i;
+        }
+    }
+    m_slots[hole] = Slot();
+}
+
+void PendingRequestTable::grow() {
+    std::vector<Slot> old(m_slots.size() * 2);
+    old.swap(m_slots);
+    --m_shift;
+    for (const Slot &slot : old) {
+        if (slot.key != 0) {
+            insertSlot(slot.key, slot.entry);
+        }
+    }
+}
+
+void PendingRequestTable::finish(Waiter &waiter, const data::MessageFrame &response) {
+    waiter.promise.addResult(response);
+    waiter.promise.finish();
+    if (waiter.callback) {
+        waiter.callback(response);
+    }
+}
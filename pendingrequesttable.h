@@ -0,0 +1,94 @@
+#ifndef PENDINGREQUESTTABLE_H
+#define PENDINGREQUESTTABLE_H
+
+#include <QFuture>
+#include <QMutex>
+#include <QPromise>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "timingwheel.h"
+#include "protoc/data_proto.pb.h"
+
+// 请求/响应关联表：按 request_id 索引，每个在途请求有自己的 promise 和可选回调。
+// 紧凑格式的 request_id（见 RequestIdGenerator）解析成整数，放在线性探测的开放寻址表里，
+// 查找只比较整数、不分配内存；其他格式（UUID 等）退回按字符串哈希。
+// 条目放在复用的对象池里，地址稳定，截止时间挂在内置的分层时间轮上，过期检查的开销与在途请求数量无关。
+class PendingRequestTable
+{
+public:
+    using Callback = std::function<void(const data::MessageFrame &)>;
+    using ResponseFactory = std::function<data::MessageFrame(const std::string &)>;
+
+    // 截止时间使用调用方提供的单调时钟（毫秒），tickMs 是时间轮精度
+    explicit PendingRequestTable(qint64 tickMs = 10, size_t expectedRequests = 1024);
+
+    // 线程安全；deadlineMs <= 0 表示不设截止时间。request_id 重复时不登记，
+    // 用 onDuplicate(requestId) 生成的帧在调用线程立即完成 future 和回调；没有提供 onDuplicate 时返回已取消的 future
+    QFuture<data::MessageFrame> add(const std::string &requestId, qint64 deadlineMs,
+                                    Callback callback = {}, const ResponseFactory &onDuplicate = {});
+
+    // 找到对应请求时完成它并返回 true；回调在调用线程、锁外执行
+    bool complete(const data::MessageFrame &response);
+
+    // 用 makeResponse(requestId) 生成的帧完成截止时间早于 nowMs 的请求
+    void expire(qint64 nowMs, const ResponseFactory &makeResponse);
+
+    // 用 makeResponse(requestId) 生成的帧完成所有在途请求（例如连接断开）
+    void completeAll(const ResponseFactory &makeResponse);
+
+    size_t size() const;
+    bool hasDeadlines() const;
+
+private:
+    struct Waiter
+    {
+        QPromise<data::MessageFrame> promise;
+        Callback callback;
+    };
+
+    struct Entry : TimingWheel::Node
+    {
+        Waiter waiter;
+        // 紧凑格式的整数 ID；为 0 时 ID 原样存在 textId 里
+        quint64 key = 0;
+        std::string textId;
+        quint32 index = 0;
+        bool inUse = false;
+    };
+
+    struct Slot
+    {
+        quint64 key = 0;
+        quint32 entry = 0;
+    };
+
+    Entry *allocate();
+    // 摘下条目并放回对象池，返回它的等待者和 request_id
+    Waiter release(Entry *entry, std::string *requestId);
+    Entry *find(const std::string &requestId, quint64 *key);
+
+    size_t home(quint64 key) const;
+    Slot *findSlot(quint64 key);
+    void insertSlot(quint64 key, quint32 entry);
+    void eraseSlot(Slot *slot);
+    void grow();
+
+    static void finish(Waiter &waiter, const data::MessageFrame &response);
+
+    mutable QMutex m_mutex;
+    // 条目对象池：deque 扩容不移动已有元素，时间轮里的节点指针保持有效
+    std::deque<Entry> m_entries;
+    std::vector<quint32> m_freeEntries;
+    // 开放寻址表，容量是 2 的幂，负载不超过一半；key 为 0 的槽是空槽
+    std::vector<Slot> m_slots;
+    int m_shift;
+    size_t m_slotCount;
+    std::unordered_map<std::string, quint32> m_textEntries;
+    size_t m_size;
+    TimingWheel m_wheel;
+};
+
+#endif // PENDINGREQUESTTABLE_H
@@ -0,0 +1,157 @@
+#include "preparedrequest.h"
+#include "framedecoder.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+// 标签 = 字段号 << 3 | 线型（0 为 varint，2 为长度前缀）
+constexpr char kHeaderTag = (1 << 3) | 2;
+constexpr char kRequestIdTag = (1 << 3) | 2;
+constexpr char kClientIdTag = (2 << 3) | 2;
+constexpr char kTimestampTag = (3 << 3) | 0;
+constexpr char kTypeTag = (4 << 3) | 0;
+constexpr char kAuthTokenTag = (5 << 3) | 2;
+
+qsizetype varintSize(quint64 value) {
+    qsizetype size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+char *writeVarint(char *out, quint64 value) {
+    while (value >= 0x80) {
+        *out++ = char(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = char(value);
+    return out;
+}
+
+// 不论数值大小都写满 kTimestampWidth 字节：前面的字节都带续位，解析结果与最短编码相同
+char *writePaddedVarint(char *out, quint64 value) {
+    for (qsizetype i = 0; i < PreparedRequest::kTimestampWidth - 1; ++i) {
+        *out++ = char((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    *out++ = char(value & 0x7F);
+    return out;
+}
+
+char *writeString(char *out, char tag, const std::string &value) {
+    *out++ = tag;
+    out = writeVarint(out, value.size());
+    memcpy(out, value.data(), value.size());
+    return out + value.size();
+}
+}
+
+PreparedRequest::PreparedRequest()
+    : m_requestIdOffset(0)
+      , m_requestIdSize(0)
+      , m_timestampOffset(0)
+      , m_authTokenOffset(0)
+      , m_authTokenSize(0)
+      , m_bodySize(0)
+      , m_type(data::UNKNOWN)
+      , m_timeoutMs(0) {
+}
+
+PreparedRequest::PreparedRequest(const data::MessageFrame &message, qsizetype requestIdSize,
+                                 const std::string &authToken, int timeoutMs)
+    : m_requestIdOffset(0)
+      , m_requestIdSize(requestIdSize)
+      , m_timestampOffset(0)
+      , m_authTokenOffset(0)
+      , m_authTokenSize(qsizetype(authToken.size()))
+      , m_bodySize(0)
+      , m_clientId(message.header().client_id())
+      , m_type(message.header().type())
+      , m_timeoutMs(timeoutMs) {
+    // 请求体按 protobuf 正常序列化一次；请求头由本类按固定布局写在前面（字段顺序不影响解析）
+    data::MessageFrame body(message);
+    body.clear_header();
+    const std::string bodyBytes = body.SerializeAsString();
+    m_bodySize = qsizetype(bodyBytes.size());
+
+    const std::string placeholderId(size_t(requestIdSize), '0');
+    m_frame.resize(frameSize(requestIdSize, m_authTokenSize));
+    char *out = m_frame.data();
+    qToBigEndian<quint32>(quint32(m_frame.size() - FrameDecoder::kHeaderSize), out);
+
+    qsizetype offsets[3] = {};
+    char *const headerStart = out + FrameDecoder::kHeaderSize;
+    char *end = writeHeader(headerStart, placeholderId, 0, authToken, offsets);
+    const qsizetype headerBase = headerStart - m_frame.constData();
+    m_requestIdOffset = headerBase + offsets[0];
+    m_timestampOffset = headerBase + offsets[1];
+    m_authTokenOffset = headerBase + offsets[2];
+    memcpy(end, bodyBytes.data(), bodyBytes.size());
+}
+
+qsizetype PreparedRequest::headerSize(qsizetype requestIdSize, qsizetype authTokenSize) const {
+    qsizetype size = 1 + varintSize(quint64(requestIdSize)) + requestIdSize;
+    if (!m_clientId.empty()) {
+        size += 1 + varintSize(m_clientId.size()) + qsizetype(m_clientId.size());
+    }
+    size += 1 + kTimestampWidth;
+    size += 1 + varintSize(quint64(m_type));
+    if (authTokenSize > 0) {
+        size += 1 + varintSize(quint64(authTokenSize)) + authTokenSize;
+    }
+    return size;
+}
+
+qsizetype PreparedRequest::frameSize(qsizetype requestIdSize, qsizetype authTokenSize) const {
+    const qsizetype header = headerSize(requestIdSize, authTokenSize);
+    return FrameDecoder::kHeaderSize + 1 + varintSize(quint64(header)) + header + m_bodySize;
+}
+
+char *PreparedRequest::writeHeader(char *out, const std::string &requestId, qint64 timestamp,
+                                   const std::string &authToken, qsizetype *offsets) const {
+    char *const start = out;
+    *out++ = kHeaderTag;
+    out = writeVarint(out, quint64(headerSize(qsizetype(requestId.size()), qsizetype(authToken.size()))));
+
+    out = writeString(out, kRequestIdTag, requestId);
+    if (offsets) {
+        offsets[0] = (out - start) - qsizetype(requestId.size());
+    }
+    if (!m_clientId.empty()) {
+        out = writeString(out, kClientIdTag, m_clientId);
+    }
+    *out++ = kTimestampTag;
+    if (offsets) {
+        offsets[1] = out - start;
+    }
+    out = writePaddedVarint(out, quint64(timestamp));
+    *out++ = kTypeTag;
+    out = writeVarint(out, quint64(m_type));
+    if (!authToken.empty()) {
+        out = writeString(out, kAuthTokenTag, authToken);
+    }
+    if (offsets) {
+        offsets[2] = (out - start) - qsizetype(authToken.size());
+    }
+    return out;
+}
+
+void PreparedRequest::writeFrame(char *out, const std::string &requestId, qint64 timestamp,
+                                 const std::string &authToken) const {
+    if (qsizetype(requestId.size()) == m_requestIdSize && qsizetype(authToken.size()) == m_authTokenSize) {
+        // 布局与模板相同：整帧拷贝后覆盖可变字段
+        memcpy(out, m_frame.constData(), size_t(m_frame.size()));
+        memcpy(out + m_requestIdOffset, requestId.data(), requestId.size());
+        writePaddedVarint(out + m_timestampOffset, quint64(timestamp));
+        memcpy(out + m_authTokenOffset, authToken.data(), authToken.size());
+        return;
+    }
+
+    // 长度变了（换了会话或 request_id 格式）：重写长度前缀和请求头，请求体照旧整块拷贝
+    const qsizetype size = frameSize(qsizetype(requestId.size()), qsizetype(authToken.size()));
+    qToBigEndian<quint32>(quint32(size - FrameDecoder::kHeaderSize), out);
+    char *end = writeHeader(out + FrameDecoder::kHeaderSize, requestId, timestamp, authToken, nullptr);
+    memcpy(end, m_frame.constData() + m_frame.size() - m_bodySize, size_t(m_bodySize));
+}
@@ -0,0 +1,59 @@
+#ifndef PREPAREDREQUEST_H
+#define PREPAREDREQUEST_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <string>
+#include "protoc/data_proto.pb.h"
+
+// 预编码的请求模板：请求体、client_id 和 type 只序列化一次，得到一帧完整的
+// 4 字节大端长度前缀 + MessageFrame。每次发送时的 request_id、timestamp、auth_token 放在请求头里的固定位置：
+// timestamp 按 10 字节的补齐 varint 编码，两个字符串按模板里的长度预留。
+// 新值长度与模板一致时（同一种 request_id、同一个会话），发送一帧只是拷贝模板再覆盖这三个字段；
+// 长度不同时按新值重写请求头，请求体仍整块拷贝。
+// 模板创建后不再修改，可以在多个线程中同时使用。
+class PreparedRequest
+{
+public:
+    // 补齐 varint 的宽度，足以容纳任意 64 位值
+    static constexpr qsizetype kTimestampWidth = 10;
+
+    PreparedRequest();
+    // 取 message 的请求体以及请求头里的 client_id、type；请求头的其他字段被忽略。
+    // requestIdSize / authToken 决定模板里预留的长度，authToken 同时作为模板里的初始值
+    PreparedRequest(const data::MessageFrame &message, qsizetype requestIdSize,
+                    const std::string &authToken, int timeoutMs);
+
+    bool isNull() const { return m_frame.isEmpty(); }
+    data::RequestType type() const { return m_type; }
+    int timeoutMs() const { return m_timeoutMs; }
+
+    // 用这些长度的 request_id / auth_token 生成的帧的总字节数（含长度前缀）
+    qsizetype frameSize(qsizetype requestIdSize, qsizetype authTokenSize) const;
+    // 往 out 写入完整的一帧，out 至少要有 frameSize(requestId.size(), authToken.size()) 字节
+    void writeFrame(char *out, const std::string &requestId, qint64 timestamp,
+                    const std::string &authToken) const;
+
+private:
+    qsizetype headerSize(qsizetype requestIdSize, qsizetype authTokenSize) const;
+    // 写出 MessageFrame.header 字段（标签、长度和内容），返回写入后的位置；
+    // offsets 非空时记下三个可变字段内容在 out 中的偏移
+    char *writeHeader(char *out, const std::string &requestId, qint64 timestamp,
+                      const std::string &authToken, qsizetype *offsets) const;
+
+    // 模板帧，以及其中可变字段的偏移
+    QByteArray m_frame;
+    qsizetype m_requestIdOffset;
+    qsizetype m_requestIdSize;
+    qsizetype m_timestampOffset;
+    qsizetype m_authTokenOffset;
+    qsizetype m_authTokenSize;
+    // 不含请求头的 MessageFrame 序列化结果，在模板帧末尾
+    qsizetype m_bodySize;
+
+    std::string m_clientId;
+    data::RequestType m_type;
+    int m_timeoutMs;
+};
+
+#endif // PREPAREDREQUEST_H
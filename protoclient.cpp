@@ -1,86 +1,223 @@
 #include "protoclient.h"
+#include "protoutil.h"
 #include <QDateTime>
 #include <QDebug>
+#include <QPromise>
+#include <limits>
+
+namespace {
+// 会话到期前多久开始续期（不超过剩余有效期的 1/5），以及续期失败后的重试间隔
+constexpr qint64 kRenewLeadMs = 5 * 60 * 1000;
+constexpr qint64 kRenewRetryMs = 10 * 1000;
+
+// runPipeline 的三步
+constexpr int kSaveStep = 0;
+constexpr int kCompileStep = 1;
+constexpr int kExecuteStep = 2;
+constexpr int kPipelineSteps = 3;
+// 原子流水线没有生效后，隔多久再试
+constexpr qint64 kAtomicRetryMs = 60 * 1000;
+
+// 流水线中一步的响应是否成功（ERROR_RESPONSE 或 success = false 都算失败）
+bool stepSucceeded(const data::MessageFrame &response)
+{
+    switch (response.body_case()) {
+    case data::MessageFrame::kSaveSourceResponse:
+        return response.save_source_response().success();
+    case data::MessageFrame::kCompileResponse:
+        return response.compile_response().success();
+    case data::MessageFrame::kExecuteIrResponse:
+        return response.execute_ir_response().success();
+    default:
+        return false;
+    }
+}
+
+// 服务端整体拒绝了批次帧（见 NetworkManager::sendBatchRequest），不是某一步执行失败
+bool batchRejected(const data::MessageFrame &response)
+{
+    return response.has_error_response()
+           && response.error_response().request_type() == data::RequestType_Name(data::BATCH_REQUEST);
+}
+
+// 编译/执行请求里留空了前一步的 id（原子批次里由服务端填写）
+bool missingPreviousId(const data::MessageFrame &request)
+{
+    switch (request.body_case()) {
+    case data::MessageFrame::kCompileRequest:
+        return request.compile_request().code_id().empty();
+    case data::MessageFrame::kExecuteIrRequest:
+        return request.execute_ir_request().ir_code_id().empty();
+    default:
+        return false;
+    }
+}
+
+// 一步成功后交给下一步的 id：保存得到的 code_id、编译得到的 ir_code_id
+const std::string &stepOutput(const data::MessageFrame &response)
+{
+    return response.has_save_source_response() ? response.save_source_response().code_id()
+                                               : response.compile_response().ir_code_id();
+}
+}
+
+// 一次 runPipeline 的状态，各步的回调共享。steps 是三步的请求，原子批次发出期间移到 batch 里
+struct ProtoClient::PipelineRun
+{
+    QPromise<data::MessageFrame> promise;
+    std::array<data::MessageFrame, kPipelineSteps> steps;
+    data::MessageFrame batch;
+    // 原子批次里已成功的各步交给下一步的 id，退回串联时接着用
+    std::array<std::string, kPipelineSteps> outputs;
+    std::atomic<bool> settled{false};
+    // 从哪一步退回了串联；-1 表示没有。退回后批次里剩下的应答不再处理，只退回一次
+    std::atomic<int> chainedFrom{-1};
+
+    // 只有第一次调用生效
+    void finish(const data::MessageFrame &response)
+    {
+        if (!settled.exchange(true)) {
+            promise.addResult(response);
+            promise.finish();
+        }
+    }
+};
 
 ProtoClient::ProtoClient(QObject *parent)
+    : ProtoClient(1, 1, parent)
+{
+}
+
+ProtoClient::ProtoClient(int connections, int ioThreads, QObject *parent)
     : QObject(parent)
-    , m_networkManager(new NetworkManager(this))
+    , m_connections(new ConnectionPool(connections, ioThreads, this))
+    , m_ownsConnections(true)
+    , m_session(&SessionManager::instance().defaultContext())
     , m_sessionCheckTimer(new QTimer(this))
+    , m_sharedBatcher(nullptr)
+    , m_atomicRetryAtMs(0)
 {
     // 连接消息接收信号
-    connect(m_networkManager, &NetworkManager::messageReceived,
+    connect(m_connections, &ConnectionPool::messageReceived,
             this, &ProtoClient::onMessageReceived);
 
     // 连接错误信号
-    connect(m_networkManager, &NetworkManager::connectionError,
+    connect(m_connections, &ConnectionPool::connectionError,
             this, &ProtoClient::onNetworkError);
 
     // 修复：使用 lambda 表达式来处理连接状态变化
-    connect(m_networkManager, &NetworkManager::connected, this, [this]() {
+    connect(m_connections, &ConnectionPool::connected, this, [this]() {
         emit connectionStateChanged(true);
     });
 
-    connect(m_networkManager, &NetworkManager::disconnected, this, [this]() {
+    connect(m_connections, &ConnectionPool::disconnected, this, [this]() {
         emit connectionStateChanged(false);
     });
 
-    m_sessionCheckTimer->setInterval(60000); // 每分钟检查一次会话
-    connect(m_sessionCheckTimer, &QTimer::timeout, this, [this]() {
-        if (SessionManager::instance().isLoggedIn() &&
-            QDateTime::currentMSecsSinceEpoch() > SessionManager::instance().expireTime() - 300000) {
-            onSessionExpired();
-        }
-    });
+    // 续期定时器按会话的过期时间排期，会话变化（登录、续期、登出）时重新排期
+    m_sessionCheckTimer->setSingleShot(true);
+    connect(m_sessionCheckTimer, &QTimer::timeout, this, &ProtoClient::renewSession);
+    connect(m_session, &SessionContext::sessionChanged, this, &ProtoClient::scheduleRenewal);
+}
+
+ProtoClient::ProtoClient(ConnectionPool *connections, SessionContext *session, QObject *parent)
+    : QObject(parent)
+    , m_connections(connections)
+    , m_ownsConnections(false)
+    , m_session(session)
+    , m_sessionCheckTimer(new QTimer(this))
+    , m_sharedBatcher(nullptr)
+    , m_atomicRetryAtMs(0)
+{
+    m_sessionCheckTimer->setSingleShot(true);
+    connect(m_sessionCheckTimer, &QTimer::timeout, this, &ProtoClient::renewSession);
+    connect(m_session, &SessionContext::sessionChanged, this, &ProtoClient::scheduleRenewal);
 }
 
 ProtoClient::~ProtoClient()
 {
-    disconnectFromServer();
+    // 攒着的请求趁连接还在时发出
+    m_batcher.reset();
+    if (m_ownsConnections) {
+        disconnectFromServer();
+    }
 }
 
 bool ProtoClient::connectToServer(const QString &host, quint16 port)
 {
-    return m_networkManager->connectToServer(host, port);
+    return m_connections->connectToServer(host, port) > 0;
 }
 
 void ProtoClient::disconnectFromServer()
 {
-    m_networkManager->disconnectFromServer();
+    m_connections->disconnectFromServer();
     m_sessionCheckTimer->stop();
 }
 
 bool ProtoClient::isConnected() const
 {
-    return m_networkManager->isConnected();
+    return m_connections->isConnected();
 }
 
 // 添加 setAutoReconnect 方法的实现
 void ProtoClient::setAutoReconnect(bool enable, int interval)
 {
-    m_networkManager->setAutoReconnect(enable, interval);
+    m_connections->setAutoReconnect(enable, interval);
 }
 
-void ProtoClient::login(const QString &username, const QString &passwordHash,
-                        const QString &deviceInfo, const QString &appVersion)
+void ProtoClient::startCapture(const std::shared_ptr<TrafficCapture> &capture, quint16 firstStream)
 {
-    data::MessageFrame message = createBaseMessage(data::LOGIN_REQUEST);
-
-    data::LoginRequest loginRequest;
-    loginRequest.set_username(username.toStdString());
-    loginRequest.set_password_hash(passwordHash.toStdString());
-    loginRequest.set_device_info(deviceInfo.toStdString());
-    loginRequest.set_app_version(appVersion.toStdString());
+    m_connections->startCapture(capture, firstStream);
+}
 
-    message.mutable_login_request()->CopyFrom(loginRequest);
+void ProtoClient::stopCapture()
+{
+    m_connections->stopCapture();
+}
 
-    if (!m_networkManager->sendMessage(message)) {
-        emit loginResult(false, "发送登录请求失败");
+void ProtoClient::setBatching(int maxRequests, int maxDelayUs)
+{
+    // 先发出旧批量层里攒着的请求
+    m_batcher.reset();
+    m_sharedBatcher = nullptr;
+    if (maxRequests > 1) {
+        m_batcher = std::make_unique<RequestBatcher>(m_connections, m_session, maxRequests, maxDelayUs);
     }
 }
 
+void ProtoClient::shareBatching(RequestBatcher *batcher)
+{
+    m_batcher.reset();
+    m_sharedBatcher = batcher;
+}
+
+void ProtoClient::mergeLatencyInto(LatencyRecorder::Snapshot &snapshot) const
+{
+    m_connections->mergeLatencyInto(snapshot);
+}
+
+QFuture<data::MessageFrame> ProtoClient::login(const QString &username, const QString &passwordHash,
+                                               const QString &deviceInfo, const QString &appVersion)
+{
+    // 会话快到期时用这个账号在后台重新登录
+    m_session->setCredentials(username, passwordHash);
+    data::MessageFrame message = createBaseMessage(*m_session, data::LOGIN_REQUEST);
+
+    // 请求体直接在帧内构造，字符串一次编码进目标字段
+    auto *loginRequest = message.mutable_login_request();
+    assignUtf8(loginRequest->mutable_username(), username);
+    assignUtf8(loginRequest->mutable_password_hash(), passwordHash);
+    assignUtf8(loginRequest->mutable_device_info(), deviceInfo);
+    assignUtf8(loginRequest->mutable_app_version(), appVersion);
+
+    return sendTrackedRequest(message, [this](const QString &error) {
+        emit loginResult(false, error);
+    });
+}
+
 void ProtoClient::logout()
 {
-    SessionManager::instance().logout();
+    m_session->logout();
     m_sessionCheckTimer->stop();
 }
 
@@ -92,66 +229,251 @@ void ProtoClient::autoLogin()
     }
 }
 
-void ProtoClient::saveSourceCode(const QString &codeId, const QString &language,
-                                 const QString &sourceCode, const QString &codeName,
-                                 const QString &description, const QMap<QString, QString> &metadata)
+QFuture<data::MessageFrame> ProtoClient::saveSourceCode(const QString &codeId, const QString &language,
+                                                        const QString &sourceCode, const QString &codeName,
+                                                        const QString &description,
+                                                        const QMap<QString, QString> &metadata)
 {
-    data::MessageFrame message = createBaseMessage(data::SAVE_SOURCE_CODE_REQUEST);
+    data::MessageFrame message = createBaseMessage(*m_session, data::SAVE_SOURCE_CODE_REQUEST);
+    assignUtf8(message.mutable_save_source_request()->mutable_source_code(), sourceCode);
+    return sendSaveSourceRequest(message, codeId, language, codeName, description, metadata);
+}
 
-    data::SaveSourceCodeRequest request;
-    request.set_code_id(codeId.toStdString());
-    request.set_language(language.toStdString());
-    request.set_source_code(sourceCode.toStdString());
-    request.set_code_name(codeName.toStdString());
-    request.set_description(description.toStdString());
+QFuture<data::MessageFrame> ProtoClient::saveSourceCodeUtf8(const QString &codeId, const QString &language,
+                                                            std::string &&sourceCode, const QString &codeName,
+                                                            const QString &description,
+                                                            const QMap<QString, QString> &metadata)
+{
+    data::MessageFrame message = createBaseMessage(*m_session, data::SAVE_SOURCE_CODE_REQUEST);
+    message.mutable_save_source_request()->set_source_code(std::move(sourceCode));
+    return sendSaveSourceRequest(message, codeId, language, codeName, description, metadata);
+}
 
-    for (auto it = metadata.constBegin(); it != metadata.constEnd(); ++it) {
-        (*request.mutable_metadata())[it.key().toStdString()] = it.value().toStdString();
-    }
+QFuture<data::MessageFrame> ProtoClient::compileSourceCode(const QString &codeId, const QString &compilerOptions,
+                                                           bool optimize, const QString &targetIrVersion)
+{
+    data::MessageFrame message = createBaseMessage(*m_session, data::COMPILE_SOURCE_REQUEST);
+    fillCompileRequest(message, codeId, compilerOptions, optimize, targetIrVersion);
 
-    message.mutable_save_source_request()->CopyFrom(request);
+    return sendTrackedRequest(message, [this](const QString &error) {
+        emit compileResult(false, "", error);
+    });
+}
+
+QFuture<data::MessageFrame> ProtoClient::executeIrCode(const QString &irCodeId,
+                                                       data::ExecuteIRCodeRequest_ExecutionMode mode,
+                                                       const QMap<QString, QString> &parameters, uint32_t timeout)
+{
+    data::MessageFrame message = createBaseMessage(*m_session, data::EXECUTE_IR_REQUEST);
+    fillExecuteRequest(message, irCodeId, mode, parameters, timeout);
+
+    return sendTrackedRequest(message, [this](const QString &error) {
+        emit executeResult(false, "", error);
+    }, executeDeadlineMs(timeout));
+}
+
+PreparedRequest ProtoClient::prepareRequest(const data::MessageFrame &message, int timeoutMs) const
+{
+    // request_id 是定长的；auth_token 按当前会话预留
+    const qsizetype requestIdSize = m_session->requestIdSize();
+    const SessionContext::Snapshot state = m_session->snapshot();
+    return PreparedRequest(message, requestIdSize, state->authTokenAt(QDateTime::currentMSecsSinceEpoch()),
+                           timeoutMs);
+}
+
+PreparedRequest ProtoClient::prepareExecuteIrCode(const QString &irCodeId,
+                                                  data::ExecuteIRCodeRequest_ExecutionMode mode,
+                                                  const QMap<QString, QString> &parameters, uint32_t timeout) const
+{
+    data::MessageFrame message = createBaseMessage(*m_session, data::EXECUTE_IR_REQUEST);
+    fillExecuteRequest(message, irCodeId, mode, parameters, timeout);
+    return prepareRequest(message, executeDeadlineMs(timeout));
+}
+
+QFuture<data::MessageFrame> ProtoClient::sendPrepared(const PreparedRequest &request)
+{
+    const std::string requestId = m_session->nextRequestId();
+    // 快照保证发送期间 token 不被回收
+    const SessionContext::Snapshot state = m_session->snapshot();
+    const std::string &authToken = state->authTokenAt(QDateTime::currentMSecsSinceEpoch());
+    const data::RequestType type = request.type();
+    return m_connections->sendPreparedRequest(request, requestId, authToken,
+                                              [this, type](const data::MessageFrame &response) {
+        deliverResponse(type, response);
+    });
+}
 
-    if (!m_networkManager->sendMessage(message)) {
-        emit saveSourceCodeResult(false, "", "发送保存请求失败");
+QFuture<data::MessageFrame> ProtoClient::runPipeline(const QString &codeId, const QString &language,
+                                                     const QString &sourceCode, const QString &codeName,
+                                                     const QString &compilerOptions, bool optimize,
+                                                     data::ExecuteIRCodeRequest_ExecutionMode mode,
+                                                     const QMap<QString, QString> &parameters, uint32_t timeout)
+{
+    auto run = std::make_shared<PipelineRun>();
+    run->promise.start();
+    QFuture<data::MessageFrame> future = run->promise.future();
+
+    // 三步的请求体先全部构造好；请求头在发出时填写。编译的 code_id 和执行的 ir_code_id 留给前一步的结果
+    data::MessageFrame &save = run->steps[kSaveStep];
+    save.mutable_header()->set_type(data::SAVE_SOURCE_CODE_REQUEST);
+    assignUtf8(save.mutable_save_source_request()->mutable_source_code(), sourceCode);
+    fillSaveRequest(save, codeId, language, codeName, "", {});
+
+    data::MessageFrame &compile = run->steps[kCompileStep];
+    compile.mutable_header()->set_type(data::COMPILE_SOURCE_REQUEST);
+    fillCompileRequest(compile, codeId, compilerOptions, optimize, "");
+
+    data::MessageFrame &execute = run->steps[kExecuteStep];
+    execute.mutable_header()->set_type(data::EXECUTE_IR_REQUEST);
+    fillExecuteRequest(execute, "", mode, parameters, timeout);
+
+    if (QDateTime::currentMSecsSinceEpoch() >= m_atomicRetryAtMs.load(std::memory_order_relaxed)) {
+        runAtomicPipeline(run);
+    } else {
+        runPipelineStep(run, kSaveStep, std::string());
     }
+    return future;
 }
 
-void ProtoClient::compileSourceCode(const QString &codeId, const QString &compilerOptions,
-                                    bool optimize, const QString &targetIrVersion)
+void ProtoClient::runAtomicPipeline(const std::shared_ptr<PipelineRun> &run)
 {
-    data::MessageFrame message = createBaseMessage(data::COMPILE_SOURCE_REQUEST);
+    run->batch = createBaseMessage(*m_session, data::BATCH_REQUEST);
+    auto *batch = run->batch.mutable_batch();
+    batch->set_need_atomic(true);
+
+    QVector<NetworkManager::BatchEntry> entries(kPipelineSteps);
+    for (int step = 0; step < kPipelineSteps; ++step) {
+        // 请求整体换进批次，不拷贝源码；退回串联时再换回来
+        data::MessageFrame *request = batch->add_sub_requests();
+        request->Swap(&run->steps[step]);
+        const data::RequestType type = request->header().type();
+        data::MessageFrame base = createBaseMessage(*m_session, type);
+        request->mutable_header()->Swap(base.mutable_header());
+
+        // 服务端按顺序执行，执行一步的截止时间要算上前两步的处理时间
+        if (step == kExecuteStep) {
+            entries[step].timeoutMs = executeDeadlineMs(request->execute_ir_request().timeout())
+                                      + NetworkManager::kDefaultRequestTimeoutMs;
+        }
+        entries[step].callback = [this, run, step, type](const data::MessageFrame &response) {
+            if (run->chainedFrom.load() >= 0) {
+                return;
+            }
+            // 批次被整体拒绝时从头串联；服务端忽略 need_atomic、各步单独执行时，
+            // 缺前一步 id 的编译/执行会失败，这时从这一步接着串联，已成功的步骤不重发
+            const bool succeeded = stepSucceeded(response);
+            if (batchRejected(response)) {
+                fallBackToChained(run, kSaveStep, response);
+                return;
+            }
+            if (!succeeded && step != kSaveStep && !run->outputs[step - 1].empty()
+                && missingPreviousId(run->batch.batch().sub_requests(step))) {
+                fallBackToChained(run, step, response);
+                return;
+            }
+
+            deliverResponse(type, response);
+            if (succeeded && step != kExecuteStep) {
+                run->outputs[step] = stepOutput(response);
+            }
+            if (step == kExecuteStep || !succeeded) {
+                run->finish(response);
+            }
+        };
+    }
 
-    data::CompileSourceCodeRequest request;
-    request.set_code_id(codeId.toStdString());
-    request.set_compiler_options(compilerOptions.toStdString());
-    request.set_optimize(optimize);
-    request.set_target_ir_version(targetIrVersion.toStdString());
+    m_connections->sendBatchRequest(run->batch, std::move(entries));
+}
 
-    message.mutable_compile_request()->CopyFrom(request);
+void ProtoClient::fallBackToChained(const std::shared_ptr<PipelineRun> &run, int step,
+                                    const data::MessageFrame &response)
+{
+    run->chainedFrom.store(step);
+    qWarning() << "Atomic pipeline not honoured by server, continuing with chained requests from step" << step
+               << QString::fromStdString(response.error_response().detail());
+    m_atomicRetryAtMs.store(QDateTime::currentMSecsSinceEpoch() + kAtomicRetryMs, std::memory_order_relaxed);
 
-    if (!m_networkManager->sendMessage(message)) {
-        emit compileResult(false, "", "发送编译请求失败");
+    for (int i = step; i < kPipelineSteps; ++i) {
+        run->steps[i].Swap(run->batch.mutable_batch()->mutable_sub_requests(i));
     }
+    runPipelineStep(run, step, step == kSaveStep ? std::string() : run->outputs[step - 1]);
 }
 
-void ProtoClient::executeIrCode(const QString &irCodeId, data::ExecuteIRCodeRequest_ExecutionMode mode,
-                                const QMap<QString, QString> &parameters, uint32_t timeout)
+void ProtoClient::runPipelineStep(const std::shared_ptr<PipelineRun> &run, int step, const std::string &previousId)
 {
-    data::MessageFrame message = createBaseMessage(data::EXECUTE_IR_REQUEST);
+    data::MessageFrame &message = run->steps[step];
+    const data::RequestType type = message.header().type();
+    // 重新填写请求头：新的 request_id、时间戳和当前 auth_token
+    data::MessageFrame base = createBaseMessage(*m_session, type);
+    message.mutable_header()->Swap(base.mutable_header());
+
+    int timeoutMs = NetworkManager::kDefaultRequestTimeoutMs;
+    if (step == kCompileStep && !previousId.empty()) {
+        message.mutable_compile_request()->set_code_id(previousId);
+    } else if (step == kExecuteStep) {
+        message.mutable_execute_ir_request()->set_ir_code_id(previousId);
+        timeoutMs = executeDeadlineMs(message.execute_ir_request().timeout());
+    }
 
-    data::ExecuteIRCodeRequest request;
-    request.set_ir_code_id(irCodeId.toStdString());
-    request.set_mode(mode);
-    request.set_timeout(timeout);
+    // 下一步直接在响应回调里发出，不经过事件循环
+    m_connections->sendRequest(message, [this, run, step, type](const data::MessageFrame &response) {
+        deliverResponse(type, response);
+        if (step == kExecuteStep || !stepSucceeded(response)) {
+            run->finish(response);
+            return;
+        }
+        runPipelineStep(run, step + 1, stepOutput(response));
+    }, timeoutMs);
+}
 
+void ProtoClient::fillExecuteRequest(data::MessageFrame &message, const QString &irCodeId,
+                                     data::ExecuteIRCodeRequest_ExecutionMode mode,
+                                     const QMap<QString, QString> &parameters, uint32_t timeout)
+{
+    auto *request = message.mutable_execute_ir_request();
+    assignUtf8(request->mutable_ir_code_id(), irCodeId);
+    request->set_mode(mode);
+    request->set_timeout(timeout);
+
+    auto &fields = *request->mutable_parameters();
     for (auto it = parameters.constBegin(); it != parameters.constEnd(); ++it) {
-        (*request.mutable_parameters())[it.key().toStdString()] = it.value().toStdString();
+        assignUtf8(&fields[it.key().toStdString()], it.value());
     }
+}
+
+int ProtoClient::executeDeadlineMs(uint32_t timeout)
+{
+    // 请求截止时间 = 服务端执行超时 + 网络往返余量
+    return static_cast<int>(qMin<uint32_t>(timeout, 3600) * 1000) + 5000;
+}
 
-    message.mutable_execute_ir_request()->CopyFrom(request);
+void ProtoClient::emitRequestFailure(data::RequestType type, const QString &error)
+{
+    switch (type) {
+    case data::LOGIN_REQUEST:
+        emit loginResult(false, error);
+        break;
+    case data::SAVE_SOURCE_CODE_REQUEST:
+        emit saveSourceCodeResult(false, "", error);
+        break;
+    case data::COMPILE_SOURCE_REQUEST:
+        emit compileResult(false, "", error);
+        break;
+    case data::EXECUTE_IR_REQUEST:
+        emit executeResult(false, "", error);
+        break;
+    default:
+        emit errorOccurred(error);
+        break;
+    }
+}
 
-    if (!m_networkManager->sendMessage(message)) {
-        emit executeResult(false, "", "发送执行请求失败");
+void ProtoClient::deliverResponse(data::RequestType type, const data::MessageFrame &response)
+{
+    if (response.header().type() == data::ERROR_RESPONSE) {
+        emitRequestFailure(type, handleRequestError(response.error_response()));
+    } else {
+        onMessageReceived(response);
     }
 }
 
@@ -193,43 +515,173 @@ void ProtoClient::onNetworkError(const QString &error)
     emit errorOccurred(error);
 }
 
+void ProtoClient::scheduleRenewal()
+{
+    m_sessionCheckTimer->stop();
+    const SessionContext::Snapshot state = m_session->snapshot();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!state->isLoggedInAt(now)) {
+        return;
+    }
+    const qint64 remaining = state->tokenExpireMs - now;
+    const qint64 lead = qMin(kRenewLeadMs, remaining / 5);
+    m_sessionCheckTimer->start(int(qBound<qint64>(0, remaining - lead, std::numeric_limits<int>::max())));
+}
+
+void ProtoClient::renewSession()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    data::MessageFrame message;
+    {
+        const SessionContext::Snapshot state = m_session->snapshot();
+        if (!state->isLoggedInAt(now)) {
+            // 到期前一直没有续期成功
+            onSessionExpired();
+            return;
+        }
+        if (state->username.isEmpty() || !m_session->beginRenewal()) {
+            // 没有可用的账号，或者共用这个会话的其他客户端正在续期：稍后再看，会话在此之前仍然有效
+            m_sessionCheckTimer->start(int(qBound<qint64>(0, state->tokenExpireMs - now, kRenewRetryMs)));
+            return;
+        }
+
+        // 在后台重新登录，LoginRequest.token 带上当前 token。旧 token 在到期前一直有效，
+        // 续期期间照常发送请求；拿到新 token 后用 updateSession 原子替换，此后构造的请求都带新 token
+        message = createBaseMessage(*m_session, data::LOGIN_REQUEST);
+        auto *request = message.mutable_login_request();
+        assignUtf8(request->mutable_username(), state->username);
+        assignUtf8(request->mutable_password_hash(), state->passwordHash);
+        request->set_token(state->authTokenAt(now));
+    }
+
+    m_connections->sendRequest(message, [this](const data::MessageFrame &response) {
+        m_session->endRenewal();
+        if (response.header().type() == data::LOGIN_RESPONSE && response.login_response().success()) {
+            const data::LoginResponse &login = response.login_response();
+            const QString sessionId = login.session_id().empty() ? m_session->sessionId()
+                                                                 : QString::fromStdString(login.session_id());
+            // 触发 sessionChanged，各客户端按新的过期时间重新排期
+            m_session->updateSession(sessionId, login.expire_time());
+            return;
+        }
+
+        qWarning() << "Session renewal failed:"
+                   << (response.header().type() == data::ERROR_RESPONSE
+                           ? QString::fromStdString(response.error_response().message())
+                           : QStringLiteral("login rejected"));
+        const qint64 remaining = m_session->snapshot()->tokenExpireMs - QDateTime::currentMSecsSinceEpoch();
+        m_sessionCheckTimer->start(int(qBound<qint64>(0, remaining, kRenewRetryMs)));
+    });
+}
+
 void ProtoClient::onSessionExpired()
 {
     emit errorOccurred("会话已过期，请重新登录");
     logout();
 }
 
-data::MessageFrame ProtoClient::createBaseMessage(data::RequestType type) const
+data::MessageFrame ProtoClient::createBaseMessage(SessionContext &session, data::RequestType type)
 {
     data::MessageFrame message;
     auto* header = message.mutable_header();
 
-    header->set_request_id(SessionManager::instance().generateRequestId().toStdString());
-    header->set_client_id("ProtoClientTester");
-    header->set_timestamp(QDateTime::currentMSecsSinceEpoch());
+    // 每个请求只有一次计数自增和一次读时钟，client_id/auth_token 直接拷贝会话快照里预编码的字节；
+    // 取快照不加锁，并发登录或续期时读到的 token 和过期时间也总是配套的
+    const SessionContext::Snapshot state = session.snapshot();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    session.nextRequestId(header->mutable_request_id());
+    header->set_client_id(state->encodedClientId);
+    header->set_timestamp(now);
     header->set_type(type);
 
-    if (SessionManager::instance().isLoggedIn()) {
-        header->set_auth_token(SessionManager::instance().sessionId().toStdString());
+    const std::string &authToken = state->authTokenAt(now);
+    if (!authToken.empty()) {
+        header->set_auth_token(authToken);
     }
 
     return message;
 }
 
+data::MessageFrame ProtoClient::createBaseMessage(data::RequestType type)
+{
+    return createBaseMessage(SessionManager::instance().defaultContext(), type);
+}
+
+QFuture<data::MessageFrame> ProtoClient::sendTrackedRequest(data::MessageFrame &message,
+                                                            std::function<void(const QString &)> onFailure,
+                                                            int timeoutMs)
+{
+    // 响应按 request_id 回到发起方：错误转成对应请求的失败结果，其余照常分发
+    auto callback = [this, onFailure](const data::MessageFrame &response) {
+        if (response.header().type() == data::ERROR_RESPONSE) {
+            onFailure(handleRequestError(response.error_response()));
+        } else {
+            onMessageReceived(response);
+        }
+    };
+    RequestBatcher *requestBatcher = batcher();
+    if (requestBatcher && message.header().type() != data::LOGIN_REQUEST) {
+        return requestBatcher->submit(std::move(message), std::move(callback), timeoutMs);
+    }
+    return m_connections->sendRequest(message, std::move(callback), timeoutMs);
+}
+
+QFuture<data::MessageFrame> ProtoClient::sendSaveSourceRequest(data::MessageFrame &message,
+                                                               const QString &codeId, const QString &language,
+                                                               const QString &codeName, const QString &description,
+                                                               const QMap<QString, QString> &metadata)
+{
+    fillSaveRequest(message, codeId, language, codeName, description, metadata);
+    return sendTrackedRequest(message, [this](const QString &error) {
+        emit saveSourceCodeResult(false, "", error);
+    });
+}
+
+void ProtoClient::fillSaveRequest(data::MessageFrame &message, const QString &codeId, const QString &language,
+                                  const QString &codeName, const QString &description,
+                                  const QMap<QString, QString> &metadata)
+{
+    auto *request = message.mutable_save_source_request();
+    assignUtf8(request->mutable_code_id(), codeId);
+    assignUtf8(request->mutable_language(), language);
+    assignUtf8(request->mutable_code_name(), codeName);
+    assignUtf8(request->mutable_description(), description);
+
+    auto &fields = *request->mutable_metadata();
+    for (auto it = metadata.constBegin(); it != metadata.constEnd(); ++it) {
+        assignUtf8(&fields[it.key().toStdString()], it.value());
+    }
+}
+
+void ProtoClient::fillCompileRequest(data::MessageFrame &message, const QString &codeId,
+                                     const QString &compilerOptions, bool optimize, const QString &targetIrVersion)
+{
+    auto *request = message.mutable_compile_request();
+    assignUtf8(request->mutable_code_id(), codeId);
+    assignUtf8(request->mutable_compiler_options(), compilerOptions);
+    request->set_optimize(optimize);
+    assignUtf8(request->mutable_target_ir_version(), targetIrVersion);
+}
+
 void ProtoClient::handleLoginResponse(const data::LoginResponse &response)
 {
     bool success = response.success();
     QString message = QString::fromStdString(response.session_id());
 
     if (success) {
-        SessionManager::instance().login(response);
-        m_sessionCheckTimer->start();
+        // 触发 sessionChanged，续期定时器随之排期
+        m_session->login(response);
     }
 
     emit loginResult(success, message);
 }
 
 void ProtoClient::handleErrorResponse(const data::ErrorResponse &response)
+{
+    emit errorOccurred(handleRequestError(response));
+}
+
+QString ProtoClient::handleRequestError(const data::ErrorResponse &response)
 {
     QString errorCodeStr;
     if (response.has_common_code()) {
@@ -259,7 +711,7 @@ void ProtoClient::handleErrorResponse(const data::ErrorResponse &response)
         onSessionExpired();
     }
 
-    emit errorOccurred(errorMsg);
+    return errorMsg;
 }
 
 void ProtoClient::handleNotification(const data::Notification &notification)
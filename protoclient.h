@@ -3,9 +3,19 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QFuture>
+#include <functional>
 #include <QMap>  // 添加这行
 #include <QString>  // 添加这行
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "connectionpool.h"
 #include "networkmanager.h"
+#include "preparedrequest.h"
+#include "requestbatcher.h"
+#include "sessioncontext.h"
 #include "sessionmanager.h"
 #include "protoc/data_proto.pb.h"
 
@@ -15,8 +25,18 @@ class ProtoClient : public QObject
 
 public:
     explicit ProtoClient(QObject *parent = nullptr);
+    // 打开 connections 个连接，分摊到 ioThreads 个 I/O 线程上，请求发往在途最少的连接
+    ProtoClient(int connections, int ioThreads, QObject *parent = nullptr);
+    // 压测中的虚拟用户：共用 connections 的连接，会话状态用 session。
+    // 两者都不归本对象所有，须比本对象活得久；连接的建立、断开和主动推送的消息由 connections 的所有者处理
+    ProtoClient(ConnectionPool *connections, SessionContext *session, QObject *parent = nullptr);
     ~ProtoClient();
 
+    // 请求头使用的会话；默认是 SessionManager 的默认会话
+    SessionContext *session() const { return m_session; }
+    ConnectionPool *connectionPool() const { return m_connections; }
+
+    // 至少一个连接建立成功时返回 true
     bool connectToServer(const QString &host, quint16 port);
     void disconnectFromServer();
     bool isConnected() const;
@@ -24,22 +44,75 @@ public:
     // 添加自动重连设置方法
     void setAutoReconnect(bool enable, int interval = 5000);
 
-    void login(const QString &username, const QString &passwordHash,
-               const QString &deviceInfo = "", const QString &appVersion = "");
+    // 把各连接收发的帧记入抓包文件（见 TrafficCapture），连接号从 firstStream 开始
+    void startCapture(const std::shared_ptr<TrafficCapture> &capture, quint16 firstStream = 0);
+    void stopCapture();
+
+    // 可选的自动批量（见 RequestBatcher）：之后的 save/compile/execute 请求攒满 maxRequests 个
+    // 或等了 maxDelayUs 微秒后合成一个 BatchRequest 发出，登录和预编码请求照常单独发送。
+    // maxRequests <= 1 时关闭，攒着的请求立即发出。在发送请求之前、ProtoClient 所属线程调用
+    void setBatching(int maxRequests, int maxDelayUs = RequestBatcher::kDefaultMaxDelayUs);
+    // 改用另一个客户端的批量层：同一连接池上的多个会话共用一个，批次才能跨会话合并。
+    // batcher 须建在本对象的连接池上并比本对象活得久；自己的批量层随之关闭，传 nullptr 取消共用
+    void shareBatching(RequestBatcher *batcher);
+    RequestBatcher *batcher() const { return m_batcher ? m_batcher.get() : m_sharedBatcher; }
+
+    // 把各连接按请求类型记录的延迟（含心跳往返）累加进 snapshot
+    void mergeLatencyInto(LatencyRecorder::Snapshot &snapshot) const;
+
+    // 以下请求都按 request_id 关联响应：结果信号照常发出，
+    // 返回的 future 在对应响应（或本地合成的 ERROR_RESPONSE）到达时完成，调用方可以流水线式并发提交。
+    // 这些方法可以在多个工作线程中同时调用，结果信号和回调都在 ProtoClient 所属线程发出
+    // （本地发送失败时 future 在调用线程立即完成，信号和回调照样排队到所属线程）
+    QFuture<data::MessageFrame> login(const QString &username, const QString &passwordHash,
+                                      const QString &deviceInfo = "", const QString &appVersion = "");
     void logout();
     void autoLogin();
 
-    void saveSourceCode(const QString &codeId, const QString &language,
-                        const QString &sourceCode, const QString &codeName = "",
-                        const QString &description = "",
-                        const QMap<QString, QString> &metadata = {});
+    QFuture<data::MessageFrame> saveSourceCode(const QString &codeId, const QString &language,
+                                               const QString &sourceCode, const QString &codeName = "",
+                                               const QString &description = "",
+                                               const QMap<QString, QString> &metadata = {});
+
+    // 源码已是 UTF-8 字节（例如直接读自文件）时使用：内容被移动进请求帧，不做任何拷贝
+    QFuture<data::MessageFrame> saveSourceCodeUtf8(const QString &codeId, const QString &language,
+                                                   std::string &&sourceCode, const QString &codeName = "",
+                                                   const QString &description = "",
+                                                   const QMap<QString, QString> &metadata = {});
 
-    void compileSourceCode(const QString &codeId, const QString &compilerOptions = "",
-                           bool optimize = false, const QString &targetIrVersion = "");
+    QFuture<data::MessageFrame> compileSourceCode(const QString &codeId, const QString &compilerOptions = "",
+                                                  bool optimize = false, const QString &targetIrVersion = "");
 
-    void executeIrCode(const QString &irCodeId, data::ExecuteIRCodeRequest_ExecutionMode mode =
-                                                data::ExecuteIRCodeRequest_ExecutionMode_JIT,
-                       const QMap<QString, QString> &parameters = {}, uint32_t timeout = 30);
+    QFuture<data::MessageFrame> executeIrCode(const QString &irCodeId, data::ExecuteIRCodeRequest_ExecutionMode mode =
+                                                                       data::ExecuteIRCodeRequest_ExecutionMode_JIT,
+                                              const QMap<QString, QString> &parameters = {}, uint32_t timeout = 30);
+
+    // 源码到执行结果一次提交：save → compile → execute。默认三步合成一个 need_atomic 的 BatchRequest，
+    // 编译用的 code_id（codeId 为空时）和执行用的 ir_code_id 由服务端按前一步的结果填写，端到端一次往返加服务端处理时间。
+    // 服务端整体拒绝这个批次、或没有按原子批次执行（编译/执行因缺前一步的 id 而失败）时，本次调用从出问题的那一步
+    // 退回客户端串联，前一步的响应一到就发下一步；之后一分钟内的调用直接串联，过后再试原子批次。
+    // 不经过自动批量。各步的结果信号照常发出；future 以执行的响应完成，某一步失败时以该步的响应完成
+    QFuture<data::MessageFrame> runPipeline(const QString &codeId, const QString &language, const QString &sourceCode,
+                                            const QString &codeName = "", const QString &compilerOptions = "",
+                                            bool optimize = false, data::ExecuteIRCodeRequest_ExecutionMode mode =
+                                                                   data::ExecuteIRCodeRequest_ExecutionMode_JIT,
+                                            const QMap<QString, QString> &parameters = {}, uint32_t timeout = 30);
+
+    // 填好请求头（新 request_id、时间戳、类型、session 的 client_id，登录后带 auth_token）的空请求帧
+    static data::MessageFrame createBaseMessage(SessionContext &session, data::RequestType type);
+    // 使用 SessionManager 的默认会话
+    static data::MessageFrame createBaseMessage(data::RequestType type);
+
+    // 预编码请求：同一个请求反复发送时（例如用相同参数反复执行同一段 IR），
+    // 字符串转换和序列化只在准备时做一次，之后每次发送只拷贝模板并写入新的 request_id、时间戳和当前 auth_token。
+    // message 一般由 createBaseMessage 构造后填好请求体；请求头里的 request_id/timestamp/auth_token 会被忽略
+    PreparedRequest prepareRequest(const data::MessageFrame &message,
+                                   int timeoutMs = NetworkManager::kDefaultRequestTimeoutMs) const;
+    PreparedRequest prepareExecuteIrCode(const QString &irCodeId, data::ExecuteIRCodeRequest_ExecutionMode mode =
+                                                                  data::ExecuteIRCodeRequest_ExecutionMode_JIT,
+                                         const QMap<QString, QString> &parameters = {}, uint32_t timeout = 30) const;
+    // 行为同对应的 saveSourceCode/compileSourceCode/executeIrCode：结果信号照常发出，future 在响应到达时完成
+    QFuture<data::MessageFrame> sendPrepared(const PreparedRequest &request);
 
 signals:
     void connectionStateChanged(bool connected);
@@ -53,16 +126,54 @@ signals:
 private slots:
     void onMessageReceived(const data::MessageFrame &message);
     void onNetworkError(const QString &error);
+    void scheduleRenewal();
+    void renewSession();
     void onSessionExpired();
 
 private:
-    data::MessageFrame createBaseMessage(data::RequestType type) const;
+    struct PipelineRun;
+
+    // 开启批量时 save/compile/execute 请求交给 batcher()，message 被移走
+    QFuture<data::MessageFrame> sendTrackedRequest(data::MessageFrame &message,
+                                                   std::function<void(const QString &)> onFailure,
+                                                   int timeoutMs = NetworkManager::kDefaultRequestTimeoutMs);
+    QFuture<data::MessageFrame> sendSaveSourceRequest(data::MessageFrame &message,
+                                                      const QString &codeId, const QString &language,
+                                                      const QString &codeName, const QString &description,
+                                                      const QMap<QString, QString> &metadata);
+    static void fillSaveRequest(data::MessageFrame &message, const QString &codeId, const QString &language,
+                                const QString &codeName, const QString &description,
+                                const QMap<QString, QString> &metadata);
+    static void fillCompileRequest(data::MessageFrame &message, const QString &codeId, const QString &compilerOptions,
+                                   bool optimize, const QString &targetIrVersion);
+    static void fillExecuteRequest(data::MessageFrame &message, const QString &irCodeId,
+                                   data::ExecuteIRCodeRequest_ExecutionMode mode,
+                                   const QMap<QString, QString> &parameters, uint32_t timeout);
+    static int executeDeadlineMs(uint32_t timeout);
+    // 请求失败时发出与请求类型对应的结果信号
+    void emitRequestFailure(data::RequestType type, const QString &error);
+    // 按请求关联到的响应：错误转成对应请求的失败结果，其余照常分发
+    void deliverResponse(data::RequestType type, const data::MessageFrame &response);
+    void runAtomicPipeline(const std::shared_ptr<PipelineRun> &run);
+    // 原子批次没有生效：批次里 step 及之后的请求换回来，从 step 开始串联
+    void fallBackToChained(const std::shared_ptr<PipelineRun> &run, int step, const data::MessageFrame &response);
+    // 客户端串联：发出第 step 步（previousId 是前一步得到的 code_id / ir_code_id），成功后接着发下一步
+    void runPipelineStep(const std::shared_ptr<PipelineRun> &run, int step, const std::string &previousId);
     void handleLoginResponse(const data::LoginResponse &response);
     void handleErrorResponse(const data::ErrorResponse &response);
+    QString handleRequestError(const data::ErrorResponse &response);
     void handleNotification(const data::Notification &notification);
 
-    NetworkManager *m_networkManager;
+    ConnectionPool *m_connections;
+    // 为 false 时连接池是共用的，析构时不断开
+    bool m_ownsConnections;
+    SessionContext *m_session;
     QTimer *m_sessionCheckTimer;
+    std::unique_ptr<RequestBatcher> m_batcher;
+    // 共用的批量层（见 shareBatching），不归本对象所有
+    RequestBatcher *m_sharedBatcher;
+    // 原子流水线没有生效后，到这个时刻（毫秒）之前 runPipeline 直接串联
+    std::atomic<qint64> m_atomicRetryAtMs;
 };
 
 #endif // PROTOCLIENT_H
@@ -0,0 +1,48 @@
+#ifndef PROTOUTIL_H
+#define PROTOUTIL_H
+
+#include <QChar>
+#include <QStringEncoder>
+#include <QStringView>
+#include <string>
+
+// QString 与 protobuf 字符串字段之间的转换辅助函数
+
+// 计算 UTF-16 文本编码为 UTF-8 后的精确长度（孤立代理项按替换字符 3 字节计）
+inline qsizetype utf8Length(QStringView text)
+{
+    const char16_t *chars = text.utf16();
+    const qsizetype size = text.size();
+    qsizetype length = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const char16_t c = chars[i];
+        if (c < 0x80) {
+            length += 1;
+        } else if (c < 0x800) {
+            length += 2;
+        } else if (QChar::isHighSurrogate(c) && i + 1 < size && QChar::isLowSurrogate(chars[i + 1])) {
+            length += 4;
+            ++i;
+        } else {
+            length += 3;
+        }
+    }
+    return length;
+}
+
+// 把文本直接编码进目标字段：一次定长分配、一次编码，
+// 省掉 toStdString() 的中间 QByteArray 和之后 CopyFrom 的再次拷贝
+inline void assignUtf8(std::string *target, QStringView text)
+{
+    const qsizetype length = utf8Length(text);
+    target->resize(static_cast<size_t>(length));
+    if (length == 0) {
+        return;
+    }
+
+    QStringEncoder encoder(QStringEncoder::Utf8, QStringEncoder::Flag::Stateless);
+    char *end = encoder.appendToBuffer(target->data(), text);
+    target->resize(static_cast<size_t>(end - target->data()));
+}
+
+#endif // PROTOUTIL_H
@@ -0,0 +1,68 @@
+#include "randomdistribution.h"
+#include <QJsonObject>
+#include <cmath>
+
+namespace {
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+}
+
+bool RandomDistribution::parse(const QJsonValue &value, const QString &what, QString *error)
+{
+    kind = Kind::None;
+    first = 0;
+    second = 0;
+    if (value.isUndefined() || value.isNull()) {
+        return true;
+    }
+    if (value.isDouble()) {
+        first = value.toDouble();
+        kind = first > 0 ? Kind::Constant : Kind::None;
+        if (first < 0) {
+            setError(error, QString("%1不能为负数").arg(what));
+            return false;
+        }
+        return true;
+    }
+
+    const QJsonObject object = value.toObject();
+    const QString name = object.value("distribution").toString("constant").toLower();
+    if (name == "constant") {
+        kind = Kind::Constant;
+        first = object.value("value").toDouble();
+    } else if (name == "uniform") {
+        kind = Kind::Uniform;
+        first = object.value("min").toDouble();
+        second = object.value("max").toDouble();
+    } else if (name == "exponential") {
+        kind = Kind::Exponential;
+        first = object.value("mean").toDouble();
+    } else {
+        setError(error, QString("未知的%1分布: %2").arg(what, name));
+        return false;
+    }
+
+    if (first < 0 || (kind == Kind::Uniform && second < first)) {
+        setError(error, QString("%1范围无效").arg(what));
+        return false;
+    }
+    return true;
+}
+
+double RandomDistribution::sample(QRandomGenerator &random) const
+{
+    switch (kind) {
+    case Kind::Constant:
+        return first;
+    case Kind::Uniform:
+        return first + random.generateDouble() * (second - first);
+    case Kind::Exponential:
+        return -std::log(1.0 - random.generateDouble()) * first;
+    default:
+        return 0;
+    }
+}
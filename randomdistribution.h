@@ -0,0 +1,29 @@
+#ifndef RANDOMDISTRIBUTION_H
+#define RANDOMDISTRIBUTION_H
+
+#include <QJsonValue>
+#include <QRandomGenerator>
+#include <QString>
+
+// 配置文件里的随机时长（单位由使用方决定）。JSON 中写数字表示固定值，或写
+// {"distribution": "uniform", "min": 1, "max": 5} / {"distribution": "exponential", "mean": 2}
+// 压测的思考时间和模拟服务端的应答延迟共用这一份解析和采样
+struct RandomDistribution
+{
+    enum class Kind {
+        None,
+        Constant,
+        Uniform,
+        Exponential
+    };
+
+    Kind kind = Kind::None;
+    double first = 0;
+    double second = 0;
+
+    // what 是错误信息里的名称，例如 "延迟"、"思考时间"
+    bool parse(const QJsonValue &value, const QString &what, QString *error);
+    double sample(QRandomGenerator &random) const;
+};
+
+#endif // RANDOMDISTRIBUTION_H
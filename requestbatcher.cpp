@@ -0,0 +1,117 @@
+#include "requestbatcher.h"
+#include "protoclient.h"
+#include <QPromise>
+#include <QThread>
+#include <memory>
+
+RequestBatcher::RequestBatcher(ConnectionPool *connections, SessionContext *session, int maxRequests,
+                               int maxDelayUs)
+    : m_connections(connections)
+      , m_session(session)
+      , m_maxRequests(qMax(1, maxRequests))
+      , m_maxDelayUs(qMax(0, maxDelayUs))
+      , m_timerArmed(false)
+      , m_batchesSent(0)
+      , m_batchedRequests(0) {
+    m_entries.reserve(m_maxRequests);
+    m_delayTimer.setSingleShot(true);
+    m_delayTimer.setTimerType(Qt::PreciseTimer);
+    // 不足 1 毫秒的等待不向上取整到 1 毫秒，而是等到下一轮事件循环
+    m_delayTimer.setInterval(m_maxDelayUs < 1000 ? 0 : m_maxDelayUs / 1000);
+    QObject::connect(&m_delayTimer, &QTimer::timeout, [this]() {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_timerArmed = false;
+        }
+        flush();
+    });
+}
+
+RequestBatcher::~RequestBatcher() {
+    flush();
+}
+
+QFuture<data::MessageFrame> RequestBatcher::submit(data::MessageFrame &&request,
+                                                   NetworkManager::ResponseCallback callback, int timeoutMs) {
+    // 调用方的 future 要在批次发出前返回，由这里的 promise 在子请求完成时转交结果
+    auto promise = std::make_shared<QPromise<data::MessageFrame>>();
+    promise->start();
+    QFuture<data::MessageFrame> future = promise->future();
+
+    NetworkManager::BatchEntry entry;
+    entry.timeoutMs = timeoutMs;
+    entry.callback = [promise, callback = std::move(callback)](const data::MessageFrame &response) {
+        promise->addResult(response);
+        promise->finish();
+        if (callback) {
+            callback(response);
+        }
+    };
+
+    data::BatchRequest batch;
+    QVector<NetworkManager::BatchEntry> entries;
+    bool arm = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        *m_batch.add_sub_requests() = std::move(request);
+        m_entries.append(std::move(entry));
+        if (m_entries.size() >= m_maxRequests) {
+            // 攒满了，由提交方线程直接发出
+            batch.Swap(&m_batch);
+            entries.swap(m_entries);
+            m_entries.reserve(m_maxRequests);
+        } else if (!m_timerArmed) {
+            m_timerArmed = true;
+            arm = true;
+        }
+    }
+
+    if (!entries.isEmpty()) {
+        send(batch, entries);
+    } else if (arm) {
+        armTimer();
+    }
+    return future;
+}
+
+void RequestBatcher::flush() {
+    data::BatchRequest batch;
+    QVector<NetworkManager::BatchEntry> entries;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_entries.isEmpty()) {
+            return;
+        }
+        batch.Swap(&m_batch);
+        entries.swap(m_entries);
+        m_entries.reserve(m_maxRequests);
+    }
+    send(batch, entries);
+}
+
+void RequestBatcher::armTimer() {
+    // 定时器只能在所属线程启动，其他线程提交的请求转交过去。
+    // 定时器到期前本批已攒满发出时，到期后发出的是下一批，只会提前、不会超过等待上限
+    if (QThread::currentThread() != m_delayTimer.thread()) {
+        QMetaObject::invokeMethod(&m_delayTimer, [this]() {
+            m_delayTimer.start();
+        }, Qt::QueuedConnection);
+        return;
+    }
+    m_delayTimer.start();
+}
+
+void RequestBatcher::send(data::BatchRequest &batch, QVector<NetworkManager::BatchEntry> &entries) {
+    if (batch.sub_requests_size() == 1) {
+        // 只有一个请求时直接发送，不套批次
+        NetworkManager::BatchEntry &entry = entries.first();
+        m_connections->sendRequest(batch.sub_requests(0), std::move(entry.callback), entry.timeoutMs);
+        return;
+    }
+
+    data::MessageFrame frame = ProtoClient::createBaseMessage(*m_session, data::BATCH_REQUEST);
+    frame.mutable_batch()->Swap(&batch);
+    m_batchesSent.fetch_add(1, std::memory_order_relaxed);
+    m_batchedRequests.fetch_add(quint64(entries.size()), std::memory_order_relaxed);
+    m_connections->sendBatchRequest(frame, std::move(entries));
+}
@@ -0,0 +1,69 @@
+#ifndef REQUESTBATCHER_H
+#define REQUESTBATCHER_H
+
+#include <QFuture>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include "connectionpool.h"
+#include "networkmanager.h"
+#include "sessioncontext.h"
+#include "protoc/data_proto.pb.h"
+
+// 客户端自动批量：提交的请求先攒在内存里，满 maxRequests 个或最早的一个等了 maxDelayUs 微秒后，
+// 合成一个 BATCH_REQUEST 帧（need_atomic = false）发出，省掉逐帧的编码、入队和套接字写入开销。
+// 服务端对每个子请求单独应答，响应按各自的 request_id 回到提交方，和逐个发送时一样。
+// 等待时间由所属线程的定时器计时，精度是毫秒，不足 1 毫秒的按下一轮事件循环处理。
+// 批次帧被整体拒绝时（ERROR_RESPONSE 带批次帧的 request_id），其中的子请求都以这个错误失败。
+class RequestBatcher
+{
+public:
+    static constexpr int kDefaultMaxRequests = 64;
+    static constexpr int kDefaultMaxDelayUs = 200;
+
+    // connections 和 session 须比本对象活得久；批次帧的请求头用 session 填写。在 connections 所属线程构造
+    RequestBatcher(ConnectionPool *connections, SessionContext *session,
+                   int maxRequests = kDefaultMaxRequests, int maxDelayUs = kDefaultMaxDelayUs);
+    // 发出还没发的请求
+    ~RequestBatcher();
+
+    RequestBatcher(const RequestBatcher &) = delete;
+    RequestBatcher &operator=(const RequestBatcher &) = delete;
+
+    int maxRequests() const { return m_maxRequests; }
+    int maxDelayUs() const { return m_maxDelayUs; }
+
+    // 线程安全；request 的请求头须已填好（见 ProtoClient::createBaseMessage），内容被移进批次。
+    // future 和 callback 的语义同 ConnectionPool::sendRequest，截止时间从批次发出时算起
+    QFuture<data::MessageFrame> submit(data::MessageFrame &&request, NetworkManager::ResponseCallback callback = {},
+                                       int timeoutMs = NetworkManager::kDefaultRequestTimeoutMs);
+    // 线程安全；立即发出攒着的请求
+    void flush();
+
+    // 已发出的批次数和其中的子请求数（只有一个请求时直接发送，不计入）
+    quint64 batchesSent() const { return m_batchesSent.load(std::memory_order_relaxed); }
+    quint64 batchedRequests() const { return m_batchedRequests.load(std::memory_order_relaxed); }
+
+private:
+    void armTimer();
+    void send(data::BatchRequest &batch, QVector<NetworkManager::BatchEntry> &entries);
+
+    ConnectionPool *m_connections;
+    SessionContext *m_session;
+    const int m_maxRequests;
+    const int m_maxDelayUs;
+
+    QMutex m_mutex;
+    // 正在攒的批次：子请求直接放在 BatchRequest 里，发出时交换进批次帧，不再拷贝
+    data::BatchRequest m_batch;
+    QVector<NetworkManager::BatchEntry> m_entries;
+    // 本批是否已经启动了等待定时器
+    bool m_timerArmed;
+    QTimer m_delayTimer;
+
+    std::atomic<quint64> m_batchesSent;
+    std::atomic<quint64> m_batchedRequests;
+};
+
+#endif // REQUESTBATCHER_H
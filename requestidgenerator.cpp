@@ -0,0 +1,90 @@
+#include "requestidgenerator.h"
+#include <QRandomGenerator>
+#include <QUuid>
+
+namespace {
+constexpr int kCounterBits = 40;
+constexpr quint64 kCounterMask = (quint64(1) << kCounterBits) - 1;
+constexpr quint32 kPrefixCount = quint32(1) << (64 - kCounterBits);
+
+// 前缀的随机起点；进程内第 n 个生成器用 (起点 + n) mod 2^24，n 用完之前互不相同
+const quint32 s_prefixBase = QRandomGenerator::global()->generate();
+std::atomic<quint32> s_prefixesUsed{0};
+
+quint64 allocatePrefix() {
+    const quint32 index = s_prefixesUsed.fetch_add(1, std::memory_order_relaxed);
+    if (index >= kPrefixCount) {
+        // 回绕会让新旧生成器的 ID 撞在同一个在途表里，宁可停下
+        qFatal("RequestIdGenerator: request id prefixes exhausted");
+    }
+    return quint64((s_prefixBase + index) & (kPrefixCount - 1)) << kCounterBits;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+}
+
+RequestIdGenerator::RequestIdGenerator(RequestIdFormat format)
+    : m_format(format)
+      , m_prefix(allocatePrefix())
+      , m_counter(0) {
+}
+
+quint64 RequestIdGenerator::nextValue() {
+    // 计数从 1 开始，0 留给查找表作空槽标记
+    const quint64 counter = (m_counter.fetch_add(1, std::memory_order_relaxed) + 1) & kCounterMask;
+    return m_prefix | (counter != 0 ? counter : 1);
+}
+
+std::string RequestIdGenerator::next() {
+    if (format() == RequestIdFormat::Uuid) {
+        return QUuid::createUuid().toString(QUuid::WithoutBraces).toStdString();
+    }
+    return toString(nextValue());
+}
+
+void RequestIdGenerator::next(std::string *out) {
+    if (format() == RequestIdFormat::Uuid) {
+        *out = next();
+        return;
+    }
+    out->resize(size_t(kCompactSize));
+    format(nextValue(), out->data());
+}
+
+void RequestIdGenerator::format(quint64 id, char *out) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    for (int i = kCompactSize - 1; i >= 0; --i) {
+        out[i] = kDigits[id & 0xf];
+        id >>= 4;
+    }
+}
+
+std::string RequestIdGenerator::toString(quint64 id) {
+    std::string text(size_t(kCompactSize), '\0');
+    format(id, text.data());
+    return text;
+}
+
+bool RequestIdGenerator::parse(const std::string &text, quint64 *id) {
+    if (text.size() != size_t(kCompactSize)) {
+        return false;
+    }
+    quint64 value = 0;
+    for (char c : text) {
+        const int digit = hexValue(c);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | quint64(digit);
+    }
+    *id = value;
+    return true;
+}
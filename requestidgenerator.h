@@ -0,0 +1,50 @@
+#ifndef REQUESTIDGENERATOR_H
+#define REQUESTIDGENERATOR_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <string>
+
+// request_id 的格式：紧凑格式是 64 位整数（高 24 位是生成器前缀，低 40 位是递增计数），
+// 线上写成固定 16 位小写十六进制，收到响应时可以解析回整数查表；UUID 格式与旧版本客户端兼容
+enum class RequestIdFormat {
+    Compact,
+    Uuid
+};
+
+// 每个会话/连接一个生成器，进程内各生成器的前缀互不相同（起点随机，区分同时压测的多个客户端进程），
+// 不同生成器的 ID 可以混在同一个连接上；前缀用完（一个进程创建超过 2^24 个生成器）时直接终止，不回绕复用。
+// next() 和 setFormat() 线程安全，next() 只有一次原子自增，不分配内存。
+class RequestIdGenerator
+{
+public:
+    static constexpr int kCompactSize = 16;
+    static constexpr int kUuidSize = 36;
+
+    explicit RequestIdGenerator(RequestIdFormat format = RequestIdFormat::Compact);
+
+    RequestIdFormat format() const { return m_format.load(std::memory_order_relaxed); }
+    // 与 next() 并发时，正在进行的调用用切换前或切换后的格式，每个 ID 自身总是完整的一种格式
+    void setFormat(RequestIdFormat format) { m_format.store(format, std::memory_order_relaxed); }
+    // 本生成器产生的 request_id 长度（字节），两种格式都是定长
+    qsizetype size() const { return format() == RequestIdFormat::Compact ? kCompactSize : kUuidSize; }
+
+    // 紧凑格式的整数值，不会为 0
+    quint64 nextValue();
+    std::string next();
+    // 写进已有的字符串（例如请求头里的字段），复用其缓冲区
+    void next(std::string *out);
+
+    // out 至少 kCompactSize 字节，不写结尾的 '\0'
+    static void format(quint64 id, char *out);
+    static std::string toString(quint64 id);
+    // 不是紧凑格式（例如 UUID）时返回 false
+    static bool parse(const std::string &text, quint64 *id);
+
+private:
+    std::atomic<RequestIdFormat> m_format;
+    quint64 m_prefix;
+    std::atomic<quint64> m_counter;
+};
+
+#endif // REQUESTIDGENERATOR_H
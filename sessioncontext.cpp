@@ -0,0 +1,292 @@
+#include "sessioncontext.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace {
+// 读取方按线程登记（所有会话共用）：每个线程一个独占缓存行的槽位，读取期间写着进入时的全局纪元，不在读取时为 0。
+// 修改方替换版本后推进纪元，槽位里的纪元都比旧版本的替换纪元新（或为 0）时，旧版本就没有人在用了
+struct alignas(64) ReaderSlot
+{
+    std::atomic<quint64> epoch{0};
+    // 由 g_readerMutex 保护
+    bool inUse = false;
+};
+
+QMutex g_readerMutex;
+// 槽位只增不减，线程退出后留给新线程复用
+std::vector<std::unique_ptr<ReaderSlot>> g_readerSlots;
+std::atomic<quint64> g_epoch{1};
+
+struct ThreadReader
+{
+    ReaderSlot *slot = nullptr;
+    // 同一线程嵌套的快照（可以来自不同会话）只在最外层登记
+    int depth = 0;
+
+    ThreadReader()
+    {
+        QMutexLocker locker(&g_readerMutex);
+        for (const std::unique_ptr<ReaderSlot> &candidate : g_readerSlots) {
+            if (!candidate->inUse) {
+                slot = candidate.get();
+                break;
+            }
+        }
+        if (!slot) {
+            g_readerSlots.emplace_back(new ReaderSlot);
+            slot = g_readerSlots.back().get();
+        }
+        slot->inUse = true;
+    }
+
+    ~ThreadReader()
+    {
+        QMutexLocker locker(&g_readerMutex);
+        slot->inUse = false;
+    }
+};
+
+thread_local ThreadReader t_reader;
+
+// 正在读取的线程中最早的登记纪元；没有读取方时返回最大值
+quint64 oldestReaderEpoch()
+{
+    quint64 oldest = std::numeric_limits<quint64>::max();
+    QMutexLocker locker(&g_readerMutex);
+    for (const std::unique_ptr<ReaderSlot> &slot : g_readerSlots) {
+        const quint64 epoch = slot->epoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+}
+
+const std::string &SessionState::authTokenAt(qint64 nowMs) const
+{
+    static const std::string kNoToken;
+    return isLoggedInAt(nowMs) ? encodedToken : kNoToken;
+}
+
+SessionContext::Snapshot::Snapshot(const SessionContext *context)
+    : m_context(context)
+{
+    // 先登记纪元再读指针：修改方替换指针后再推进纪元，登记得比替换晚的读取方一定读到新版本
+    ThreadReader &reader = t_reader;
+    if (reader.depth++ == 0) {
+        reader.slot->epoch.store(g_epoch.load());
+    }
+    m_state = m_context->m_state.load();
+}
+
+SessionContext::Snapshot::Snapshot(Snapshot &&other) noexcept
+    : m_context(other.m_context)
+    , m_state(other.m_state)
+{
+    other.m_context = nullptr;
+}
+
+SessionContext::Snapshot::~Snapshot()
+{
+    if (m_context) {
+        ThreadReader &reader = t_reader;
+        if (--reader.depth == 0) {
+            reader.slot->epoch.store(0);
+        }
+    }
+}
+
+SessionContext::SessionContext(const QString &clientId, QObject *parent)
+    : QObject(parent)
+    , m_state(nullptr)
+    , m_renewing(false)
+{
+    auto *state = new SessionState;
+    state->clientId = clientId;
+    state->encodedClientId = clientId.toStdString();
+    m_state.store(state);
+}
+
+SessionContext::~SessionContext()
+{
+    delete m_state.load();
+    for (const Retired &retired : m_retired) {
+        delete retired.state;
+    }
+}
+
+template<typename Fn>
+void SessionContext::modify(Fn &&change)
+{
+    QMutexLocker locker(&m_writeMutex);
+    auto *next = new SessionState(*m_state.load());
+    change(*next);
+
+    next->encodedClientId = next->clientId.toStdString();
+    if (next->loggedIn) {
+        next->encodedToken = next->sessionId.toStdString();
+        next->tokenExpireMs = qint64(next->expireTime) * 1000;
+    } else {
+        next->encodedToken.clear();
+        next->tokenExpireMs = 0;
+    }
+
+    const SessionState *previous = m_state.exchange(next);
+    m_retired.push_back({previous, g_epoch.fetch_add(1)});
+    reclaim();
+}
+
+void SessionContext::reclaim()
+{
+    // 只回收替换之前进入的读取方都已离开的版本，其余留到下一次修改或析构。
+    // 读取方持有快照的时间很短，积压的旧版本不会超过修改时正在读取的那几个
+    const quint64 oldest = oldestReaderEpoch();
+    auto end = std::remove_if(m_retired.begin(), m_retired.end(), [oldest](const Retired &retired) {
+        if (retired.epoch >= oldest) {
+            return false;
+        }
+        delete retired.state;
+        return true;
+    });
+    m_retired.erase(end, m_retired.end());
+}
+
+SessionContext::Snapshot SessionContext::snapshot() const
+{
+    return Snapshot(this);
+}
+
+QString SessionContext::clientId() const
+{
+    return snapshot()->clientId;
+}
+
+void SessionContext::setClientId(const QString &clientId)
+{
+    modify([&clientId](SessionState &state) {
+        state.clientId = clientId;
+    });
+}
+
+std::string SessionContext::nextRequestId()
+{
+    return m_requestIds.next();
+}
+
+void SessionContext::nextRequestId(std::string *out)
+{
+    m_requestIds.next(out);
+}
+
+qsizetype SessionContext::requestIdSize() const
+{
+    return m_requestIds.size();
+}
+
+RequestIdFormat SessionContext::requestIdFormat() const
+{
+    return m_requestIds.format();
+}
+
+void SessionContext::setRequestIdFormat(RequestIdFormat format)
+{
+    m_requestIds.setFormat(format);
+}
+
+QString SessionContext::username() const
+{
+    return snapshot()->username;
+}
+
+QString SessionContext::passwordHash() const
+{
+    return snapshot()->passwordHash;
+}
+
+void SessionContext::setCredentials(const QString &username, const QString &passwordHash)
+{
+    modify([&](SessionState &state) {
+        state.username = username;
+        state.passwordHash = passwordHash;
+    });
+}
+
+bool SessionContext::isLoggedIn() const
+{
+    return snapshot()->isLoggedInAt(QDateTime::currentMSecsSinceEpoch());
+}
+
+QString SessionContext::sessionId() const
+{
+    return snapshot()->sessionId;
+}
+
+QString SessionContext::userNickname() const
+{
+    return snapshot()->userNickname;
+}
+
+quint32 SessionContext::userRole() const
+{
+    return snapshot()->userRole;
+}
+
+quint64 SessionContext::expireTime() const
+{
+    return snapshot()->expireTime;
+}
+
+void SessionContext::login(const data::LoginResponse &response)
+{
+    modify([&response](SessionState &state) {
+        state.sessionId = QString::fromStdString(response.session_id());
+        state.expireTime = response.expire_time();
+        state.userNickname = QString::fromStdString(response.user_nickname());
+        state.userRole = response.user_role();
+        state.loggedIn = response.success();
+    });
+
+    if (response.success()) {
+        emit sessionChanged();
+    }
+    emit loginStateChanged(response.success());
+}
+
+void SessionContext::logout()
+{
+    modify([](SessionState &state) {
+        state.sessionId.clear();
+        state.userNickname.clear();
+        state.userRole = 0;
+        state.expireTime = 0;
+        state.loggedIn = false;
+    });
+
+    emit sessionChanged();
+    emit loginStateChanged(false);
+}
+
+void SessionContext::updateSession(const QString &newSessionId, quint64 newExpireTime)
+{
+    // token 和过期时间在同一个新版本里一起生效
+    modify([&](SessionState &state) {
+        state.sessionId = newSessionId;
+        state.expireTime = newExpireTime;
+    });
+    emit sessionChanged();
+}
+
+bool SessionContext::beginRenewal()
+{
+    bool expected = false;
+    return m_renewing.compare_exchange_strong(expected, true);
+}
+
+void SessionContext::endRenewal()
+{
+    m_renewing.store(false);
+}
@@ -0,0 +1,133 @@
+#ifndef SESSIONCONTEXT_H
+#define SESSIONCONTEXT_H
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "requestidgenerator.h"
+#include "protoc/data_proto.pb.h"
+
+// 会话状态的一个不可变版本。每次修改都发布一份新的，读到的 token 和过期时间总是同一次修改的结果
+struct SessionState
+{
+    QString clientId;
+    QString username;
+    QString passwordHash;
+    QString sessionId;
+    QString userNickname;
+    quint32 userRole = 0;
+    // 秒级时间戳
+    quint64 expireTime = 0;
+    bool loggedIn = false;
+
+    // 请求头里不随请求变化的部分，预先编码成 UTF-8，构造请求头时直接拷贝
+    std::string encodedClientId;
+    std::string encodedToken;
+    // token 有效期截止（毫秒）；未登录时为 0
+    qint64 tokenExpireMs = 0;
+
+    bool isLoggedInAt(qint64 nowMs) const { return nowMs < tokenExpireMs; }
+    // nowMs 时会话有效则返回 auth_token，否则返回空串
+    const std::string &authTokenAt(qint64 nowMs) const;
+};
+
+// 一个用户（或一个连接）的会话状态：client_id、登录得到的 session id 和过期时间等。
+// 每个虚拟用户各持有一个，互不影响；界面程序使用的是 SessionManager 包装的默认会话。
+// 状态以 RCU 方式发布：读取方（可以是任意多个发送线程）通过 snapshot() 拿到当前版本，不加锁，
+// 只在本线程自己的登记槽里写下进入时的纪元，线程之间不共享可写的缓存行；
+// 修改方复制当前版本、改好后原子替换指针，旧版本等到替换之前进入的读取方都离开后回收。修改和信号在所属线程进行。
+class SessionContext : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 持有期间对应的版本不会被回收；只在栈上短暂持有，不要跨事件循环保存
+    class Snapshot
+    {
+    public:
+        Snapshot(Snapshot &&other) noexcept;
+        ~Snapshot();
+        Snapshot(const Snapshot &) = delete;
+        Snapshot &operator=(const Snapshot &) = delete;
+        Snapshot &operator=(Snapshot &&) = delete;
+
+        const SessionState *operator->() const { return m_state; }
+        const SessionState &operator*() const { return *m_state; }
+
+    private:
+        friend class SessionContext;
+        explicit Snapshot(const SessionContext *context);
+
+        const SessionContext *m_context;
+        const SessionState *m_state;
+    };
+
+    explicit SessionContext(const QString &clientId = "ProtoClientTester", QObject *parent = nullptr);
+    ~SessionContext();
+
+    // 线程安全，不加锁
+    Snapshot snapshot() const;
+
+    // 写在每个请求头里的 client_id
+    QString clientId() const;
+    void setClientId(const QString &clientId);
+
+    // 本会话请求的 request_id；默认紧凑格式，与只认 UUID 的服务端对接时切换为 Uuid。可以在多个线程中同时调用
+    std::string nextRequestId();
+    void nextRequestId(std::string *out);
+    qsizetype requestIdSize() const;
+    RequestIdFormat requestIdFormat() const;
+    void setRequestIdFormat(RequestIdFormat format);
+
+    // 登录用的账号，会话过期后重新登录时使用
+    QString username() const;
+    QString passwordHash() const;
+    void setCredentials(const QString &username, const QString &passwordHash);
+
+    // 以下读取方法各取一次快照；需要多个字段互相一致时直接使用 snapshot()
+    bool isLoggedIn() const;
+    QString sessionId() const;
+    QString userNickname() const;
+    quint32 userRole() const;
+    // 秒级时间戳
+    quint64 expireTime() const;
+
+    void login(const data::LoginResponse &response);
+    void logout();
+    void updateSession(const QString &newSessionId, quint64 newExpireTime);
+
+    // 多个客户端共用一个会话时只让一个去续期：已有续期在进行时返回 false。线程安全
+    bool beginRenewal();
+    void endRenewal();
+
+signals:
+    void loginStateChanged(bool loggedIn);
+    // 登录、续期或登出后发出，供需要持久化的一方保存
+    void sessionChanged();
+
+private:
+    // 在 m_writeMutex 保护下复制当前版本，交给 change 修改后发布
+    template<typename Fn>
+    void modify(Fn &&change);
+    void reclaim();
+
+    struct Retired
+    {
+        const SessionState *state;
+        // 替换时的纪元：登记纪元不大于它的读取方可能还拿着这个版本
+        quint64 epoch;
+    };
+
+    RequestIdGenerator m_requestIds;
+    std::atomic<const SessionState *> m_state;
+    std::atomic<bool> m_renewing;
+    // 串行化修改方，保护 m_retired
+    QMutex m_writeMutex;
+    // 已被替换、可能仍有读取方在用的旧版本
+    std::vector<Retired> m_retired;
+};
+
+#endif // SESSIONCONTEXT_H
@@ -7,10 +7,10 @@
 SessionManager::SessionManager(QObject *parent)
     : QObject(parent)
     , m_settings("YourCompany", "ProtoClientTester")
-    , m_userRole(0)
-    , m_expireTime(0)
-    , m_loggedIn(false)
+    , m_context("ProtoClientTester")
 {
+    connect(&m_context, &SessionContext::sessionChanged, this, &SessionManager::persistSession);
+    connect(&m_context, &SessionContext::loginStateChanged, this, &SessionManager::loginStateChanged);
 }
 
 SessionManager::~SessionManager()
@@ -23,80 +23,75 @@ SessionManager& SessionManager::instance()
     return instance;
 }
 
+SessionContext &SessionManager::defaultContext()
+{
+    return m_context;
+}
+
 bool SessionManager::isLoggedIn() const
 {
-    return m_loggedIn && QDateTime::currentSecsSinceEpoch() < m_expireTime;
+    return m_context.isLoggedIn();
 }
 
 QString SessionManager::sessionId() const
 {
-    return m_sessionId;
+    return m_context.sessionId();
 }
 
 QString SessionManager::username() const
 {
-    return m_username;
+    return m_context.username();
 }
 
 QString SessionManager::userNickname() const
 {
-    return m_userNickname;
+    return m_context.userNickname();
 }
 
 quint32 SessionManager::userRole() const
 {
-    return m_userRole;
+    return m_context.userRole();
 }
 
 quint64 SessionManager::expireTime() const
 {
-    return m_expireTime;
+    return m_context.expireTime();
 }
 
 void SessionManager::login(const data::LoginResponse &response)
 {
-    m_sessionId = QString::fromStdString(response.session_id());
-    m_expireTime = response.expire_time();
-    m_userNickname = QString::fromStdString(response.user_nickname());
-    m_userRole = response.user_role();
-    m_loggedIn = response.success();
-
-    if (m_loggedIn) {
-        m_settings.setValue("session/id", m_sessionId);
-        // 修复：显式转换为 qlonglong
-        m_settings.setValue("session/expire", QVariant::fromValue<qlonglong>(static_cast<qlonglong>(m_expireTime)));
-        m_settings.setValue("user/nickname", m_userNickname);
-        m_settings.setValue("user/role", static_cast<uint>(m_userRole));
-    }
-
-    emit loginStateChanged(m_loggedIn);
+    m_context.login(response);
 }
 
 void SessionManager::logout()
 {
-    m_sessionId.clear();
-    m_username.clear();
-    m_userNickname.clear();
-    m_userRole = 0;
-    m_expireTime = 0;
-    m_loggedIn = false;
-
-    m_settings.remove("session/id");
-    m_settings.remove("session/expire");
-    m_settings.remove("user/nickname");
-    m_settings.remove("user/role");
-
-    emit loginStateChanged(false);
+    m_context.logout();
 }
 
 void SessionManager::updateSession(const QString &newSessionId, quint64 newExpireTime)
 {
-    m_sessionId = newSessionId;
-    m_expireTime = newExpireTime;
+    m_context.updateSession(newSessionId, newExpireTime);
+}
 
-    m_settings.setValue("session/id", m_sessionId);
+void SessionManager::persistSession()
+{
+    // 同一个快照里取各字段，保存的 session id 和过期时间是配套的
+    const SessionContext::Snapshot state = m_context.snapshot();
+
+    // 登出后 session id 为空，清掉保存的会话
+    if (state->sessionId.isEmpty()) {
+        m_settings.remove("session/id");
+        m_settings.remove("session/expire");
+        m_settings.remove("user/nickname");
+        m_settings.remove("user/role");
+        return;
+    }
+
+    m_settings.setValue("session/id", state->sessionId);
     // 修复：显式转换为 qlonglong
-    m_settings.setValue("session/expire", QVariant::fromValue<qlonglong>(static_cast<qlonglong>(m_expireTime)));
+    m_settings.setValue("session/expire", QVariant::fromValue<qlonglong>(static_cast<qlonglong>(state->expireTime)));
+    m_settings.setValue("user/nickname", state->userNickname);
+    m_settings.setValue("user/role", static_cast<uint>(state->userRole));
 }
 
 void SessionManager::saveCredentials(const QString &username, const QString &passwordHash)
@@ -106,7 +101,6 @@ void SessionManager::saveCredentials(const QString &username, const QString &pas
 
     m_settings.setValue("auth/username", username);
     m_settings.setValue("auth/password", QString::fromUtf8(encrypted));
-    m_settings.sync();
 }
 
 bool SessionManager::loadCredentials(QString &username, QString &passwordHash)
@@ -129,6 +123,11 @@ void SessionManager::clearCredentials()
     m_settings.remove("auth/password");
 }
 
+void SessionManager::flush()
+{
+    m_settings.flush();
+}
+
 QString SessionManager::generateRequestId() const
 {
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
@@ -3,10 +3,14 @@
 
 #include <QObject>
 #include <QString>
-#include <QSettings>
 #include <QVariant>
+#include "sessioncontext.h"
+#include "settingswriter.h"
 #include "protoc/data_proto.pb.h"
 
+// 进程级的默认会话：包装一个 SessionContext，并把它的登录状态和保存的账号持久化到 QSettings。
+// 持久化是后写的（见 SettingsWriter）：登录、续期和保存账号都不在调用线程做文件 I/O。
+// 界面和单用户场景使用它；需要模拟多个用户时，每个虚拟用户持有自己的 SessionContext。
 class SessionManager : public QObject
 {
     Q_OBJECT
@@ -14,6 +18,8 @@ class SessionManager : public QObject
 public:
     static SessionManager& instance();
 
+    SessionContext &defaultContext();
+
     bool isLoggedIn() const;
     QString sessionId() const;
     QString username() const;
@@ -28,7 +34,10 @@ public:
     void saveCredentials(const QString &username, const QString &passwordHash);
     bool loadCredentials(QString &username, QString &passwordHash);
     void clearCredentials();
+    // 阻塞到会话和账号都已写入磁盘，例如退出前
+    void flush();
 
+    // UUID 格式的 request_id；请求头里使用的是各会话自己的 SessionContext::nextRequestId
     QString generateRequestId() const;
 
 signals:
@@ -39,13 +48,10 @@ private:
     explicit SessionManager(QObject *parent = nullptr);
     ~SessionManager();
 
-    QSettings m_settings;
-    QString m_sessionId;
-    QString m_username;
-    QString m_userNickname;
-    quint32 m_userRole;    // 改为 quint32
-    quint64 m_expireTime;  // 改为 quint64
-    bool m_loggedIn;
+    void persistSession();
+
+    SettingsWriter m_settings;
+    SessionContext m_context;
 };
 
 #endif // SESSIONMANAGER_H
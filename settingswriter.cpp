@@ -0,0 +1,100 @@
+#include "settingswriter.h"
+#include <QDebug>
+
+SettingsWriter::SettingsWriter(const QString &organization, const QString &application, int flushIntervalMs)
+    : m_scheduled(false)
+      , m_writer(new QObject)
+      , m_settings(new QSettings(organization, application, m_writer))
+      , m_flushTimer(new QTimer(m_writer))
+      , m_reader(organization, application) {
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(flushIntervalMs);
+    QObject::connect(m_flushTimer, &QTimer::timeout, m_writer, [this]() {
+        writePending();
+    });
+
+    m_thread.setObjectName("SettingsWriter");
+    m_writer->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+SettingsWriter::~SettingsWriter() {
+    // 可能在 QCoreApplication 销毁之后析构（静态单例），先停线程，剩下的修改在当前线程写出
+    m_thread.quit();
+    m_thread.wait();
+    writePending();
+    delete m_writer;
+}
+
+void SettingsWriter::setValue(const QString &key, const QVariant &value) {
+    QMutexLocker locker(&m_mutex);
+    m_pending.insert(key, value);
+    schedule();
+}
+
+void SettingsWriter::remove(const QString &key) {
+    QMutexLocker locker(&m_mutex);
+    m_pending.insert(key, QVariant());
+    schedule();
+}
+
+QVariant SettingsWriter::value(const QString &key, const QVariant &defaultValue) const {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_pending.constFind(key);
+    if (it == m_pending.constEnd()) {
+        it = m_writing.constFind(key);
+        if (it == m_writing.constEnd()) {
+            return m_reader.value(key, defaultValue);
+        }
+    }
+    return it->isValid() ? *it : defaultValue;
+}
+
+void SettingsWriter::flush() {
+    if (!m_thread.isRunning()) {
+        writePending();
+        return;
+    }
+    QMetaObject::invokeMethod(m_writer, [this]() {
+        m_flushTimer->stop();
+        writePending();
+    }, Qt::BlockingQueuedConnection);
+}
+
+void SettingsWriter::schedule() {
+    // 调用方已持有 m_mutex。一轮合并只启动一次定时器
+    if (m_scheduled) {
+        return;
+    }
+    m_scheduled = true;
+    QMetaObject::invokeMethod(m_flushTimer, [this]() {
+        m_flushTimer->start();
+    }, Qt::QueuedConnection);
+}
+
+void SettingsWriter::writePending() {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pending.isEmpty()) {
+            m_scheduled = false;
+            return;
+        }
+        m_writing.swap(m_pending);
+        m_scheduled = false;
+    }
+
+    for (auto it = m_writing.constBegin(); it != m_writing.constEnd(); ++it) {
+        if (it->isValid()) {
+            m_settings->setValue(it.key(), *it);
+        } else {
+            m_settings->remove(it.key());
+        }
+    }
+    m_settings->sync();
+    if (m_settings->status() != QSettings::NoError) {
+        qWarning() << "Failed to write settings:" << m_settings->fileName();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_writing.clear();
+}
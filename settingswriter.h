@@ -0,0 +1,53 @@
+#ifndef SETTINGSWRITER_H
+#define SETTINGSWRITER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSettings>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+
+// QSettings 的后写层：setValue()/remove() 只改内存里的待写表就返回，同一个键的多次修改合并成最后一次，
+// 由独立线程在第一次修改后 flushIntervalMs 内统一写入并 sync，调用线程不碰磁盘。
+// value() 先查还没落盘的修改，内存中的状态始终是权威的。
+class SettingsWriter
+{
+public:
+    SettingsWriter(const QString &organization, const QString &application, int flushIntervalMs = 1000);
+    ~SettingsWriter();
+
+    SettingsWriter(const SettingsWriter &) = delete;
+    SettingsWriter &operator=(const SettingsWriter &) = delete;
+
+    // 以下方法线程安全
+    void setValue(const QString &key, const QVariant &value);
+    void remove(const QString &key);
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+
+    // 阻塞到目前为止的修改都已写入磁盘；析构时自动调用
+    void flush();
+
+private:
+    void schedule();
+    // 在写线程执行
+    void writePending();
+
+    mutable QMutex m_mutex;
+    // 还没开始写的修改；无效的 QVariant 表示删除
+    QHash<QString, QVariant> m_pending;
+    // 正在写入的修改，写完前 value() 仍从这里读
+    QHash<QString, QVariant> m_writing;
+    bool m_scheduled;
+
+    QThread m_thread;
+    QObject *m_writer;
+    // 只在写线程使用
+    QSettings *m_settings;
+    QTimer *m_flushTimer;
+    // 落盘后的值从这里读；同一进程里指向同一文件的 QSettings 共享缓存
+    QSettings m_reader;
+};
+
+#endif // SETTINGSWRITER_H
@@ -0,0 +1,91 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// 有界单生产者单消费者无锁队列。
+// tryPush() 只能由生产者线程调用，tryPop() 只能由消费者线程调用；
+// 容量向上取整为 2 的幂，队列满/空时立即返回 false，不阻塞。
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : m_capacity(roundUpToPowerOfTwo(capacity))
+        , m_mask(m_capacity - 1)
+        , m_slots(new T[m_capacity])
+    {
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    bool tryPush(T &&value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead >= m_capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead >= m_capacity) {
+                return false;
+            }
+        }
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅供生产者判断是否需要暂停生产
+    bool isFull() const
+    {
+        return m_tail.load(std::memory_order_relaxed)
+               - m_head.load(std::memory_order_acquire) >= m_capacity;
+    }
+
+    size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<T[]> m_slots;
+
+    // 消费者写 m_head，生产者写 m_tail，分开放在不同缓存行上避免伪共享
+    alignas(kCacheLine) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    alignas(kCacheLine) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,92 @@
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(qint64 tickMs, qint64 startMs)
+    : m_tickMs(qMax<qint64>(1, tickMs))
+      , m_startMs(startMs)
+      , m_currentTick(0)
+      , m_count(0) {
+    for (auto &level : m_slots) {
+        for (Node &head : level) {
+            head.prev = &head;
+            head.next = &head;
+        }
+    }
+}
+
+void TimingWheel::schedule(Node *node, qint64 deadlineMs) {
+    if (node->isScheduled()) {
+        cancel(node);
+    }
+
+    // 截止时间向上取整到 tick，保证不会提前触发
+    const qint64 offset = qMax<qint64>(0, deadlineMs - m_startMs);
+    const quint64 tick = static_cast<quint64>((offset + m_tickMs - 1) / m_tickMs);
+    node->tick = qMax(tick, m_currentTick + 1);
+
+    insert(node);
+    ++m_count;
+}
+
+void TimingWheel::cancel(Node *node) {
+    if (!node->isScheduled()) {
+        return;
+    }
+    unlink(node);
+    --m_count;
+}
+
+quint64 TimingWheel::tickFor(qint64 ms) const {
+    return ms <= m_startMs ? 0 : static_cast<quint64>((ms - m_startMs) / m_tickMs);
+}
+
+void TimingWheel::insert(Node *node) {
+    constexpr quint64 kMaxDelta = (quint64(1) << (kSlotBits * kLevels)) - 1;
+
+    // 超出最高层范围的截止时间先按最大跨度挂在最高层，node->tick 保持不变，
+    // 转到那个槽时 cascade 按真实的剩余时间重新放置（可能再次挂回最高层）
+    quint64 slotTick = node->tick;
+    quint64 delta = node->tick - m_currentTick;
+    if (delta > kMaxDelta) {
+        slotTick = m_currentTick + kMaxDelta;
+        delta = kMaxDelta;
+    }
+
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (quint64(1) << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+
+    const int index = static_cast<int>((slotTick >> (kSlotBits * level)) & (kSlots - 1));
+    link(&m_slots[level][index], node);
+}
+
+void TimingWheel::cascade(int level) {
+    const int index = static_cast<int>((m_currentTick >> (kSlotBits * level)) & (kSlots - 1));
+    Node *head = &m_slots[level][index];
+
+    // 先把整条链表摘下来，再按剩余时间重新放回更低的层
+    Node *node = head->next;
+    head->prev = head;
+    head->next = head;
+    while (node != head) {
+        Node *next = node->next;
+        node->prev = nullptr;
+        node->next = nullptr;
+        insert(node);
+        node = next;
+    }
+}
+
+void TimingWheel::link(Node *head, Node *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::unlink(Node *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+}
@@ -0,0 +1,97 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QtGlobal>
+
+// 分层哈希时间轮：4 层 x 64 槽，每层粒度是下一层的 64 倍。
+// 定时器是侵入式双向链表节点，schedule/cancel 都是 O(1)；
+// 每个 tick 只处理第 0 层的一个槽，高层槽每 64 个 tick 才下放一次，与在途定时器数量无关。
+// 本身不加锁，由使用方串行访问。
+class TimingWheel
+{
+public:
+    struct Node
+    {
+        Node() = default;
+        // 拷贝/移动得到的都是未挂入时间轮的新节点
+        Node(const Node &) {}
+        Node &operator=(const Node &) { return *this; }
+
+        bool isScheduled() const { return prev != nullptr; }
+
+        Node *prev = nullptr;
+        Node *next = nullptr;
+        quint64 tick = 0;
+    };
+
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 6;
+    static constexpr int kSlots = 1 << kSlotBits;
+
+    explicit TimingWheel(qint64 tickMs = 10, qint64 startMs = 0);
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel &operator=(const TimingWheel &) = delete;
+
+    // deadlineMs 与 advance() 使用同一时钟；已经过期的截止时间在下一个 tick 触发。
+    // 超出四层总跨度的截止时间先挂在最高层，每转到一次重新计算，最终仍按原截止时间触发
+    void schedule(Node *node, qint64 deadlineMs);
+    void cancel(Node *node);
+
+    // 推进到 nowMs，对每个到期节点调用 onExpired(Node *)；回调时节点已摘下，可以重新 schedule
+    template<typename Fn>
+    void advance(qint64 nowMs, Fn &&onExpired);
+
+    qint64 tickMs() const { return m_tickMs; }
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+
+private:
+    quint64 tickFor(qint64 ms) const;
+    void insert(Node *node);
+    void cascade(int level);
+    static void link(Node *head, Node *node);
+    static void unlink(Node *node);
+
+    Node m_slots[kLevels][kSlots];
+    qint64 m_tickMs;
+    qint64 m_startMs;
+    quint64 m_currentTick;
+    int m_count;
+};
+
+template<typename Fn>
+void TimingWheel::advance(qint64 nowMs, Fn &&onExpired)
+{
+    const quint64 target = tickFor(nowMs);
+    if (m_count == 0) {
+        // 没有定时器时直接跳到目标 tick，空闲之后的第一次推进不空转
+        m_currentTick = qMax(m_currentTick, target);
+        return;
+    }
+    while (m_currentTick < target) {
+        ++m_currentTick;
+
+        // 第 0 层转完一圈时，把上一层对应槽的定时器下放
+        for (int level = 1; level < kLevels; ++level) {
+            if ((m_currentTick >> (kSlotBits * (level - 1))) & (kSlots - 1)) {
+                break;
+            }
+            cascade(level);
+        }
+
+        Node *head = &m_slots[0][m_currentTick & (kSlots - 1)];
+        while (head->next != head) {
+            Node *node = head->next;
+            unlink(node);
+            --m_count;
+            onExpired(node);
+        }
+
+        if (m_count == 0) {
+            // 没有定时器时直接跳到目标 tick，空闲期间不空转
+            m_currentTick = target;
+        }
+    }
+}
+
+#endif // TIMINGWHEEL_H
@@ -0,0 +1,198 @@
+#include "trafficcapture.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+// 本地块的大小和最长攒批时间
+constexpr qsizetype kChunkSize = 256 * 1024;
+constexpr qint64 kChunkMaxAgeNs = 100LL * 1000 * 1000;
+// 等待写盘的数据超过该值时丢弃新块
+constexpr qint64 kMaxQueuedBytes = 64 * 1024 * 1024;
+}
+
+TrafficCapture::TrafficCapture()
+    : m_writer(new QObject)
+      , m_file(new QFile(m_writer))
+      , m_open(false)
+      , m_queuedBytes(0)
+      , m_bytesWritten(0)
+      , m_droppedChunks(0) {
+    m_thread.setObjectName("TrafficCapture");
+    m_writer->moveToThread(&m_thread);
+    m_clock.start();
+}
+
+TrafficCapture::~TrafficCapture() {
+    close();
+    delete m_writer;
+}
+
+bool TrafficCapture::open(const QString &path, QString *error) {
+    close();
+
+    m_file->setFileName(path);
+    if (!m_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) {
+            *error = QString("无法写入抓包文件 %1: %2").arg(path, m_file->errorString());
+        }
+        return false;
+    }
+
+    char header[kFileHeaderSize];
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 8);
+    m_file->write(header, kFileHeaderSize);
+
+    m_clock.restart();
+    m_bytesWritten.store(kFileHeaderSize, std::memory_order_relaxed);
+    m_droppedChunks.store(0, std::memory_order_relaxed);
+    m_thread.start();
+    m_open.store(true, std::memory_order_release);
+    return true;
+}
+
+void TrafficCapture::close() {
+    if (!m_open.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    // 投递事件按顺序处理：这个空调用返回时，之前提交的块都已写入
+    QMetaObject::invokeMethod(m_writer, []() {}, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    m_file->close();
+}
+
+void TrafficCapture::submit(QByteArray &&chunk) {
+    if (chunk.isEmpty() || !isOpen()) {
+        return;
+    }
+    const qint64 size = chunk.size();
+    if (m_queuedBytes.fetch_add(size, std::memory_order_relaxed) + size > kMaxQueuedBytes) {
+        m_queuedBytes.fetch_sub(size, std::memory_order_relaxed);
+        m_droppedChunks.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    QMetaObject::invokeMethod(m_writer, [this, chunk = std::move(chunk)]() {
+        writeChunk(chunk);
+    }, Qt::QueuedConnection);
+}
+
+void TrafficCapture::writeChunk(const QByteArray &chunk) {
+    const qint64 written = m_file->write(chunk);
+    m_queuedBytes.fetch_sub(chunk.size(), std::memory_order_relaxed);
+    if (written != chunk.size()) {
+        qWarning() << "Failed to write capture:" << m_file->errorString();
+        m_droppedChunks.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_bytesWritten.fetch_add(quint64(written), std::memory_order_relaxed);
+}
+
+void CaptureBuffer::attach(std::shared_ptr<TrafficCapture> capture, quint16 stream) {
+    detach();
+    m_capture = std::move(capture);
+    m_stream = stream;
+}
+
+void CaptureBuffer::detach() {
+    flush();
+    m_capture.reset();
+    m_chunk = QByteArray();
+}
+
+void CaptureBuffer::record(CaptureDirection direction, const char *data, quint32 size) {
+    if (!m_capture) {
+        return;
+    }
+
+    const qint64 now = m_capture->nowNs();
+    if (m_chunk.isEmpty()) {
+        m_chunk.reserve(qMax(kChunkSize, qsizetype(size) + TrafficCapture::kRecordHeaderSize));
+        m_chunkStartNs = now;
+    }
+
+    const qsizetype offset = m_chunk.size();
+    m_chunk.resize(offset + TrafficCapture::kRecordHeaderSize + size);
+    char *out = m_chunk.data() + offset;
+    qToLittleEndian<quint32>(size, out);
+    out[4] = char(direction);
+    out[5] = 0;
+    qToLittleEndian<quint16>(m_stream, out + 6);
+    qToLittleEndian<qint64>(now, out + 8);
+    std::memcpy(out + TrafficCapture::kRecordHeaderSize, data, size);
+
+    if (m_chunk.size() >= kChunkSize || now - m_chunkStartNs >= kChunkMaxAgeNs) {
+        flush();
+    }
+}
+
+void CaptureBuffer::flush() {
+    if (m_capture && !m_chunk.isEmpty()) {
+        m_capture->submit(std::move(m_chunk));
+    }
+    m_chunk = QByteArray();
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const QString &path, QString *error) {
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("无法打开抓包文件 %1: %2").arg(path, m_file.errorString());
+        }
+        return false;
+    }
+    m_size = m_file.size();
+    m_data = m_size >= TrafficCapture::kFileHeaderSize ? m_file.map(0, m_size) : nullptr;
+    if (!m_data || std::memcmp(m_data, TrafficCapture::kMagic, sizeof(TrafficCapture::kMagic)) != 0) {
+        if (error) {
+            *error = QString("不是抓包文件: %1").arg(path);
+        }
+        close();
+        return false;
+    }
+
+    m_startTimeMsecs = qFromLittleEndian<qint64>(m_data + 8);
+    rewind();
+    return true;
+}
+
+void CaptureReader::close() {
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_size = 0;
+    m_pos = 0;
+    m_truncated = false;
+}
+
+bool CaptureReader::next(CaptureRecord &record) {
+    if (!m_data || m_pos + TrafficCapture::kRecordHeaderSize > m_size) {
+        m_truncated = m_data && m_pos < m_size;
+        return false;
+    }
+
+    const uchar *header = m_data + m_pos;
+    const quint32 size = qFromLittleEndian<quint32>(header);
+    if (m_pos + TrafficCapture::kRecordHeaderSize + qint64(size) > m_size) {
+        m_truncated = true;
+        return false;
+    }
+
+    record.direction = CaptureDirection(header[4]);
+    record.stream = qFromLittleEndian<quint16>(header + 6);
+    record.timestampNs = qFromLittleEndian<qint64>(header + 8);
+    record.data = reinterpret_cast<const char *>(header + TrafficCapture::kRecordHeaderSize);
+    record.size = size;
+    m_pos += TrafficCapture::kRecordHeaderSize + size;
+    return true;
+}
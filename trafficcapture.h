@@ -0,0 +1,124 @@
+#ifndef TRAFFICCAPTURE_H
+#define TRAFFICCAPTURE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QThread>
+#include <atomic>
+#include <memory>
+
+// 抓包文件格式（小端，只追加）：
+//   文件头 16 字节：magic "PCTCAP" 0x00 0x01 | 抓包开始时的墙上时间（毫秒，i64）
+//   每条记录：u32 负载长度 | u8 方向 | u8 保留 | u16 连接号 | i64 单调时钟（纳秒，相对抓包开始）| 负载
+// 负载是 MessageFrame 的序列化字节，不含网络上的长度前缀。读取端用 QFile::map() 整体映射后顺序遍历。
+// 多个连接写同一个文件时记录按块交错，块内按时间排序，块之间不保证（CaptureReader 的使用方按时间戳排序）。
+
+enum class CaptureDirection : quint8 {
+    Inbound = 0,
+    Outbound = 1
+};
+
+// 抓包文件的写端：各连接把攒好的记录块交过来，由独立线程写盘，I/O 线程不碰磁盘。
+// 写盘跟不上时丢弃整块并计数，不会让网络收发变慢或内存无限增长。
+class TrafficCapture
+{
+public:
+    static constexpr qsizetype kFileHeaderSize = 16;
+    static constexpr qsizetype kRecordHeaderSize = 16;
+    static constexpr char kMagic[8] = {'P', 'C', 'T', 'C', 'A', 'P', 0x00, 0x01};
+
+    TrafficCapture();
+    ~TrafficCapture();
+
+    TrafficCapture(const TrafficCapture &) = delete;
+    TrafficCapture &operator=(const TrafficCapture &) = delete;
+
+    bool open(const QString &path, QString *error = nullptr);
+    // 写完已提交的块后关闭文件
+    void close();
+    bool isOpen() const { return m_open.load(std::memory_order_acquire); }
+
+    // 线程安全；所有连接共用的单调时钟
+    qint64 nowNs() const { return m_clock.nsecsElapsed(); }
+    // 线程安全；chunk 由若干条完整记录组成
+    void submit(QByteArray &&chunk);
+
+    quint64 bytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+    quint64 droppedChunks() const { return m_droppedChunks.load(std::memory_order_relaxed); }
+
+private:
+    void writeChunk(const QByteArray &chunk);
+
+    QThread m_thread;
+    QObject *m_writer;
+    QFile *m_file;
+    QElapsedTimer m_clock;
+    std::atomic<bool> m_open;
+    std::atomic<qint64> m_queuedBytes;
+    std::atomic<quint64> m_bytesWritten;
+    std::atomic<quint64> m_droppedChunks;
+};
+
+// 单个连接的记录缓冲，只在该连接的 I/O 线程使用：记录先拷进本地块，
+// 块写满或距上次提交超过一定时间才整体交给 TrafficCapture，每帧的开销只是一次 memcpy。
+// 空闲连接不足一块的尾部数据在 detach() 或 flush() 时提交。
+class CaptureBuffer
+{
+public:
+    void attach(std::shared_ptr<TrafficCapture> capture, quint16 stream);
+    void detach();
+    bool isActive() const { return m_capture != nullptr; }
+
+    void record(CaptureDirection direction, const char *data, quint32 size);
+    void flush();
+
+private:
+    std::shared_ptr<TrafficCapture> m_capture;
+    quint16 m_stream = 0;
+    QByteArray m_chunk;
+    qint64 m_chunkStartNs = 0;
+};
+
+struct CaptureRecord
+{
+    CaptureDirection direction = CaptureDirection::Inbound;
+    quint16 stream = 0;
+    qint64 timestampNs = 0;
+    const char *data = nullptr;
+    quint32 size = 0;
+};
+
+// 抓包文件的读端：整体内存映射，记录的负载指针直接指向映射区，在 close() 之前有效
+class CaptureReader
+{
+public:
+    CaptureReader() = default;
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+
+    qint64 startTimeMsecs() const { return m_startTimeMsecs; }
+    qint64 position() const { return m_pos; }
+    void seek(qint64 position) { m_pos = position; }
+    void rewind() { m_pos = TrafficCapture::kFileHeaderSize; }
+
+    // 读到文件尾或遇到不完整的记录（例如写入端异常退出）时返回 false
+    bool next(CaptureRecord &record);
+    bool isTruncated() const { return m_truncated; }
+
+private:
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_pos = 0;
+    qint64 m_startTimeMsecs = 0;
+    bool m_truncated = false;
+};
+
+#endif // TRAFFICCAPTURE_H
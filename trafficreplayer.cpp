@@ -0,0 +1,201 @@
+#include "trafficreplayer.h"
+#include <QDateTime>
+#include <algorithm>
+
+namespace {
+// 发送节拍
+constexpr int kTickIntervalMs = 1;
+
+// 压测报告里按请求类型统计；其他类型只计入延迟和错误
+int kindFor(data::RequestType type)
+{
+    switch (type) {
+    case data::LOGIN_REQUEST:
+        return int(LoadRequestKind::Login);
+    case data::SAVE_SOURCE_CODE_REQUEST:
+        return int(LoadRequestKind::Save);
+    case data::COMPILE_SOURCE_REQUEST:
+        return int(LoadRequestKind::Compile);
+    case data::EXECUTE_IR_REQUEST:
+        return int(LoadRequestKind::Execute);
+    default:
+        return -1;
+    }
+}
+}
+
+TrafficReplayer::TrafficReplayer(const ReplayConfig &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_next(0)
+    , m_pool(nullptr)
+    , m_tickTimer(new QTimer(this))
+    , m_inFlight(0)
+    , m_finished(false)
+{
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    m_tickTimer->setInterval(kTickIntervalMs);
+    connect(m_tickTimer, &QTimer::timeout, this, &TrafficReplayer::onTick);
+}
+
+bool TrafficReplayer::start(QString *error)
+{
+    if (!m_reader.open(m_config.capturePath, error)) {
+        return false;
+    }
+
+    // 只回放出站请求；心跳由连接自己发
+    CaptureRecord record;
+    while (m_reader.next(record)) {
+        if (record.direction != CaptureDirection::Outbound) {
+            continue;
+        }
+        if (!m_frame.ParseFromArray(record.data, int(record.size))) {
+            ++m_report.errors["unparseable frame in capture"];
+            continue;
+        }
+        if (m_frame.header().type() == data::HEARTBEAT) {
+            continue;
+        }
+        m_frames.push_back({record.timestampNs, record.data, record.size});
+    }
+    if (m_frames.empty()) {
+        if (error) {
+            *error = QString("抓包文件中没有可回放的请求: %1").arg(m_config.capturePath);
+        }
+        return false;
+    }
+    // 多个连接的记录块在文件里交错，按时间戳还原发送顺序
+    std::stable_sort(m_frames.begin(), m_frames.end(), [](const ReplayFrame &a, const ReplayFrame &b) {
+        return a.timestampNs < b.timestampNs;
+    });
+
+    m_pool = new ConnectionPool(m_config.connections, m_config.ioThreads, this);
+    m_report.connected = m_pool->connectToServer(m_config.host, m_config.port);
+    if (m_report.connected == 0) {
+        if (error) {
+            *error = QString("无法连接到服务器 %1:%2").arg(m_config.host).arg(m_config.port);
+        }
+        return false;
+    }
+
+    m_report.loop = m_config.speed > 0 ? LoadLoop::Open : LoadLoop::Closed;
+    m_report.startTimeMsecs = QDateTime::currentMSecsSinceEpoch();
+    m_clock.start();
+    m_tickTimer->start();
+    onTick();
+    return true;
+}
+
+void TrafficReplayer::onTick()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    const qint64 baseNs = m_frames.front().timestampNs;
+    while (m_next < m_frames.size()) {
+        const ReplayFrame &frame = m_frames[m_next];
+        qint64 intendedStartNs = now;
+        if (m_config.speed > 0) {
+            // 按原时间间隔缩放；落后时按原预定时刻补发，延迟从预定时刻算起
+            intendedStartNs = qint64(double(frame.timestampNs - baseNs) / m_config.speed);
+            if (intendedStartNs > now) {
+                break;
+            }
+        } else if (m_inFlight >= m_config.maxInFlight) {
+            break;
+        }
+        ++m_next;
+        send(frame, intendedStartNs);
+    }
+
+    if (m_next == m_frames.size()) {
+        m_tickTimer->stop();
+        finishIfDrained();
+    }
+}
+
+void TrafficReplayer::send(const ReplayFrame &frame, qint64 intendedStartNs)
+{
+    if (!m_frame.ParseFromArray(frame.data, int(frame.size))) {
+        return;
+    }
+
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    rewriteHeader(m_frame.mutable_header(), nowMs);
+    if (!m_frame.has_batch()) {
+        track(m_pool->sendRequest(m_frame), m_frame.header().type(), intendedStartNs);
+        return;
+    }
+
+    // 批次帧：服务端按子请求逐个应答，子请求的 request_id 也要换新并各自登记
+    auto *subRequests = m_frame.mutable_batch()->mutable_sub_requests();
+    for (data::MessageFrame &request : *subRequests) {
+        rewriteHeader(request.mutable_header(), nowMs);
+    }
+    const QVector<QFuture<data::MessageFrame>> futures =
+        m_pool->sendBatchRequest(m_frame, QVector<NetworkManager::BatchEntry>(subRequests->size()));
+    for (int i = 0; i < futures.size(); ++i) {
+        track(futures[i], subRequests->Get(i).header().type(), intendedStartNs);
+    }
+}
+
+void TrafficReplayer::rewriteHeader(data::RequestHeader *header, qint64 nowMs)
+{
+    header->set_request_id(m_requestIds.next());
+    header->set_timestamp(nowMs);
+    if (!m_config.authToken.isEmpty()) {
+        header->set_auth_token(m_config.authToken.toStdString());
+    }
+}
+
+void TrafficReplayer::track(QFuture<data::MessageFrame> future, data::RequestType type, qint64 intendedStartNs)
+{
+    const int kind = kindFor(type);
+    if (kind >= 0) {
+        ++m_report.kinds[kind].sent;
+    }
+    ++m_inFlight;
+    future.then(this, [this, kind, type, intendedStartNs](const data::MessageFrame &response) {
+        onResponse(kind, type, intendedStartNs, response);
+    });
+}
+
+void TrafficReplayer::onResponse(int kind, data::RequestType type, qint64 intendedStartNs,
+                                 const data::MessageFrame &response)
+{
+    --m_inFlight;
+    m_responseTime.record(type, m_clock.nsecsElapsed() - intendedStartNs);
+
+    const QString error = LoadReport::responseError(response);
+    if (kind >= 0) {
+        LoadReport::KindStats &stats = m_report.kinds[kind];
+        if (error.isEmpty()) {
+            ++stats.succeeded;
+        } else {
+            ++stats.failed;
+        }
+    }
+    if (!error.isEmpty()) {
+        ++m_report.errors[error];
+    }
+
+    if (m_next < m_frames.size()) {
+        // 最快速度回放时腾出的名额立即补上
+        if (m_config.speed <= 0) {
+            onTick();
+        }
+        return;
+    }
+    finishIfDrained();
+}
+
+void TrafficReplayer::finishIfDrained()
+{
+    if (m_finished || m_next < m_frames.size() || m_inFlight > 0) {
+        return;
+    }
+    m_finished = true;
+    m_report.elapsedNs = m_clock.nsecsElapsed();
+    m_responseTime.mergeInto(m_report.responseTime);
+    m_pool->mergeLatencyInto(m_report.serviceTime);
+    emit finished();
+}
@@ -0,0 +1,83 @@
+#ifndef TRAFFICREPLAYER_H
+#define TRAFFICREPLAYER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+#include <vector>
+#include "connectionpool.h"
+#include "latencyrecorder.h"
+#include "loadgenerator.h"
+#include "requestidgenerator.h"
+#include "trafficcapture.h"
+#include "protoc/data_proto.pb.h"
+
+struct ReplayConfig
+{
+    QString capturePath;
+    QString host = "127.0.0.1";
+    quint16 port = 8888;
+    int connections = 1;
+    int ioThreads = 1;
+    // 回放速度倍数（1 为原速）；0 表示不按原时间间隔、尽快发送，在途请求数不超过 maxInFlight
+    double speed = 1.0;
+    int maxInFlight = 1024;
+    // 非空时替换请求头里的 auth_token
+    QString authToken;
+};
+
+// 抓包回放：把抓包文件里的出站请求（心跳除外）按原时间间隔（或 N 倍速、最快速度）重新发给目标服务器，
+// 发送前把 request_id 换成新的、timestamp 换成当前时间，并按需替换 auth_token。
+// 自动批量产生的 BatchRequest 帧整帧回放，其中每个子请求也换上新的 request_id，按子请求分别统计。
+// 结果沿用压测报告：响应时间从预定发送时刻算起，服务时间由各连接记录。
+class TrafficReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TrafficReplayer(const ReplayConfig &config, QObject *parent = nullptr);
+
+    // 读取抓包、建立连接并开始回放；失败时返回 false 并写入 error
+    bool start(QString *error = nullptr);
+    const LoadReport &report() const { return m_report; }
+    int frameCount() const { return int(m_frames.size()); }
+
+signals:
+    void finished();
+
+private slots:
+    void onTick();
+
+private:
+    struct ReplayFrame
+    {
+        qint64 timestampNs;
+        const char *data;
+        quint32 size;
+    };
+
+    void send(const ReplayFrame &frame, qint64 intendedStartNs);
+    void rewriteHeader(data::RequestHeader *header, qint64 nowMs);
+    void track(QFuture<data::MessageFrame> future, data::RequestType type, qint64 intendedStartNs);
+    void onResponse(int kind, data::RequestType type, qint64 intendedStartNs, const data::MessageFrame &response);
+    void finishIfDrained();
+
+    ReplayConfig m_config;
+    CaptureReader m_reader;
+    std::vector<ReplayFrame> m_frames;
+    size_t m_next;
+    ConnectionPool *m_pool;
+    // 解析和改写复用同一个消息对象
+    data::MessageFrame m_frame;
+    // 回放的请求换上新的 request_id，避免与抓包时仍在服务端的请求冲突
+    RequestIdGenerator m_requestIds;
+    LatencyRecorder m_responseTime;
+    QElapsedTimer m_clock;
+    QTimer *m_tickTimer;
+    int m_inFlight;
+    bool m_finished;
+    LoadReport m_report;
+};
+
+#endif // TRAFFICREPLAYER_H